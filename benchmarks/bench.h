@@ -0,0 +1,45 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <chrono>
+#include <cstdio>
+
+/*
+ * Minimal timing helpers shared by the benchmarks. Every benchmark prints one line per case, with the time per
+ * operation and, when the operation has a size, the throughput.
+ */
+namespace bench {
+  using Clock = std::chrono::steady_clock;
+
+  // Keeps the compiler from optimising away a result.
+  template <typename T>
+  inline void keep(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+  }
+
+  /*
+   * Calls fn(iterations) with a growing iteration count until one call takes at least 200 ms, and returns the seconds
+   * per iteration of that call. fn has to run its operation the given number of times.
+   */
+  template <typename F>
+  double measure(F&& fn) {
+    for(size_t iterations = 1;; iterations *= 2) {
+      const auto start = Clock::now();
+      fn(iterations);
+      const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+      if(seconds >= 0.2)
+        return seconds / double(iterations);
+    }
+  }
+
+  // bytes is the amount of data one operation processes, 0 if throughput is meaningless.
+  inline void report(const char* name, double seconds, double bytes = 0) {
+    if(bytes > 0)
+      std::printf("%-48s %12.3f us %10.1f MB/s\n", name, seconds * 1e6, bytes / seconds / 1e6);
+    else
+      std::printf("%-48s %12.3f us %10.2f M/s\n", name, seconds * 1e6, 1e-6 / seconds);
+    std::fflush(stdout);
+  }
+}    // namespace bench
+
+#endif
@@ -0,0 +1,70 @@
+/*
+ * The tktk_bitmap kernels at every instruction set level this CPU supports, on a 640x480 RGSS screen and on a 1080p
+ * one.
+ */
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "kernels.hpp"
+
+using tktk::kernels::Level;
+
+namespace {
+  struct Size {
+    size_t width, height;
+  };
+
+  constexpr Size k_Sizes[] = {{640, 480}, {1920, 1080}};
+
+  struct Candidate {
+    Level level;
+    const char* name;
+  };
+
+  constexpr Candidate k_Candidates[] = {{Level::eScalar, "scalar"}, {Level::eSse2, "SSE2"}, {Level::eAvx2, "AVX2"}};
+
+  // best_level() is the highest one the CPU supports, every level below it works too
+  bool available(Level level) {
+    return static_cast<int>(level) <= static_cast<int>(tktk::kernels::best_level());
+  }
+
+  template <typename F>
+  void run(const char* kernel, const Candidate& candidate, Size size, F&& fn) {
+    std::vector<uint8_t> pixels(4 * size.width * size.height);
+    for(size_t ii = 0; ii < pixels.size(); ++ii)
+      pixels[ii] = uint8_t(ii * 31 + (ii >> 10));
+
+    const double seconds = bench::measure([&](size_t iterations) {
+      for(size_t ii = 0; ii < iterations; ++ii)
+        fn(pixels.data());
+      bench::keep(pixels[0]);
+    });
+
+    const std::string name = std::string{kernel} + " " + std::to_string(size.width) + "x" +
+                             std::to_string(size.height) + " " + candidate.name;
+    bench::report(name.c_str(), seconds, double(pixels.size()));
+  }
+}    // namespace
+
+int main() {
+  for(Size size : k_Sizes) {
+    const size_t count = size.width * size.height;
+
+    for(const Candidate& c : k_Candidates) {
+      if(!available(c.level))
+        continue;
+
+      run("change_tone", c, size, [&](uint8_t* p) { tktk::kernels::change_tone(p, count, 34, -17, 68, 128, c.level); });
+      run("change_hue", c, size, [&](uint8_t* p) { tktk::kernels::change_hue(p, count, 120, c.level); });
+      run("invert", c, size, [&](uint8_t* p) { tktk::kernels::invert(p, count, c.level); });
+      run("blur r=4", c, size, [&](uint8_t* p) { tktk::kernels::blur(p, size.width, size.height, 4, c.level); });
+    }
+
+    // mosaic has no vector versions
+    run("mosaic 8", {Level::eScalar, "scalar"}, size,
+        [&](uint8_t* p) { tktk::kernels::mosaic(p, size.width, 0, 0, size.width, size.height, 8); });
+  }
+
+  return 0;
+}
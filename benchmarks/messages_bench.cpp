@@ -0,0 +1,119 @@
+/*
+ * Message throughput of the message-window emulation: posting and retrieving on one thread, several producer threads
+ * posting to one consumer, and cross-thread SendMessage round trips.
+ */
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+#include "user32.h"
+
+namespace {
+  constexpr UINT WM_USER = 0x0400;
+  constexpr UINT PM_REMOVE = 0x0001;
+  constexpr int GWLP_WNDPROC = -4;
+
+  void postPeek() {
+    HWND hwnd = user32_CreateWindowExA(0, "bench", "", 0, 0, 0, 0, 0, 0, 0, 0, nullptr);
+
+    double seconds = bench::measure([hwnd](size_t iterations) {
+      MSG msg;
+      for(size_t ii = 0; ii < iterations; ++ii) {
+        user32_PostMessageA(hwnd, WM_USER, ii, 0);
+        user32_PeekMessageA(&msg, 0, 0, 0, PM_REMOVE);
+      }
+      bench::keep(msg);
+    });
+    bench::report("post + peek, same thread", seconds);
+
+    // a full queue drained at once, as a script does once per frame
+    constexpr size_t k_Batch = 256;
+    seconds = bench::measure([hwnd](size_t iterations) {
+      MSG msg;
+      for(size_t ii = 0; ii < iterations; ++ii) {
+        for(size_t jj = 0; jj < k_Batch; ++jj)
+          user32_PostMessageA(hwnd, WM_USER, jj, 0);
+        while(user32_PeekMessageA(&msg, 0, 0, 0, PM_REMOVE))
+          bench::keep(msg);
+      }
+    });
+    bench::report("post 256 + drain, same thread (per message)", seconds / k_Batch);
+
+    user32_DestroyWindow(hwnd);
+  }
+
+  void producers(unsigned count) {
+    double seconds = bench::measure([count](size_t iterations) {
+      std::atomic<HWND> target{0};
+      std::thread consumer{[&target, count, iterations]() {
+        target.store(user32_CreateWindowExA(0, "bench", "", 0, 0, 0, 0, 0, 0, 0, 0, nullptr));
+
+        MSG msg;
+        for(size_t received = 0; received < count * iterations;) {
+          if(user32_GetMessageA(&msg, 0, 0, 0) > 0 && msg.message == WM_USER)
+            ++received;
+        }
+        user32_DestroyWindow(target.load());
+      }};
+
+      while(!target.load())
+        std::this_thread::yield();
+
+      std::vector<std::thread> threads;
+      for(unsigned ii = 0; ii < count; ++ii) {
+        threads.emplace_back([hwnd = target.load(), iterations]() {
+          for(size_t jj = 0; jj < iterations; ++jj)
+            user32_PostMessageA(hwnd, WM_USER, jj, 0);
+        });
+      }
+
+      for(auto& thread : threads)
+        thread.join();
+      consumer.join();
+    });
+
+    const std::string name = std::to_string(count) + " producer(s) -> GetMessage consumer (per message)";
+    bench::report(name.c_str(), seconds / count);
+  }
+
+  LRESULT echo(HWND, UINT, WPARAM wParam, LPARAM) {
+    return LRESULT(wParam);
+  }
+
+  void sendRoundTrip() {
+    std::atomic<HWND> target{0};
+    std::atomic<bool> stop{false};
+    std::thread owner{[&target, &stop]() {
+      HWND hwnd = user32_CreateWindowExA(0, "bench", "", 0, 0, 0, 0, 0, 0, 0, 0, nullptr);
+      user32_SetWindowLongPtrA(hwnd, GWLP_WNDPROC, reinterpret_cast<LONG_PTR>(&echo));
+      target.store(hwnd);
+
+      // sent messages are handled while the owner waits for or peeks at its queue
+      MSG msg;
+      while(!stop.load())
+        user32_PeekMessageA(&msg, 0, 0, 0, PM_REMOVE);
+      user32_DestroyWindow(hwnd);
+    }};
+
+    while(!target.load())
+      std::this_thread::yield();
+
+    double seconds = bench::measure([hwnd = target.load()](size_t iterations) {
+      for(size_t ii = 0; ii < iterations; ++ii)
+        bench::keep(user32_SendMessageA(hwnd, WM_USER, ii, 0));
+    });
+    bench::report("SendMessage to another thread (round trip)", seconds);
+
+    stop.store(true);
+    owner.join();
+  }
+}    // namespace
+
+int main() {
+  postPeek();
+  for(unsigned count : {1u, 2u, 4u})
+    producers(count);
+  sendRoundTrip();
+}
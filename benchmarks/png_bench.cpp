@@ -0,0 +1,97 @@
+/*
+ * PNG encoding speed of the gdiplus encoder: libpng on one thread against the striped encoder on the shared thread
+ * pool, at screenshot sizes, with the size of the resulting file. Files go to the directory given as the first argument (the current one by default).
+ */
+#include <cstdio>
+#include <cstring>
+
+#include <algorithm>
+#include <string>
+
+#include "bench.h"
+#include "encoders.h"
+#include "threadpool.h"
+
+using gdiplus::encoders::Format;
+using gdiplus::encoders::Snapshot;
+
+namespace {
+  struct Size {
+    INT width, height;
+  };
+
+  constexpr Size k_Sizes[] = {{640, 480}, {1920, 1080}, {3840, 2160}};
+
+  // smooth gradients with some texture, roughly as compressible as a game screen
+  Snapshot make_image(INT width, INT height, PixelFormat format) {
+    Snapshot s{width, height, format, size_t(4) * width, nullptr};
+    s.pixels.reset(::pixels::allocate(s.stride * height, false));
+
+    uint32_t noise = 0x12345678;
+    for(INT y = 0; y < height; ++y) {
+      BYTE* row = s.pixels.get() + s.stride * y;
+      for(INT x = 0; x < width; ++x) {
+        noise = noise * 1664525 + 1013904223;
+        row[4 * x + 0] = BYTE(x + (noise >> 30));
+        row[4 * x + 1] = BYTE(y);
+        row[4 * x + 2] = BYTE((x ^ y) >> 2);
+        row[4 * x + 3] = BYTE(255 - (y >> 3));
+      }
+    }
+
+    return s;
+  }
+
+  Snapshot copy_of(const Snapshot& s) {
+    Snapshot copy{s.width, s.height, s.format, s.stride, nullptr};
+    copy.pixels.reset(::pixels::allocate(s.stride * s.height, false));
+    std::memcpy(copy.pixels.get(), s.pixels.get(), s.stride * s.height);
+    return copy;
+  }
+
+  long file_size(const std::string& path) {
+    FILE* fp = std::fopen(path.c_str(), "rb");
+    if(!fp)
+      return -1;
+    std::fseek(fp, 0, SEEK_END);
+    const long size = std::ftell(fp);
+    std::fclose(fp);
+    return size;
+  }
+
+  void run(const std::string& dir, Size size, PixelFormat format, const char* formatName) {
+    const Snapshot image = make_image(size.width, size.height, format);
+    const std::string path = dir + "/png_bench.png";
+
+    // at least two workers, so the striped encoder also runs (and shows its overhead) on a single core
+    const UINT poolWorkers = UINT(std::max<size_t>(2, threads::concurrency()));
+
+    for(UINT workers : {1u, poolWorkers}) {
+      gdiplus::encoders::set_workers(workers);
+
+      const double seconds = bench::measure([&](size_t iterations) {
+        for(size_t ii = 0; ii < iterations; ++ii)
+          gdiplus::encoders::submit(Format::ePng, path, copy_of(image));
+        gdiplus::encoders::flush();
+      });
+
+      const std::string name = std::to_string(size.width) + "x" + std::to_string(size.height) + " " + formatName +
+                               (workers == 1 ? " libpng" : " parallel");
+      bench::report(name.c_str(), seconds, double(image.stride) * image.height);
+      std::printf("%-48s %12ld bytes\n", "", file_size(path));
+    }
+
+    std::remove(path.c_str());
+  }
+}    // namespace
+
+int main(int argc, char** argv) {
+  const std::string dir = (argc > 1 ? argv[1] : ".");
+
+  for(Size size : k_Sizes) {
+    run(dir, size, PixelFormat32bppRGB, "32bppRGB");
+    run(dir, size, PixelFormat32bppARGB, "32bppARGB");
+  }
+
+  return 0;
+}
@@ -0,0 +1,83 @@
+/*
+ * Throughput of the Rijndael implementations behind wfcrypt, for every block and key size and for growing numbers of
+ * blocks per call: single blocks show the per-call cost, long runs the bulk paths that handle several blocks at once.
+ */
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "rijndael.hpp"
+#include "rijndael_aesni.hpp"
+
+using rijndael::Context;
+using rijndael::Implementation;
+
+namespace {
+  constexpr size_t k_BlockCounts[] = {1, 4, 16, 256, 4096};
+
+  struct Candidate {
+    Implementation impl;
+    const char* name;
+  };
+
+  constexpr Candidate k_Candidates[] = {{Implementation::eReference, "reference"},
+                                        {Implementation::eTable, "T-table"},
+                                        {Implementation::eAesNi, "AES-NI"},
+                                        {Implementation::eBitsliced, "bitsliced"}};
+
+  bool available(Implementation impl, uint32_t nb) {
+    switch(impl) {
+      case Implementation::eAesNi:
+        return (nb == 4 && rijndael::aesni::supported());
+      case Implementation::eBitsliced:
+        return (nb == 4);
+      default:
+        return true;
+    }
+  }
+
+  constexpr uint8_t k_Key[32] = {1, 8, 15, 22, 29, 36, 43, 50, 57, 64, 71, 78, 85, 92, 99, 106,
+                                 113, 120, 127, 134, 141, 148, 155, 162, 169, 176, 183, 190, 197, 204, 211, 218};
+
+  void run(const char* name, const Context& ctx, uint32_t nb, uint32_t nk) {
+    for(size_t count : k_BlockCounts) {
+      std::vector<uint8_t> data(ctx.blockSize() * count, 0x5a);
+      const buffer::byte_buffer_span span{data.data(), data.size()};
+
+      const std::string prefix = std::string{name} + " Nb=" + std::to_string(nb) +
+                                 " Nk=" + std::to_string(nk) + " x" + std::to_string(count);
+
+      double seconds = bench::measure([&](size_t iterations) {
+        for(size_t ii = 0; ii < iterations; ++ii)
+          ctx.encrypt_blocks(span);
+        bench::keep(data[0]);
+      });
+      bench::report((prefix + " encrypt").c_str(), seconds, double(data.size()));
+
+      seconds = bench::measure([&](size_t iterations) {
+        for(size_t ii = 0; ii < iterations; ++ii)
+          ctx.decrypt_blocks(span);
+        bench::keep(data[0]);
+      });
+      bench::report((prefix + " decrypt").c_str(), seconds, double(data.size()));
+    }
+  }
+}    // namespace
+
+int main() {
+  for(uint32_t nb : {4, 6, 8}) {
+    for(uint32_t nk : {4, 6, 8}) {
+      const buffer::byte_buffer_view key{k_Key, sizeof(uint32_t) * nk};
+
+      for(const Candidate& candidate : k_Candidates) {
+        if(available(candidate.impl, nb))
+          run(candidate.name, Context{nb, key, candidate.impl}, nb, nk);
+      }
+
+      // what wfcrypt uses: the best single block implementation plus the best bulk one
+      run("default", Context{nb, key}, nb, nk);
+    }
+  }
+
+  return 0;
+}
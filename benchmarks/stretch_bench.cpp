@@ -0,0 +1,74 @@
+/*
+ * StretchBlt scaling at the sizes RPG Maker games run at (544x416 for VX/VX Ace, 640x480 for XP) onto common window
+ * sizes, for both filters, with the SIMD kernels and the scalar reference ones.
+ */
+#include <string>
+
+#include "bench.h"
+#include "blit.h"
+
+using gdi::blit::Filter;
+
+namespace {
+  struct Size {
+    int width, height;
+  };
+
+  struct Case {
+    Size src, dst;
+  };
+
+  constexpr Case k_Cases[] = {
+      {{544, 416}, {1088, 832}},    // VX Ace at 2x
+      {{544, 416}, {1920, 1080}},   // VX Ace stretched to a 1080p fullscreen
+      {{640, 480}, {1280, 960}},    // XP at 2x
+      {{640, 480}, {1920, 1080}},   // XP stretched to a 1080p fullscreen
+      {{1920, 1080}, {640, 480}},   // a screenshot scaled down to a thumbnail
+  };
+
+  // built by hand instead of with Surface::create, which lives with the GDI objects (and their font dependencies)
+  gdi::Surface make_surface(Size size) {
+    gdi::Surface s;
+    s.width = size.width;
+    s.height = size.height;
+    s.stride = pixels::aligned_stride(4 * size_t(size.width));
+    s.storage.reset(pixels::allocate(s.stride * size.height));
+
+    for(int y = 0; y < s.height; ++y) {
+      uint8_t* row = s.row(y);
+      for(int x = 0; x < 4 * s.width; ++x)
+        row[x] = uint8_t(x * 7 + y * 3);
+    }
+
+    return s;
+  }
+}    // namespace
+
+int main() {
+  for(const Case& c : k_Cases) {
+    const gdi::Surface src = make_surface(c.src);
+    gdi::Surface dst = make_surface(c.dst);
+
+    const RECT srcRect{0, 0, c.src.width, c.src.height};
+    const RECT dstRect{0, 0, c.dst.width, c.dst.height};
+
+    for(Filter filter : {Filter::eNearest, Filter::eBilinear}) {
+      for(bool simd : {false, true}) {
+        const double seconds = bench::measure([&](size_t iterations) {
+          for(size_t ii = 0; ii < iterations; ++ii)
+            gdi::blit::stretch(src, srcRect, dst, dstRect, dstRect, filter, simd);
+          bench::keep(dst.row(0)[0]);
+        });
+
+        const std::string name = std::to_string(c.src.width) + "x" + std::to_string(c.src.height) + " -> " +
+                                 std::to_string(c.dst.width) + "x" + std::to_string(c.dst.height) +
+                                 (filter == Filter::eNearest ? " nearest" : " bilinear") +
+                                 (simd ? " SIMD" : " scalar");
+        // throughput in destination pixels, which is what the kernels produce
+        bench::report(name.c_str(), seconds, 4.0 * c.dst.width * c.dst.height);
+      }
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,281 @@
+#include "pixels.h"
+
+#include <sys/mman.h>
+
+#include <cstdlib>
+#include <cstring>
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#  include <immintrin.h>
+#  define PIXELS_HAVE_SSE 1
+#endif
+
+namespace pixels {
+  namespace {
+    constexpr size_t k_PageSize = 4096;
+    // released buffers beyond this are given back to the system
+    constexpr size_t k_MaxCachedBytes = 64 << 20;
+
+    // whole pages up to 64 KiB, then four classes per power of two, so at most a quarter is wasted
+    size_t size_class(size_t size) noexcept {
+      size = (size + k_PageSize - 1) & ~(k_PageSize - 1);
+      if(size <= (64 << 10))
+        return (size == 0 ? k_PageSize : size);
+
+      const size_t step = size_t(1) << (63 - __builtin_clzll(size) - 2);
+      return (size + step - 1) & ~(step - 1);
+    }
+
+    uint8_t* map(size_t size) noexcept {
+      void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      return (p == MAP_FAILED ? nullptr : static_cast<uint8_t*>(p));
+    }
+
+    class Arena {
+     public:
+      uint8_t* allocate(size_t size, bool zeroed) {
+        const size_t cls = size_class(size);
+
+        uint8_t* p = nullptr;
+        {
+          std::lock_guard lock{m_Mutex};
+
+          auto it = m_Free.find(cls);
+          if(it != m_Free.end()) {
+            p = it->second.back();
+            it->second.pop_back();
+            if(it->second.empty())
+              m_Free.erase(it);
+            m_CachedBytes -= cls;
+          }
+        }
+
+        // fresh pages come zeroed from the system, only reused buffers need clearing
+        if(p) {
+          if(zeroed)
+            std::memset(p, 0, cls);
+        } else {
+          p = map(cls);
+          if(!p)
+            return nullptr;
+        }
+
+        std::lock_guard lock{m_Mutex};
+        m_Live.emplace(p, cls);
+        m_LiveBytes += cls;
+        m_PeakBytes = std::max(m_PeakBytes, m_LiveBytes);
+        return p;
+      }
+
+      void release(uint8_t* p) {
+        std::vector<std::pair<uint8_t*, size_t>> evicted;
+        {
+          std::lock_guard lock{m_Mutex};
+
+          auto it = m_Live.find(p);
+          if(it == m_Live.end())
+            return;
+
+          const size_t cls = it->second;
+          m_Live.erase(it);
+          m_LiveBytes -= cls;
+
+          if(cls > k_MaxCachedBytes) {
+            evicted.emplace_back(p, cls);
+          } else {
+            // make room by dropping the largest cached buffers first, they are the least likely to be asked for again
+            while(m_CachedBytes + cls > k_MaxCachedBytes) {
+              auto largest = std::prev(m_Free.end());
+              evicted.emplace_back(largest->second.back(), largest->first);
+              largest->second.pop_back();
+              m_CachedBytes -= largest->first;
+              if(largest->second.empty())
+                m_Free.erase(largest);
+            }
+
+            m_Free[cls].push_back(p);
+            m_CachedBytes += cls;
+          }
+        }
+
+        for(auto [e, size] : evicted)
+          munmap(e, size);
+      }
+
+      Stats stats() {
+        std::lock_guard lock{m_Mutex};
+        return Stats{m_LiveBytes, m_PeakBytes, m_CachedBytes, m_Live.size()};
+      }
+
+     private:
+      std::mutex m_Mutex;
+      std::unordered_map<uint8_t*, size_t> m_Live;        // buffer -> its size class
+      std::map<size_t, std::vector<uint8_t*>> m_Free;    // size class -> released buffers
+      size_t m_LiveBytes{0}, m_PeakBytes{0}, m_CachedBytes{0};
+    };
+
+    Arena& arena() {
+      static Arena* s_Arena = new Arena;    // never destroyed, static bitmaps may be released during exit
+      return *s_Arena;
+    }
+
+    void bgr24_to_bgra32_scalar(const uint8_t* src, uint8_t* dst, size_t count) noexcept {
+      for(size_t ii = 0; ii < count; ++ii, src += 3, dst += 4) {
+        dst[0] = src[0];
+        dst[1] = src[1];
+        dst[2] = src[2];
+        dst[3] = 0xFF;
+      }
+    }
+
+    void bgra32_to_bgr24_scalar(const uint8_t* src, uint8_t* dst, size_t count) noexcept {
+      for(size_t ii = 0; ii < count; ++ii, src += 4, dst += 3) {
+        dst[0] = src[0];
+        dst[1] = src[1];
+        dst[2] = src[2];
+      }
+    }
+
+#if defined(PIXELS_HAVE_SSE)
+    bool has_ssse3() noexcept {
+      static const bool s_Supported = (__builtin_cpu_init(), __builtin_cpu_supports("ssse3") != 0);
+      return s_Supported;
+    }
+
+    // sixteen pixels per iteration, as four overlapping 16 byte loads of which 12 bytes are used
+    __attribute__((target("ssse3"))) size_t bgr24_to_bgra32_ssse3(const uint8_t* src, uint8_t* dst,
+                                                                   size_t count) noexcept {
+      const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+      const __m128i alpha = _mm_set1_epi32(int(0xFF000000));
+
+      // the last load of an iteration reads 4 bytes past its 48, so stop while there is room for them
+      size_t ii = 0;
+      for(; ii + 18 <= count; ii += 16, src += 48, dst += 64) {
+        for(int jj = 0; jj < 4; ++jj) {
+          __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 12 * jj));
+          v = _mm_or_si128(_mm_shuffle_epi8(v, shuffle), alpha);
+          _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16 * jj), v);
+        }
+      }
+
+      return ii;
+    }
+
+    // four pixels per iteration, each store writing 4 bytes past its 12 which the next one overwrites
+    __attribute__((target("ssse3"))) size_t bgra32_to_bgr24_ssse3(const uint8_t* src, uint8_t* dst,
+                                                                   size_t count) noexcept {
+      const __m128i shuffle = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+
+      size_t ii = 0;
+      for(; ii + 6 <= count; ii += 4, src += 16, dst += 12) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_shuffle_epi8(v, shuffle));
+      }
+
+      return ii;
+    }
+#endif
+  }    // namespace
+}    // namespace pixels
+
+uint8_t* pixels::allocate(size_t size, bool zeroed) noexcept {
+  return arena().allocate(size, zeroed);
+}
+
+void pixels::release(uint8_t* p) noexcept {
+  if(p)
+    arena().release(p);
+}
+
+pixels::Stats pixels::stats() noexcept {
+  return arena().stats();
+}
+
+void pixels::bgr24_to_bgra32(const uint8_t* src, uint8_t* dst, size_t count) noexcept {
+  size_t done = 0;
+#if defined(PIXELS_HAVE_SSE)
+  if(has_ssse3())
+    done = bgr24_to_bgra32_ssse3(src, dst, count);
+#endif
+
+  bgr24_to_bgra32_scalar(src + 3 * done, dst + 4 * done, count - done);
+}
+
+void pixels::bgrx32_to_bgra32(const uint8_t* src, uint8_t* dst, size_t count) noexcept {
+  size_t ii = 0;
+#if defined(PIXELS_HAVE_SSE)
+  const __m128i alpha = _mm_set1_epi32(int(0xFF000000));
+  for(; ii + 4 <= count; ii += 4) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 4 * ii));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4 * ii), _mm_or_si128(v, alpha));
+  }
+#endif
+
+  for(; ii < count; ++ii) {
+    uint32_t px;
+    std::memcpy(&px, src + 4 * ii, sizeof(px));
+    px |= 0xFF000000;
+    std::memcpy(dst + 4 * ii, &px, sizeof(px));
+  }
+}
+
+void pixels::bgra32_to_bgr24(const uint8_t* src, uint8_t* dst, size_t count) noexcept {
+  size_t done = 0;
+#if defined(PIXELS_HAVE_SSE)
+  if(has_ssse3())
+    done = bgra32_to_bgr24_ssse3(src, dst, count);
+#endif
+
+  bgra32_to_bgr24_scalar(src + 4 * done, dst + 3 * done, count - done);
+}
+
+void pixels::swap_rb32(const uint8_t* src, uint8_t* dst, size_t count) noexcept {
+  size_t ii = 0;
+#if defined(PIXELS_HAVE_SSE)
+  const __m128i ga = _mm_set1_epi32(int(0xFF00FF00)), rb = _mm_set1_epi32(0x00FF00FF);
+  for(; ii + 4 <= count; ii += 4) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 4 * ii));
+    __m128i x = _mm_and_si128(v, rb);
+    x = _mm_or_si128(_mm_slli_epi32(x, 16), _mm_srli_epi32(x, 16));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4 * ii), _mm_or_si128(_mm_and_si128(v, ga), x));
+  }
+#endif
+
+  for(; ii < count; ++ii) {
+    uint32_t px;
+    std::memcpy(&px, src + 4 * ii, sizeof(px));
+    px = (px & 0xFF00FF00) | ((px & 0xFF) << 16) | ((px >> 16) & 0xFF);
+    std::memcpy(dst + 4 * ii, &px, sizeof(px));
+  }
+}
+
+void pixels::fill32(uint8_t* dst, uint32_t value, size_t count) noexcept {
+  size_t ii = 0;
+#if defined(PIXELS_HAVE_SSE)
+  // single pixels up to the first 16 byte boundary, so that the rest are aligned stores
+  for(; ii < count && (reinterpret_cast<uintptr_t>(dst + 4 * ii) & 15) != 0; ++ii)
+    std::memcpy(dst + 4 * ii, &value, sizeof(value));
+
+  const __m128i v = _mm_set1_epi32(int(value));
+  for(; ii + 16 <= count; ii += 16) {
+    auto p = reinterpret_cast<__m128i*>(dst + 4 * ii);
+    _mm_store_si128(p, v);
+    _mm_store_si128(p + 1, v);
+    _mm_store_si128(p + 2, v);
+    _mm_store_si128(p + 3, v);
+  }
+  for(; ii + 4 <= count; ii += 4)
+    _mm_store_si128(reinterpret_cast<__m128i*>(dst + 4 * ii), v);
+#endif
+
+  for(; ii < count; ++ii)
+    std::memcpy(dst + 4 * ii, &value, sizeof(value));
+}
@@ -0,0 +1,59 @@
+#ifndef PIXELS_H
+#define PIXELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <memory>
+
+namespace pixels {
+  // rows of every pixel buffer start on a cache line
+  constexpr size_t k_RowAlignment = 64;
+
+  constexpr size_t aligned_stride(size_t rowBytes) noexcept {
+    return (rowBytes + k_RowAlignment - 1) & ~(k_RowAlignment - 1);
+  }
+
+  /*
+   * Storage for pixel rows, page aligned, from a pool shared by everything that holds pixels. Sizes are rounded up to
+   * a size class, so buffers for the same dimensions are handed out again once released instead of going back to the
+   * system. Returns nullptr if out of memory. The memory is zeroed unless asked otherwise.
+   */
+  uint8_t* allocate(size_t size, bool zeroed = true) noexcept;
+  void release(uint8_t* p) noexcept;
+
+  struct Stats {
+    size_t liveBytes;      // in buffers handed out and not released yet
+    size_t peakBytes;      // highest liveBytes so far
+    size_t cachedBytes;    // in released buffers kept for reuse
+    size_t liveBuffers;
+  };
+
+  Stats stats() noexcept;
+
+  struct Deleter {
+    void operator()(uint8_t* p) const noexcept {
+      release(p);
+    }
+  };
+
+  using buffer_ptr = std::unique_ptr<uint8_t[], Deleter>;
+
+  /*
+   * Row conversions into 32 bit BGRA (the memory order of both DIBs and GDI+ ARGB) with opaque alpha. Source and
+   * destination must not overlap.
+   */
+  void bgr24_to_bgra32(const uint8_t* src, uint8_t* dst, size_t count) noexcept;
+  void bgrx32_to_bgra32(const uint8_t* src, uint8_t* dst, size_t count) noexcept;
+
+  // drops the fourth byte of every pixel; source and destination must not overlap
+  void bgra32_to_bgr24(const uint8_t* src, uint8_t* dst, size_t count) noexcept;
+
+  // swaps the first and third byte of every pixel, so BGRA to RGBA or back; src may be dst
+  void swap_rb32(const uint8_t* src, uint8_t* dst, size_t count) noexcept;
+
+  // sets count 32 bit pixels starting at dst to value
+  void fill32(uint8_t* dst, uint32_t value, size_t count) noexcept;
+}    // namespace pixels
+
+#endif
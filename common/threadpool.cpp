@@ -0,0 +1,127 @@
+#include "threadpool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace threads {
+  namespace {
+    struct Job {
+      const std::function<void(size_t)>* fn;
+      size_t count;
+      std::atomic<size_t> next{0};
+      std::atomic<size_t> finished{0};
+
+      // runs indices until there are none left; returns true if this call finished the last one
+      bool work() {
+        size_t done = 0;
+        for(size_t ii = next.fetch_add(1, std::memory_order_relaxed); ii < count;
+            ii = next.fetch_add(1, std::memory_order_relaxed)) {
+          (*fn)(ii);
+          ++done;
+        }
+
+        return done > 0 && finished.fetch_add(done, std::memory_order_acq_rel) + done == count;
+      }
+    };
+
+    class Pool {
+      public:
+        explicit Pool(size_t workers) {
+          m_Workers.reserve(workers);
+          for(size_t ii = 0; ii < workers; ++ii)
+            m_Workers.emplace_back([this]() { run(); });
+        }
+
+        ~Pool() {
+          {
+            std::lock_guard lock{m_Mutex};
+            m_Stop = true;
+          }
+          m_Wake.notify_all();
+
+          for(auto& worker : m_Workers)
+            worker.join();
+        }
+
+        void run(const std::shared_ptr<Job>& job) {
+          {
+            std::lock_guard lock{m_Mutex};
+            m_Jobs.push_back(job);
+          }
+          m_Wake.notify_all();
+
+          if(!job->work()) {
+            std::unique_lock lock{m_Mutex};
+            m_Done.wait(lock, [&job]() { return job->finished.load(std::memory_order_acquire) == job->count; });
+          }
+
+          std::lock_guard lock{m_Mutex};
+          m_Jobs.erase(std::remove(m_Jobs.begin(), m_Jobs.end(), job), m_Jobs.end());
+        }
+
+      private:
+        void run() {
+          std::unique_lock lock{m_Mutex};
+
+          while(true) {
+            m_Wake.wait(lock, [this]() { return m_Stop || !m_Jobs.empty(); });
+            if(m_Stop)
+              return;
+
+            auto job = m_Jobs.front();
+            lock.unlock();
+
+            bool last = job->work();
+
+            lock.lock();
+            if(last)
+              m_Done.notify_all();
+
+            // nothing left to hand out, so do not pick it up again
+            if(!m_Jobs.empty() && m_Jobs.front() == job)
+              m_Jobs.pop_front();
+          }
+        }
+
+        std::mutex m_Mutex;
+        std::condition_variable m_Wake;
+        std::condition_variable m_Done;
+        std::deque<std::shared_ptr<Job>> m_Jobs;
+        std::vector<std::thread> m_Workers;
+        bool m_Stop{false};
+    };
+
+    Pool& pool() {
+      // never destroyed: other statics (the gdiplus encoder writer) still run jobs while the process exits
+      static Pool* s_Pool = new Pool{concurrency() - 1};
+      return *s_Pool;
+    }
+  }    // namespace
+
+  size_t concurrency() noexcept {
+    static const size_t s_Concurrency = std::max(1u, std::thread::hardware_concurrency());
+    return s_Concurrency;
+  }
+
+  void parallel_for(size_t count, const std::function<void(size_t)>& fn) {
+    if(count == 0)
+      return;
+
+    auto job = std::make_shared<Job>();
+    job->fn = &fn;
+    job->count = count;
+
+    if(count == 1 || concurrency() == 1) {
+      job->work();
+      return;
+    }
+
+    pool().run(job);
+  }
+}    // namespace threads
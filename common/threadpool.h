@@ -0,0 +1,21 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <cstddef>
+
+#include <functional>
+
+namespace threads {
+  /*
+   * Number of threads parallel_for spreads work over, the calling thread included.
+   */
+  size_t concurrency() noexcept;
+
+  /*
+   * Runs fn(ii) for every ii in [0, count) on the shared worker pool and the calling thread, and returns once all of
+   * them have finished. Workers are started on first use.
+   */
+  void parallel_for(size_t count, const std::function<void(size_t)>& fn);
+}    // namespace threads
+
+#endif
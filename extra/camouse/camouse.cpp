@@ -1,10 +1,49 @@
 #include "camouse.hpp"
 
+#include <atomic>
+
+#include <SDL.h>
+
 #include "log.h"
 
+#include "input.h"
 #include "user32.h"
 #include "mkxpGlue.h"
 
+namespace {
+  constexpr LONG WHEEL_DELTA = 120;
+
+  // accumulated vertical wheel movement since the last query, in WHEEL_DELTA units
+  std::atomic<LONG> s_WheelDelta{0};
+  std::atomic<bool> s_Installed{false};
+  // set by DisposeHook, so that polling does not bring the hook back until RegenerationHook
+  std::atomic<bool> s_Disposed{false};
+
+  int SDLCALL watchWheel(void*, SDL_Event* ev) {
+    if(ev->type == SDL_MOUSEWHEEL) {
+      LONG delta = LONG(ev->wheel.y) * WHEEL_DELTA;
+      if(ev->wheel.direction == SDL_MOUSEWHEEL_FLIPPED)
+        delta = -delta;
+
+      s_WheelDelta.fetch_add(delta, std::memory_order_relaxed);
+    }
+
+    return 1;
+  }
+
+  void installWatch() noexcept {
+    if(!s_Installed.exchange(true, std::memory_order_acq_rel)) {
+      s_WheelDelta.store(0, std::memory_order_relaxed);
+      input::addEventWatch(watchWheel, nullptr);
+    }
+  }
+
+  void removeWatch() noexcept {
+    if(s_Installed.exchange(false, std::memory_order_acq_rel))
+      input::delEventWatch(watchWheel, nullptr);
+  }
+}    // namespace
+
 HWND camouse_GetWindowHandle() {
   SPDLOG_TRACE("camouse::GetWindowHandle()");
 
@@ -14,17 +53,25 @@ HWND camouse_GetWindowHandle() {
 LONG camouse_GetWheelDelta() {
   SPDLOG_TRACE("camouse::GetWheelDelta()");
 
-  return 0;
+  // scripts that never call RegenerationHook still get wheel input
+  if(!s_Disposed.load(std::memory_order_acquire))
+    installWatch();
+
+  return s_WheelDelta.exchange(0, std::memory_order_relaxed);
 }
 
 LONG camouse_DisposeHook() {
   SPDLOG_TRACE("camouse::DisposeHook()");
 
+  s_Disposed.store(true, std::memory_order_release);
+  removeWatch();
   return 0;
 }
 
 LONG camouse_RegenerationHook() {
   SPDLOG_TRACE("camouse::RegenerationHook()");
 
+  s_Disposed.store(false, std::memory_order_release);
+  installWatch();
   return 0;
 }
@@ -0,0 +1,428 @@
+#include "kernels.hpp"
+
+#include <cmath>
+#include <cstring>
+
+#include <algorithm>
+#include <memory>
+#include <new>
+
+#if defined(__x86_64__) || defined(__i386__)
+#  include <immintrin.h>
+#  define TKTK_HAVE_SSE 1
+#endif
+
+namespace tktk::kernels {
+  namespace {
+    // luminance weights out of 256, in RGBA order
+    constexpr int k_LumR = 77, k_LumG = 150, k_LumB = 29;
+
+    struct Tone {
+      int red, green, blue;
+      int gray;    // out of 128
+    };
+
+    // hue rotation matrix in 4.12 fixed point, row-major
+    struct HueMatrix {
+      int16_t m[3][3];
+    };
+
+    inline uint8_t clamp_u8(int v) noexcept {
+      return uint8_t(std::clamp(v, 0, 255));
+    }
+
+    HueMatrix hue_matrix(int degrees) noexcept {
+      const double rad = (degrees % 360) * M_PI / 180.0;
+      const double c = std::cos(rad), s = std::sin(rad);
+
+      const double m[3][3] = {
+          {0.213 + c * 0.787 - s * 0.213, 0.715 - c * 0.715 - s * 0.715, 0.072 - c * 0.072 + s * 0.928},
+          {0.213 - c * 0.213 + s * 0.143, 0.715 + c * 0.285 + s * 0.140, 0.072 - c * 0.072 - s * 0.283},
+          {0.213 - c * 0.213 - s * 0.787, 0.715 - c * 0.715 + s * 0.715, 0.072 + c * 0.928 + s * 0.072},
+      };
+
+      HueMatrix h{};
+      for(int ii = 0; ii < 3; ++ii) {
+        for(int jj = 0; jj < 3; ++jj)
+          h.m[ii][jj] = int16_t(std::lround(m[ii][jj] * 4096));
+      }
+      return h;
+    }
+
+
+    /* scalar reference */
+
+    void tone_scalar(uint8_t* p, size_t count, const Tone& t) noexcept {
+      for(size_t ii = 0; ii < count; ++ii, p += 4) {
+        const int lum = (p[0] * k_LumR + p[1] * k_LumG + p[2] * k_LumB) >> 8;
+        p[0] = clamp_u8(p[0] + (((lum - p[0]) * t.gray) >> 7) + t.red);
+        p[1] = clamp_u8(p[1] + (((lum - p[1]) * t.gray) >> 7) + t.green);
+        p[2] = clamp_u8(p[2] + (((lum - p[2]) * t.gray) >> 7) + t.blue);
+      }
+    }
+
+    void hue_scalar(uint8_t* p, size_t count, const HueMatrix& h) noexcept {
+      for(size_t ii = 0; ii < count; ++ii, p += 4) {
+        const int r = p[0], g = p[1], b = p[2];
+        for(int cc = 0; cc < 3; ++cc)
+          p[cc] = clamp_u8((r * h.m[cc][0] + g * h.m[cc][1] + b * h.m[cc][2] + 2048) >> 12);
+      }
+    }
+
+    void invert_scalar(uint8_t* p, size_t count) noexcept {
+      for(size_t ii = 0; ii < count; ++ii, p += 4) {
+        p[0] ^= 0xFF;
+        p[1] ^= 0xFF;
+        p[2] ^= 0xFF;
+      }
+    }
+
+    // one output row of the vertical pass, and the window moved down by one row
+    void blur_column_step_scalar(uint32_t* sums, const uint8_t* add, const uint8_t* sub, uint8_t* out, size_t n,
+                                 float inv) noexcept {
+      for(size_t ii = 0; ii < n; ++ii) {
+        out[ii] = uint8_t(std::nearbyint(float(sums[ii]) * inv));
+        sums[ii] += add[ii] - sub[ii];
+      }
+    }
+
+
+#if defined(TKTK_HAVE_SSE)
+    /* SSE2 */
+
+    inline __m128i tone_half_sse2(__m128i v, __m128i w, __m128i g, __m128i t) noexcept {
+      // lum for both pixels, broadcast to their four 16-bit lanes
+      __m128i m = _mm_madd_epi16(v, w);
+      m = _mm_add_epi32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(2, 3, 0, 1)));
+      __m128i lum = _mm_srli_epi32(m, 8);
+      lum = _mm_packs_epi32(lum, lum);
+      lum = _mm_unpacklo_epi16(lum, lum);
+
+      __m128i d = _mm_srai_epi16(_mm_mullo_epi16(_mm_sub_epi16(lum, v), g), 7);
+      return _mm_add_epi16(_mm_add_epi16(v, d), t);
+    }
+
+    size_t tone_sse2(uint8_t* p, size_t count, const Tone& t) noexcept {
+      const __m128i zero = _mm_setzero_si128();
+      const __m128i w = _mm_setr_epi16(k_LumR, k_LumG, k_LumB, 0, k_LumR, k_LumG, k_LumB, 0);
+      const __m128i g = _mm_setr_epi16(t.gray, t.gray, t.gray, 0, t.gray, t.gray, t.gray, 0);
+      const __m128i a = _mm_setr_epi16(t.red, t.green, t.blue, 0, t.red, t.green, t.blue, 0);
+
+      size_t ii = 0;
+      for(; ii + 4 <= count; ii += 4) {
+        auto ptr = reinterpret_cast<__m128i*>(p + 4 * ii);
+        const __m128i px = _mm_loadu_si128(ptr);
+        const __m128i lo = tone_half_sse2(_mm_unpacklo_epi8(px, zero), w, g, a);
+        const __m128i hi = tone_half_sse2(_mm_unpackhi_epi8(px, zero), w, g, a);
+        _mm_storeu_si128(ptr, _mm_packus_epi16(lo, hi));
+      }
+      return ii;
+    }
+
+    // the three channel rows of the matrix as (r, b) and (g, a) 16-bit pairs, ready for madd
+    struct HueVectors {
+      __m128i rb[3], ga[3];
+
+      explicit HueVectors(const HueMatrix& h) noexcept {
+        for(int cc = 0; cc < 3; ++cc) {
+          rb[cc] = _mm_set1_epi32(int(uint16_t(h.m[cc][0])) | (int(h.m[cc][2]) << 16));
+          ga[cc] = _mm_set1_epi32(int(uint16_t(h.m[cc][1])));
+        }
+      }
+    };
+
+    size_t hue_sse2(uint8_t* p, size_t count, const HueMatrix& h) noexcept {
+      const HueVectors hv{h};
+      const __m128i mask = _mm_set1_epi32(0x00FF00FF), round = _mm_set1_epi32(2048);
+
+      size_t ii = 0;
+      for(; ii + 4 <= count; ii += 4) {
+        auto ptr = reinterpret_cast<__m128i*>(p + 4 * ii);
+        const __m128i px = _mm_loadu_si128(ptr);
+        const __m128i rb = _mm_and_si128(px, mask), ga = _mm_and_si128(_mm_srli_epi32(px, 8), mask);
+
+        __m128i c[3];
+        for(int cc = 0; cc < 3; ++cc) {
+          __m128i v = _mm_add_epi32(_mm_madd_epi16(rb, hv.rb[cc]), _mm_madd_epi16(ga, hv.ga[cc]));
+          c[cc] = _mm_srai_epi32(_mm_add_epi32(v, round), 12);
+        }
+
+        // planar R G B A bytes, saturated, then interleaved again
+        const __m128i x = _mm_packus_epi16(_mm_packs_epi32(c[0], c[1]), _mm_packs_epi32(c[2], _mm_srli_epi32(px, 24)));
+        const __m128i rg = _mm_unpacklo_epi8(x, _mm_srli_si128(x, 4));
+        const __m128i ba = _mm_unpacklo_epi8(_mm_srli_si128(x, 8), _mm_srli_si128(x, 12));
+        _mm_storeu_si128(ptr, _mm_unpacklo_epi16(rg, ba));
+      }
+      return ii;
+    }
+
+    size_t invert_sse2(uint8_t* p, size_t count) noexcept {
+      const __m128i mask = _mm_set1_epi32(0x00FFFFFF);
+
+      size_t ii = 0;
+      for(; ii + 4 <= count; ii += 4) {
+        auto ptr = reinterpret_cast<__m128i*>(p + 4 * ii);
+        _mm_storeu_si128(ptr, _mm_xor_si128(_mm_loadu_si128(ptr), mask));
+      }
+      return ii;
+    }
+
+    size_t blur_column_step_sse2(uint32_t* sums, const uint8_t* add, const uint8_t* sub, uint8_t* out, size_t n,
+                                 float inv) noexcept {
+      const __m128i zero = _mm_setzero_si128();
+      const __m128 scale = _mm_set1_ps(inv);
+
+      size_t ii = 0;
+      for(; ii + 16 <= n; ii += 16) {
+        auto s = reinterpret_cast<__m128i*>(sums + ii);
+
+        __m128i v[4];
+        for(int jj = 0; jj < 4; ++jj)
+          v[jj] = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128(s + jj)), scale));
+        const __m128i o = _mm_packus_epi16(_mm_packs_epi32(v[0], v[1]), _mm_packs_epi32(v[2], v[3]));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + ii), o);
+
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(add + ii));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sub + ii));
+        const __m128i a16[2] = {_mm_unpacklo_epi8(a, zero), _mm_unpackhi_epi8(a, zero)};
+        const __m128i b16[2] = {_mm_unpacklo_epi8(b, zero), _mm_unpackhi_epi8(b, zero)};
+        for(int jj = 0; jj < 2; ++jj) {
+          const __m128i d[2] = {_mm_sub_epi32(_mm_unpacklo_epi16(a16[jj], zero), _mm_unpacklo_epi16(b16[jj], zero)),
+                                _mm_sub_epi32(_mm_unpackhi_epi16(a16[jj], zero), _mm_unpackhi_epi16(b16[jj], zero))};
+          _mm_storeu_si128(s + 2 * jj, _mm_add_epi32(_mm_loadu_si128(s + 2 * jj), d[0]));
+          _mm_storeu_si128(s + 2 * jj + 1, _mm_add_epi32(_mm_loadu_si128(s + 2 * jj + 1), d[1]));
+        }
+      }
+      return ii;
+    }
+
+
+    /* AVX2 */
+
+    bool has_avx2() noexcept {
+      static const bool s_Supported = (__builtin_cpu_init(), __builtin_cpu_supports("avx2") != 0);
+      return s_Supported;
+    }
+
+    __attribute__((target("avx2"))) inline __m256i tone_half_avx2(__m256i v, __m256i w, __m256i g,
+                                                                   __m256i t) noexcept {
+      __m256i m = _mm256_madd_epi16(v, w);
+      m = _mm256_add_epi32(m, _mm256_shuffle_epi32(m, _MM_SHUFFLE(2, 3, 0, 1)));
+      __m256i lum = _mm256_srli_epi32(m, 8);
+      lum = _mm256_packs_epi32(lum, lum);
+      lum = _mm256_unpacklo_epi16(lum, lum);
+
+      __m256i d = _mm256_srai_epi16(_mm256_mullo_epi16(_mm256_sub_epi16(lum, v), g), 7);
+      return _mm256_add_epi16(_mm256_add_epi16(v, d), t);
+    }
+
+    __attribute__((target("avx2"))) size_t tone_avx2(uint8_t* p, size_t count, const Tone& t) noexcept {
+      const __m256i zero = _mm256_setzero_si256();
+      const __m256i w = _mm256_setr_epi16(k_LumR, k_LumG, k_LumB, 0, k_LumR, k_LumG, k_LumB, 0, k_LumR, k_LumG,
+                                          k_LumB, 0, k_LumR, k_LumG, k_LumB, 0);
+      const __m256i g = _mm256_setr_epi16(t.gray, t.gray, t.gray, 0, t.gray, t.gray, t.gray, 0, t.gray, t.gray,
+                                          t.gray, 0, t.gray, t.gray, t.gray, 0);
+      const __m256i a = _mm256_setr_epi16(t.red, t.green, t.blue, 0, t.red, t.green, t.blue, 0, t.red, t.green,
+                                          t.blue, 0, t.red, t.green, t.blue, 0);
+
+      size_t ii = 0;
+      for(; ii + 8 <= count; ii += 8) {
+        auto ptr = reinterpret_cast<__m256i*>(p + 4 * ii);
+        const __m256i px = _mm256_loadu_si256(ptr);
+        const __m256i lo = tone_half_avx2(_mm256_unpacklo_epi8(px, zero), w, g, a);
+        const __m256i hi = tone_half_avx2(_mm256_unpackhi_epi8(px, zero), w, g, a);
+        _mm256_storeu_si256(ptr, _mm256_packus_epi16(lo, hi));
+      }
+      return ii;
+    }
+
+    __attribute__((target("avx2"))) size_t hue_avx2(uint8_t* p, size_t count, const HueMatrix& h) noexcept {
+      __m256i rbc[3], gac[3];
+      for(int cc = 0; cc < 3; ++cc) {
+        rbc[cc] = _mm256_set1_epi32(int(uint16_t(h.m[cc][0])) | (int(h.m[cc][2]) << 16));
+        gac[cc] = _mm256_set1_epi32(int(uint16_t(h.m[cc][1])));
+      }
+      const __m256i mask = _mm256_set1_epi32(0x00FF00FF), round = _mm256_set1_epi32(2048);
+
+      size_t ii = 0;
+      for(; ii + 8 <= count; ii += 8) {
+        auto ptr = reinterpret_cast<__m256i*>(p + 4 * ii);
+        const __m256i px = _mm256_loadu_si256(ptr);
+        const __m256i rb = _mm256_and_si256(px, mask), ga = _mm256_and_si256(_mm256_srli_epi32(px, 8), mask);
+
+        __m256i c[3];
+        for(int cc = 0; cc < 3; ++cc) {
+          __m256i v = _mm256_add_epi32(_mm256_madd_epi16(rb, rbc[cc]), _mm256_madd_epi16(ga, gac[cc]));
+          c[cc] = _mm256_srai_epi32(_mm256_add_epi32(v, round), 12);
+        }
+
+        // everything below stays within 128-bit lanes, four pixels each
+        const __m256i x = _mm256_packus_epi16(_mm256_packs_epi32(c[0], c[1]),
+                                              _mm256_packs_epi32(c[2], _mm256_srli_epi32(px, 24)));
+        const __m256i rg = _mm256_unpacklo_epi8(x, _mm256_bsrli_epi128(x, 4));
+        const __m256i ba = _mm256_unpacklo_epi8(_mm256_bsrli_epi128(x, 8), _mm256_bsrli_epi128(x, 12));
+        _mm256_storeu_si256(ptr, _mm256_unpacklo_epi16(rg, ba));
+      }
+      return ii;
+    }
+
+    __attribute__((target("avx2"))) size_t invert_avx2(uint8_t* p, size_t count) noexcept {
+      const __m256i mask = _mm256_set1_epi32(0x00FFFFFF);
+
+      size_t ii = 0;
+      for(; ii + 8 <= count; ii += 8) {
+        auto ptr = reinterpret_cast<__m256i*>(p + 4 * ii);
+        _mm256_storeu_si256(ptr, _mm256_xor_si256(_mm256_loadu_si256(ptr), mask));
+      }
+      return ii;
+    }
+#endif
+
+
+    void blur_rows(const uint8_t* src, uint8_t* dst, size_t width, size_t height, size_t radius, float inv) noexcept {
+      // the horizontal window slides along the row, so this pass is scalar at every level
+      for(size_t y = 0; y < height; ++y) {
+        const uint8_t* s = src + 4 * width * y;
+        uint8_t* d = dst + 4 * width * y;
+
+        for(size_t cc = 0; cc < 4; ++cc) {
+          uint32_t sum = uint32_t(radius + 1) * s[cc];
+          for(size_t ii = 1; ii <= radius; ++ii)
+            sum += s[4 * std::min(ii, width - 1) + cc];
+
+          for(size_t x = 0; x < width; ++x) {
+            d[4 * x + cc] = uint8_t(std::nearbyint(float(sum) * inv));
+            sum += s[4 * std::min(x + radius + 1, width - 1) + cc];
+            sum -= s[4 * (x >= radius ? x - radius : 0) + cc];
+          }
+        }
+      }
+    }
+  }    // namespace
+}    // namespace tktk::kernels
+
+tktk::kernels::Level tktk::kernels::best_level() noexcept {
+#if defined(TKTK_HAVE_SSE)
+  return (has_avx2() ? Level::eAvx2 : Level::eSse2);
+#else
+  return Level::eScalar;
+#endif
+}
+
+void tktk::kernels::change_tone(uint8_t* pixels, size_t count, int red, int green, int blue, int gray,
+                                Level level) noexcept {
+  gray = std::clamp(gray, 0, 255);
+  const Tone t{std::clamp(red, -255, 255), std::clamp(green, -255, 255), std::clamp(blue, -255, 255),
+               (gray * 128 + 127) / 255};
+
+  size_t done = 0;
+#if defined(TKTK_HAVE_SSE)
+  if(level == Level::eAvx2)
+    done = tone_avx2(pixels, count, t);
+  else if(level == Level::eSse2)
+    done = tone_sse2(pixels, count, t);
+#endif
+
+  tone_scalar(pixels + 4 * done, count - done, t);
+}
+
+void tktk::kernels::change_hue(uint8_t* pixels, size_t count, int degrees, Level level) noexcept {
+  const HueMatrix h = hue_matrix(degrees);
+
+  size_t done = 0;
+#if defined(TKTK_HAVE_SSE)
+  if(level == Level::eAvx2)
+    done = hue_avx2(pixels, count, h);
+  else if(level == Level::eSse2)
+    done = hue_sse2(pixels, count, h);
+#endif
+
+  hue_scalar(pixels + 4 * done, count - done, h);
+}
+
+void tktk::kernels::invert(uint8_t* pixels, size_t count, Level level) noexcept {
+  size_t done = 0;
+#if defined(TKTK_HAVE_SSE)
+  if(level == Level::eAvx2)
+    done = invert_avx2(pixels, count);
+  else if(level == Level::eSse2)
+    done = invert_sse2(pixels, count);
+#endif
+
+  invert_scalar(pixels + 4 * done, count - done);
+}
+
+bool tktk::kernels::blur(uint8_t* pixels, size_t width, size_t height, size_t radius, Level level) noexcept {
+  if(radius == 0 || width == 0 || height == 0)
+    return true;
+
+  const size_t rowBytes = 4 * width;
+  std::unique_ptr<uint8_t[]> rows{new(std::nothrow) uint8_t[rowBytes * height]};
+  std::unique_ptr<uint32_t[]> sums{new(std::nothrow) uint32_t[rowBytes]};
+  if(!rows || !sums)
+    return false;
+
+  const float inv = 1.0f / float(2 * radius + 1);
+  blur_rows(pixels, rows.get(), width, height, radius, inv);
+
+  // vertical pass from the horizontally blurred rows back into pixels, all columns at once
+  auto row = [&](size_t y) { return rows.get() + rowBytes * y; };
+  for(size_t ii = 0; ii < rowBytes; ++ii) {
+    uint32_t sum = uint32_t(radius + 1) * row(0)[ii];
+    for(size_t yy = 1; yy <= radius; ++yy)
+      sum += row(std::min(yy, height - 1))[ii];
+    sums[ii] = sum;
+  }
+
+  for(size_t y = 0; y < height; ++y) {
+    const uint8_t* add = row(std::min(y + radius + 1, height - 1));
+    const uint8_t* sub = row(y >= radius ? y - radius : 0);
+    uint8_t* out = pixels + rowBytes * y;
+
+    size_t done = 0;
+#if defined(TKTK_HAVE_SSE)
+    if(level != Level::eScalar)
+      done = blur_column_step_sse2(sums.get(), add, sub, out, rowBytes, inv);
+#endif
+
+    blur_column_step_scalar(sums.get() + done, add + done, sub + done, out + done, rowBytes - done, inv);
+  }
+
+  return true;
+}
+
+void tktk::kernels::mosaic(uint8_t* pixels, size_t width, size_t x, size_t y, size_t rectWidth, size_t rectHeight,
+                           size_t size) noexcept {
+  const size_t rowBytes = 4 * width;
+
+  for(size_t cy = y; cy < y + rectHeight; cy += size) {
+    const size_t ch = std::min(size, y + rectHeight - cy);
+
+    for(size_t cx = x; cx < x + rectWidth; cx += size) {
+      const size_t cw = std::min(size, x + rectWidth - cx);
+      const size_t n = cw * ch;
+
+      // a cell may cover the whole bitmap: 255 * width * height doesn't fit 32 bits beyond about 16M pixels
+      uint64_t sum[4] = {};
+      for(size_t yy = cy; yy < cy + ch; ++yy) {
+        const uint8_t* p = pixels + rowBytes * yy + 4 * cx;
+        for(size_t xx = 0; xx < cw; ++xx, p += 4) {
+          for(int cc = 0; cc < 4; ++cc)
+            sum[cc] += p[cc];
+        }
+      }
+
+      uint8_t avg[4];
+      for(int cc = 0; cc < 4; ++cc)
+        avg[cc] = uint8_t((sum[cc] + n / 2) / n);
+
+      uint32_t fill;
+      std::memcpy(&fill, avg, sizeof(fill));
+      for(size_t yy = cy; yy < cy + ch; ++yy) {
+        uint8_t* p = pixels + rowBytes * yy + 4 * cx;
+        for(size_t xx = 0; xx < cw; ++xx, p += 4)
+          std::memcpy(p, &fill, sizeof(fill));
+      }
+    }
+  }
+}
@@ -0,0 +1,53 @@
+#ifndef TKTK_BITMAP_KERNELS_HPP
+#define TKTK_BITMAP_KERNELS_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Per-pixel operations on tightly packed RGBA8 rows. Each of them has a scalar reference implementation and SSE2/AVX2
+ * versions which give exactly the same results; the fastest one this CPU supports is picked on first use. The colour
+ * operations leave alpha alone, blur and mosaic average it like the other channels.
+ */
+namespace tktk::kernels {
+  enum class Level {
+    eScalar,
+    eSse2,
+    eAvx2,
+  };
+
+  Level best_level() noexcept;
+
+  // red, green, blue in [-255, 255] are added after desaturating by gray in [0, 255], like RGSS tones
+  void change_tone(uint8_t* pixels, size_t count, int red, int green, int blue, int gray, Level level) noexcept;
+
+  // rotates the hue around the gray axis by degrees
+  void change_hue(uint8_t* pixels, size_t count, int degrees, Level level) noexcept;
+
+  void invert(uint8_t* pixels, size_t count, Level level) noexcept;
+
+  // separable box blur with the given radius, clamping at the edges
+  bool blur(uint8_t* pixels, size_t width, size_t height, size_t radius, Level level) noexcept;
+
+  // fills every size x size cell of the rectangle with the cell's average colour
+  void mosaic(uint8_t* pixels, size_t width, size_t x, size_t y, size_t rectWidth, size_t rectHeight,
+              size_t size) noexcept;
+
+  inline void change_tone(uint8_t* pixels, size_t count, int red, int green, int blue, int gray) noexcept {
+    change_tone(pixels, count, red, green, blue, gray, best_level());
+  }
+
+  inline void change_hue(uint8_t* pixels, size_t count, int degrees) noexcept {
+    change_hue(pixels, count, degrees, best_level());
+  }
+
+  inline void invert(uint8_t* pixels, size_t count) noexcept {
+    invert(pixels, count, best_level());
+  }
+
+  inline bool blur(uint8_t* pixels, size_t width, size_t height, size_t radius) noexcept {
+    return blur(pixels, width, height, radius, best_level());
+  }
+}    // namespace tktk::kernels
+
+#endif    //TKTK_BITMAP_KERNELS_HPP
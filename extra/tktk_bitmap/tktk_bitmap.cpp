@@ -0,0 +1,120 @@
+#include "tktk_bitmap.h"
+
+#include <csetjmp>
+#include <cstdio>
+
+#include <algorithm>
+
+#include <png.h>
+
+#include "kernels.hpp"
+
+namespace tktk {
+  namespace {
+    enum Result : int {
+      eOk            = 0,
+      eBadParameter  = -1,
+      eOutOfMemory   = -2,
+      eWriteFailed   = -3,
+    };
+
+    // the largest side the kernels accept; keeps width * height * 4 and the blur sums well within range
+    constexpr int k_MaxSide = 1 << 14;
+
+    inline bool valid(const BYTE* pixels, int width, int height) noexcept {
+      return pixels && width > 0 && height > 0 && width <= k_MaxSide && height <= k_MaxSide;
+    }
+
+    inline size_t pixel_count(int width, int height) noexcept {
+      return size_t(width) * size_t(height);
+    }
+
+    bool write_png(FILE* fp, const BYTE* pixels, int width, int height, int compressionLevel) {
+      png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+      png_infop info = (png ? png_create_info_struct(png) : nullptr);
+
+      if(!info || setjmp(png_jmpbuf(png))) {
+        png_destroy_write_struct(&png, &info);
+        return false;
+      }
+
+      png_init_io(png, fp);
+      png_set_compression_level(png, compressionLevel);
+
+      png_set_IHDR(png, info, width, height, 8, PNG_COLOR_TYPE_RGB_ALPHA, PNG_INTERLACE_NONE,
+                   PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+      png_write_info(png, info);
+
+      for(int y = 0; y < height; ++y)
+        png_write_row(png, pixels + 4 * size_t(width) * y);
+
+      png_write_end(png, nullptr);
+      png_destroy_write_struct(&png, &info);
+      return true;
+    }
+  }    // namespace
+}    // namespace tktk
+
+using namespace tktk;
+
+int tktk_bitmap_ChangeTone(BYTE* pixels, int width, int height, int red, int green, int blue, int gray) {
+  if(!valid(pixels, width, height))
+    return eBadParameter;
+
+  kernels::change_tone(pixels, pixel_count(width, height), red, green, blue, gray);
+  return eOk;
+}
+
+int tktk_bitmap_ChangeHue(BYTE* pixels, int width, int height, int hue) {
+  if(!valid(pixels, width, height))
+    return eBadParameter;
+
+  kernels::change_hue(pixels, pixel_count(width, height), hue);
+  return eOk;
+}
+
+int tktk_bitmap_InvertColor(BYTE* pixels, int width, int height) {
+  if(!valid(pixels, width, height))
+    return eBadParameter;
+
+  kernels::invert(pixels, pixel_count(width, height));
+  return eOk;
+}
+
+int tktk_bitmap_Blur(BYTE* pixels, int width, int height, int radius) {
+  if(!valid(pixels, width, height) || radius < 0)
+    return eBadParameter;
+
+  // a wider window than the bitmap only averages in more copies of the edges
+  radius = std::min(radius, k_MaxSide);
+
+  return (kernels::blur(pixels, width, height, radius) ? eOk : eOutOfMemory);
+}
+
+int tktk_bitmap_Mosaic(BYTE* pixels, int width, int height, int x, int y, int rectWidth, int rectHeight, int size) {
+  if(!valid(pixels, width, height) || rectWidth < 0 || rectHeight < 0 || size <= 0)
+    return eBadParameter;
+
+  const int left = std::clamp(x, 0, width), right = int(std::clamp<long>(long(x) + rectWidth, 0, width));
+  const int top = std::clamp(y, 0, height), bottom = int(std::clamp<long>(long(y) + rectHeight, 0, height));
+  if(left < right && top < bottom)
+    kernels::mosaic(pixels, width, left, top, right - left, bottom - top, size);
+
+  return eOk;
+}
+
+int tktk_bitmap_PngSaveA(LPCSTR fileName, const BYTE* pixels, int width, int height, int compressionLevel) {
+  if(!fileName || !valid(pixels, width, height) || compressionLevel < -1 || compressionLevel > 9)
+    return eBadParameter;
+
+  FILE* fp = std::fopen(fileName, "wb");
+  if(!fp)
+    return eWriteFailed;
+
+  bool ok = write_png(fp, pixels, width, height, compressionLevel);
+  ok = (std::fclose(fp) == 0) && ok;
+  if(!ok)
+    std::remove(fileName);
+
+  return (ok ? eOk : eWriteFailed);
+}
@@ -1 +1,32 @@
-// empty
\ No newline at end of file
+#ifndef TKTK_BITMAP_H
+#define TKTK_BITMAP_H
+
+#include "wintypes.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * The original library reads the pixels of an RGSS Bitmap straight out of the interpreter through its object id,
+ * which can't work with mkxp. These take the pixels instead, as width * height tightly packed RGBA8 values (what
+ * Bitmap#raw_data gives), and change them in place. All of them return 0 on success and a negative value on error:
+ * -1 for bad parameters, -2 if memory ran out and -3 if the file could not be written.
+ */
+WIN32_API int tktk_bitmap_ChangeTone(BYTE* pixels, int width, int height, int red, int green, int blue, int gray);
+WIN32_API int tktk_bitmap_ChangeHue(BYTE* pixels, int width, int height, int hue);
+WIN32_API int tktk_bitmap_InvertColor(BYTE* pixels, int width, int height);
+WIN32_API int tktk_bitmap_Blur(BYTE* pixels, int width, int height, int radius);
+WIN32_API int tktk_bitmap_Mosaic(BYTE* pixels, int width, int height, int x, int y, int rectWidth, int rectHeight,
+                                 int size);
+
+/*
+ * compressionLevel is a zlib level from 0 to 9, or -1 for the default.
+ */
+WIN32_API int tktk_bitmap_PngSaveA(LPCSTR fileName, const BYTE* pixels, int width, int height, int compressionLevel);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef WIN32API_KEYCACHE_HPP
+#define WIN32API_KEYCACHE_HPP
+
+#include <strings.h>
+
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <buffer/buffer_view.hpp>
+
+#include "rijndael.hpp"
+
+namespace wflib {
+  /*
+   * Small most-recently-used list of expanded keys. Games encrypt every save slot (and some every packet) with the
+   * same key, so nearly every call after the first one skips key expansion.
+   */
+  class KeyCache {
+   public:
+    static constexpr size_t k_Capacity = 8;
+
+    std::shared_ptr<const rijndael::Context> acquire(uint32_t nb, buffer::byte_buffer_view key) {
+      std::lock_guard lock{m_Mutex};
+
+      auto it = std::find_if(m_Entries.begin(), m_Entries.end(), [nb, key](const Entry& e) {
+        return e.nb == nb && e.keySize == key.size() && std::memcmp(e.key, key.data(), key.size()) == 0;
+      });
+
+      if(it != m_Entries.end()) {
+        std::rotate(m_Entries.begin(), it, it + 1);
+        return m_Entries.front().context;
+      }
+
+      if(m_Entries.size() == k_Capacity)
+        m_Entries.pop_back();
+
+      auto context = std::make_shared<const rijndael::Context>(nb, key);
+      m_Entries.emplace(m_Entries.begin(), nb, key, context);
+      return context;
+    }
+
+   private:
+    struct Entry {
+      Entry(uint32_t nb, buffer::byte_buffer_view key, std::shared_ptr<const rijndael::Context> context) noexcept
+          : nb{nb}, keySize{static_cast<uint32_t>(key.size())}, key{}, context{std::move(context)} {
+        std::memcpy(this->key, key.data(), key.size());
+      }
+
+      Entry(Entry&& other) noexcept : nb{other.nb}, keySize{other.keySize}, key{}, context{std::move(other.context)} {
+        std::memcpy(key, other.key, sizeof(key));
+      }
+
+      Entry& operator=(Entry&& other) noexcept {
+        nb = other.nb;
+        keySize = other.keySize;
+        std::memcpy(key, other.key, sizeof(key));
+        context = std::move(other.context);
+        return *this;
+      }
+
+      ~Entry() {
+        explicit_bzero(key, sizeof(key));
+      }
+
+      uint32_t nb, keySize;
+      uint8_t key[32];
+      std::shared_ptr<const rijndael::Context> context;
+    };
+
+    std::mutex m_Mutex;
+    std::vector<Entry> m_Entries;
+  };
+}    // namespace wflib
+
+#endif    //WIN32API_KEYCACHE_HPP
@@ -11,6 +11,8 @@
 
 #include <buffer/static_buffer.hpp>
 
+#include "rijndael_aesni.hpp"
+#include "rijndael_bitsliced.hpp"
 #include "utils.h"
 
 
@@ -124,6 +126,41 @@ namespace rijndael {
       }
 
       constexpr std::array<uint8_t, 256> k_RCon = generate_rcon_table();
+
+
+      // T-tables: SubBytes and MixColumns of one state byte at once, for each of the four rows
+      template <uint32_t Row>
+      constexpr std::array<uint32_t, 256> generate_encryption_table() noexcept {
+        std::array<uint32_t, 256> tab{};
+        for(uint32_t ii = 0; ii < 256; ++ii) {
+          uint8_t s = k_SBox[ii];
+          uint32_t col = bytes::concat4(k_GaloisMultiplication[2 * 256 + s], s, s, k_GaloisMultiplication[3 * 256 + s]);
+          tab[ii] = bits::rotl(col, 8 * Row);
+        }
+        return tab;
+      }
+
+      template <uint32_t Row>
+      constexpr std::array<uint32_t, 256> generate_decryption_table() noexcept {
+        std::array<uint32_t, 256> tab{};
+        for(uint32_t ii = 0; ii < 256; ++ii) {
+          uint8_t s = k_RSBox[ii];
+          uint32_t col = bytes::concat4(k_GaloisMultiplication[14 * 256 + s], k_GaloisMultiplication[9 * 256 + s],
+                                        k_GaloisMultiplication[13 * 256 + s], k_GaloisMultiplication[11 * 256 + s]);
+          tab[ii] = bits::rotl(col, 8 * Row);
+        }
+        return tab;
+      }
+
+      alignas(64) constexpr std::array<uint32_t, 256> k_Te0 = generate_encryption_table<0>();
+      alignas(64) constexpr std::array<uint32_t, 256> k_Te1 = generate_encryption_table<1>();
+      alignas(64) constexpr std::array<uint32_t, 256> k_Te2 = generate_encryption_table<2>();
+      alignas(64) constexpr std::array<uint32_t, 256> k_Te3 = generate_encryption_table<3>();
+
+      alignas(64) constexpr std::array<uint32_t, 256> k_Td0 = generate_decryption_table<0>();
+      alignas(64) constexpr std::array<uint32_t, 256> k_Td1 = generate_decryption_table<1>();
+      alignas(64) constexpr std::array<uint32_t, 256> k_Td2 = generate_decryption_table<2>();
+      alignas(64) constexpr std::array<uint32_t, 256> k_Td3 = generate_decryption_table<3>();
     }    // namespace tables
 
     void key_expand(const buffer::byte_buffer_span expanded, const buffer::byte_buffer_view key) noexcept {
@@ -267,28 +304,208 @@ namespace rijndael {
 
       std::transform(state.begin(), state.end(), state.begin(), [](uint8_t b) { return tables::k_RSBox[b]; });
     }
+
+
+    inline uint32_t load_column(const uint8_t* p) noexcept {
+      return bytes::concat4(p[0], p[1], p[2], p[3]);
+    }
+
+    inline void store_column(uint8_t* p, uint32_t col) noexcept {
+      p[0] = bytes::int32::lls(col);
+      p[1] = bytes::int32::ls(col);
+      p[2] = bytes::int32::ms(col);
+      p[3] = bytes::int32::mms(col);
+    }
+
+    // ShiftRows offset of each row
+    template <uint32_t Nb>
+    constexpr uint32_t k_Shift[4] = {0, 1, (Nb < 8 ? 2 : 3), (Nb < 8 ? 3 : 4)};
+
+    template <uint32_t Nb>
+    void table_encrypt(const uint32_t* rk, uint32_t nr, uint8_t* block) noexcept {
+      constexpr uint32_t c1 = k_Shift<Nb>[1], c2 = k_Shift<Nb>[2], c3 = k_Shift<Nb>[3];
+
+      uint32_t s[Nb], t[Nb];
+      for(uint32_t jj = 0; jj < Nb; ++jj)
+        s[jj] = load_column(block + sizeof(uint32_t) * jj) ^ rk[jj];
+
+      for(uint32_t round = 1; round < nr; ++round) {
+        rk += Nb;
+        for(uint32_t jj = 0; jj < Nb; ++jj) {
+          t[jj] = tables::k_Te0[bytes::int32::lls(s[jj])] ^ tables::k_Te1[bytes::int32::ls(s[(jj + c1) % Nb])] ^
+                  tables::k_Te2[bytes::int32::ms(s[(jj + c2) % Nb])] ^
+                  tables::k_Te3[bytes::int32::mms(s[(jj + c3) % Nb])] ^ rk[jj];
+        }
+        std::copy(t, t + Nb, s);
+      }
+
+      rk += Nb;
+      for(uint32_t jj = 0; jj < Nb; ++jj) {
+        uint32_t col = bytes::concat4(tables::k_SBox[bytes::int32::lls(s[jj])],
+                                      tables::k_SBox[bytes::int32::ls(s[(jj + c1) % Nb])],
+                                      tables::k_SBox[bytes::int32::ms(s[(jj + c2) % Nb])],
+                                      tables::k_SBox[bytes::int32::mms(s[(jj + c3) % Nb])]);
+        store_column(block + sizeof(uint32_t) * jj, col ^ rk[jj]);
+      }
+    }
+
+    /*
+     * Lanes blocks go through the rounds in lockstep. Their table lookups are independent, so the loads of one block
+     * overlap with the dependency chain of the next instead of waiting on it.
+     */
+    template <uint32_t Nb, uint32_t Lanes = 1>
+    void table_decrypt(const uint32_t* dk, uint32_t nr, uint8_t* blocks) noexcept {
+      // InvShiftRows moves row r right by its offset, so output column j takes row r from column j - offset
+      constexpr uint32_t c1 = Nb - k_Shift<Nb>[1], c2 = Nb - k_Shift<Nb>[2], c3 = Nb - k_Shift<Nb>[3];
+      constexpr uint32_t k_BlockSize = sizeof(uint32_t) * Nb;
+
+      const uint32_t* rk = dk + Nb * nr;
+
+      uint32_t s[Lanes][Nb], t[Lanes][Nb];
+      for(uint32_t ll = 0; ll < Lanes; ++ll) {
+        for(uint32_t jj = 0; jj < Nb; ++jj)
+          s[ll][jj] = load_column(blocks + k_BlockSize * ll + sizeof(uint32_t) * jj) ^ rk[jj];
+      }
+
+      for(uint32_t round = nr - 1; round > 0; --round) {
+        rk -= Nb;
+        for(uint32_t ll = 0; ll < Lanes; ++ll) {
+          for(uint32_t jj = 0; jj < Nb; ++jj) {
+            t[ll][jj] = tables::k_Td0[bytes::int32::lls(s[ll][jj])] ^
+                        tables::k_Td1[bytes::int32::ls(s[ll][(jj + c1) % Nb])] ^
+                        tables::k_Td2[bytes::int32::ms(s[ll][(jj + c2) % Nb])] ^
+                        tables::k_Td3[bytes::int32::mms(s[ll][(jj + c3) % Nb])] ^ rk[jj];
+          }
+        }
+        std::copy(&t[0][0], &t[0][0] + Lanes * Nb, &s[0][0]);
+      }
+
+      rk -= Nb;
+      for(uint32_t ll = 0; ll < Lanes; ++ll) {
+        for(uint32_t jj = 0; jj < Nb; ++jj) {
+          uint32_t col = bytes::concat4(tables::k_RSBox[bytes::int32::lls(s[ll][jj])],
+                                        tables::k_RSBox[bytes::int32::ls(s[ll][(jj + c1) % Nb])],
+                                        tables::k_RSBox[bytes::int32::ms(s[ll][(jj + c2) % Nb])],
+                                        tables::k_RSBox[bytes::int32::mms(s[ll][(jj + c3) % Nb])]);
+          store_column(blocks + k_BlockSize * ll + sizeof(uint32_t) * jj, col ^ rk[jj]);
+        }
+      }
+    }
+
+    template <uint32_t Nb>
+    void table_decrypt_blocks(const uint32_t* dk, uint32_t nr, uint8_t* blocks, size_t count) noexcept {
+      // more lanes than this stop paying off for the wider blocks, whose states no longer fit in registers
+      constexpr uint32_t k_Lanes = 4;
+      constexpr uint32_t k_BlockSize = sizeof(uint32_t) * Nb;
+
+      for(; count >= k_Lanes; count -= k_Lanes, blocks += k_Lanes * k_BlockSize)
+        table_decrypt<Nb, k_Lanes>(dk, nr, blocks);
+      for(; count > 0; --count, blocks += k_BlockSize)
+        table_decrypt<Nb>(dk, nr, blocks);
+    }
   }    // namespace
 }    // namespace rijndael
 
-rijndael::Context::Context(uint32_t nb, buffer::byte_buffer_view key) noexcept
+rijndael::Implementation rijndael::best_implementation(uint32_t nb) noexcept {
+  if(nb == 4 && aesni::supported())
+    return Implementation::eAesNi;
+
+  return Implementation::eTable;
+}
+
+rijndael::Implementation rijndael::best_bulk_implementation(uint32_t nb) noexcept {
+  if(nb == 4 && aesni::supported())
+    return Implementation::eAesNi;
+  if(nb == 4)
+    return Implementation::eBitsliced;
+
+  return Implementation::eTable;
+}
+
+namespace rijndael {
+  namespace {
+    // falls back to the T-tables where the implementation doesn't handle the block size or the CPU
+    Implementation usable(Implementation impl, uint32_t nb) noexcept {
+      if(impl == Implementation::eAesNi && (nb != 4 || !aesni::supported()))
+        return Implementation::eTable;
+      if(impl == Implementation::eBitsliced && nb != 4)
+        return Implementation::eTable;
+      return impl;
+    }
+  }    // namespace
+}    // namespace rijndael
+
+rijndael::Context::Context(uint32_t nb, buffer::byte_buffer_view key, Implementation impl,
+                           Implementation bulkImpl) noexcept
     : m_Nb{nb},
       m_Nk{static_cast<uint32_t>(key.size() / sizeof(uint32_t))},
       m_Nr{std::max(m_Nb, m_Nk) + 6},
-      m_ExpandedKey{} {
+      m_Implementation{usable(impl, nb)},
+      m_BulkImplementation{usable(bulkImpl, nb)},
+      m_ExpandedKey{},
+      m_EncryptionKey{},
+      m_DecryptionKey{},
+      m_BitslicedKey{} {
   ASSUME(m_Nb == 4 || m_Nb == 6 || m_Nb == 8);
   ASSUME(key.size() % sizeof(uint32_t) == 0);
-  ASSUME(m_Nk == 4 || m_Nk == 6 || m_Nb == 8);
+  ASSUME(m_Nk == 4 || m_Nk == 6 || m_Nk == 8);
+
+  const buffer::byte_buffer_span expandedKey = buffer::to_byte_span(m_ExpandedKey).first(expandedKeySize());
+  key_expand(expandedKey, key);
+
+  for(uint32_t ii = 0; ii < m_Nb * (m_Nr + 1); ++ii)
+    m_EncryptionKey[ii] = load_column(m_ExpandedKey + sizeof(uint32_t) * ii);
 
-  key_expand(buffer::to_byte_span(m_ExpandedKey).first(expandedKeySize()), key);
+  std::copy(m_EncryptionKey, m_EncryptionKey + m_Nb * (m_Nr + 1), m_DecryptionKey);
+  for(uint32_t round = 1; round < m_Nr; ++round) {
+    buffer::static_byte_buffer<32> roundKeyBuf;
+    const buffer::byte_buffer_span roundKey = buffer::to_byte_span(roundKeyBuf).first(blockSize());
+
+    roundKey.copy_from(expandedKey.subspan(blockSize() * round, blockSize()));
+    inv_mix_columns(roundKey);
+
+    for(uint32_t jj = 0; jj < m_Nb; ++jj)
+      m_DecryptionKey[m_Nb * round + jj] = load_column(roundKey.data() + sizeof(uint32_t) * jj);
+
+    secure_zero(roundKey.data(), roundKey.size());
+  }
+
+  if(m_Implementation == Implementation::eBitsliced || m_BulkImplementation == Implementation::eBitsliced)
+    bitsliced::expand_key(m_EncryptionKey, m_Nr, m_BitslicedKey);
 }
 
 rijndael::Context::~Context() {
   secure_zero(m_ExpandedKey, sizeof(m_ExpandedKey));
+  secure_zero(m_EncryptionKey, sizeof(m_EncryptionKey));
+  secure_zero(m_DecryptionKey, sizeof(m_DecryptionKey));
+  secure_zero(m_BitslicedKey, sizeof(m_BitslicedKey));
 }
 
 void rijndael::Context::decrypt(buffer::byte_buffer_span block) const noexcept {
   ASSUME(block.size() == blockSize());
 
+  switch(m_Implementation) {
+    case Implementation::eAesNi:
+      return aesni::decrypt(m_DecryptionKey, m_Nr, block.data());
+
+    case Implementation::eBitsliced:
+      return bitsliced::decrypt_blocks(m_BitslicedKey, m_Nr, block.data(), 1);
+
+    case Implementation::eTable:
+      switch(m_Nb) {
+        case 4:
+          return table_decrypt<4>(m_DecryptionKey, m_Nr, block.data());
+        case 6:
+          return table_decrypt<6>(m_DecryptionKey, m_Nr, block.data());
+        case 8:
+          return table_decrypt<8>(m_DecryptionKey, m_Nr, block.data());
+      }
+      return;
+
+    case Implementation::eReference:
+      break;
+  }
+
   const buffer::byte_buffer_view expandedKey = buffer::to_byte_view(m_ExpandedKey);
 
   buffer::static_buffer<uint8_t, 32> stateBuf;
@@ -311,9 +528,66 @@ void rijndael::Context::decrypt(buffer::byte_buffer_span block) const noexcept {
   buffer::to_byte_span(state).copy_to(block);
 }
 
+void rijndael::Context::decrypt_blocks(buffer::byte_buffer_span blocks) const noexcept {
+  ASSUME(blocks.size() % blockSize() == 0);
+
+  if(m_BulkImplementation == Implementation::eAesNi)
+    return aesni::decrypt_blocks(m_DecryptionKey, m_Nr, blocks.data(), blocks.size() / blockSize());
+  // a lone block would cost the bitsliced implementation a whole batch
+  if(m_BulkImplementation == Implementation::eBitsliced && blocks.size() > blockSize())
+    return bitsliced::decrypt_blocks(m_BitslicedKey, m_Nr, blocks.data(), blocks.size() / blockSize());
+
+  if(m_BulkImplementation == Implementation::eTable) {
+    switch(m_Nb) {
+      case 4:
+        return table_decrypt_blocks<4>(m_DecryptionKey, m_Nr, blocks.data(), blocks.size() / blockSize());
+      case 6:
+        return table_decrypt_blocks<6>(m_DecryptionKey, m_Nr, blocks.data(), blocks.size() / blockSize());
+      case 8:
+        return table_decrypt_blocks<8>(m_DecryptionKey, m_Nr, blocks.data(), blocks.size() / blockSize());
+    }
+  }
+
+  while(!blocks.empty())
+    decrypt(blocks.take_first(blockSize()));
+}
+
+void rijndael::Context::encrypt_blocks(buffer::byte_buffer_span blocks) const noexcept {
+  ASSUME(blocks.size() % blockSize() == 0);
+
+  // a lone block would cost the bitsliced implementation a whole batch
+  if(m_BulkImplementation == Implementation::eBitsliced && blocks.size() > blockSize())
+    return bitsliced::encrypt_blocks(m_BitslicedKey, m_Nr, blocks.data(), blocks.size() / blockSize());
+
+  while(!blocks.empty())
+    encrypt(blocks.take_first(blockSize()));
+}
+
 void rijndael::Context::encrypt(buffer::byte_buffer_span block) const noexcept {
   ASSUME(block.size() == blockSize());
 
+  switch(m_Implementation) {
+    case Implementation::eAesNi:
+      return aesni::encrypt(m_EncryptionKey, m_Nr, block.data());
+
+    case Implementation::eBitsliced:
+      return bitsliced::encrypt_blocks(m_BitslicedKey, m_Nr, block.data(), 1);
+
+    case Implementation::eTable:
+      switch(m_Nb) {
+        case 4:
+          return table_encrypt<4>(m_EncryptionKey, m_Nr, block.data());
+        case 6:
+          return table_encrypt<6>(m_EncryptionKey, m_Nr, block.data());
+        case 8:
+          return table_encrypt<8>(m_EncryptionKey, m_Nr, block.data());
+      }
+      return;
+
+    case Implementation::eReference:
+      break;
+  }
+
   const buffer::byte_buffer_view expandedKey = buffer::to_byte_view(m_ExpandedKey);
 
   buffer::static_byte_buffer<32> stateBuf;
@@ -7,18 +7,54 @@
 #include <buffer/buffer_view.hpp>
 
 namespace rijndael {
+  enum class Implementation {
+    eReference,    // byte-wise, straight from the specification
+    eTable,        // 32-bit T-tables, any block size
+    eAesNi,        // AES-NI instructions, 16 byte blocks only
+    eBitsliced,    // constant-time boolean circuits over eight blocks at a time, 16 byte blocks only
+  };
+
+  /*
+   * Fastest implementation available on this CPU for the given block size.
+   */
+  Implementation best_implementation(uint32_t nb) noexcept;
+
+  /*
+   * Implementation for runs of blocks (decrypt_blocks and encrypt_blocks). Without AES-NI this is the bitsliced one for
+   * 16 byte blocks, which doesn't leak the key through cache timing on the bulk of the data.
+   */
+  Implementation best_bulk_implementation(uint32_t nb) noexcept;
+
   class Context {
    public:
-    Context(uint32_t nb, buffer::byte_buffer_view key) noexcept;
+    Context(uint32_t nb, buffer::byte_buffer_view key) noexcept
+        : Context{nb, key, best_implementation(nb), best_bulk_implementation(nb)} {}
+    Context(uint32_t nb, buffer::byte_buffer_view key, Implementation impl) noexcept : Context{nb, key, impl, impl} {}
+    Context(uint32_t nb, buffer::byte_buffer_view key, Implementation impl, Implementation bulkImpl) noexcept;
     ~Context();
 
     void decrypt(buffer::byte_buffer_span block) const noexcept;
     void encrypt(buffer::byte_buffer_span block) const noexcept;
 
+    /*
+     * Decrypt or encrypt consecutive independent blocks (ECB), several at a time where the implementation allows it.
+     * The span size must be a multiple of the block size.
+     */
+    void decrypt_blocks(buffer::byte_buffer_span blocks) const noexcept;
+    void encrypt_blocks(buffer::byte_buffer_span blocks) const noexcept;
+
     [[nodiscard]] uint32_t blockSize() const noexcept {
       return sizeof(uint32_t) * m_Nb;
     }
 
+    [[nodiscard]] Implementation implementation() const noexcept {
+      return m_Implementation;
+    }
+
+    [[nodiscard]] Implementation bulkImplementation() const noexcept {
+      return m_BulkImplementation;
+    }
+
    private:
     [[nodiscard]] uint32_t expandedKeySize() const noexcept {
       return sizeof(uint32_t) * m_Nb * (m_Nr + 1);
@@ -26,7 +62,16 @@ namespace rijndael {
 
 
     uint32_t m_Nb, m_Nk, m_Nr;
+    Implementation m_Implementation, m_BulkImplementation;
     uint8_t m_ExpandedKey[480];
+
+    // little-endian column words of the round keys; the decryption ones are for the equivalent inverse cipher, with
+    // InvMixColumns already applied to the inner round keys
+    alignas(64) uint32_t m_EncryptionKey[120];
+    alignas(64) uint32_t m_DecryptionKey[120];
+
+    // eight bit planes per round key, only filled in when either implementation is the bitsliced one
+    alignas(64) uint64_t m_BitslicedKey[8 * 15];
   };
 }    // namespace rijndael
 
@@ -0,0 +1,75 @@
+#include "rijndael_aesni.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#  include <immintrin.h>
+#  define WFCRYPT_HAVE_AESNI 1
+#endif
+
+namespace rijndael::aesni {
+#if defined(WFCRYPT_HAVE_AESNI)
+  bool supported() noexcept {
+    static const bool s_Supported = (__builtin_cpu_init(), __builtin_cpu_supports("aes") != 0);
+    return s_Supported;
+  }
+
+  __attribute__((target("aes,sse2"))) void encrypt(const uint32_t* roundKeys, uint32_t nr, uint8_t* block) noexcept {
+    auto rk = reinterpret_cast<const __m128i*>(roundKeys);
+
+    __m128i state = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block)), _mm_load_si128(rk));
+    for(uint32_t ii = 1; ii < nr; ++ii)
+      state = _mm_aesenc_si128(state, _mm_load_si128(rk + ii));
+    state = _mm_aesenclast_si128(state, _mm_load_si128(rk + nr));
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(block), state);
+  }
+
+  __attribute__((target("aes,sse2"))) void decrypt(const uint32_t* roundKeys, uint32_t nr, uint8_t* block) noexcept {
+    auto rk = reinterpret_cast<const __m128i*>(roundKeys);
+
+    __m128i state = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block)), _mm_load_si128(rk + nr));
+    for(uint32_t ii = nr - 1; ii > 0; --ii)
+      state = _mm_aesdec_si128(state, _mm_load_si128(rk + ii));
+    state = _mm_aesdeclast_si128(state, _mm_load_si128(rk));
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(block), state);
+  }
+
+  __attribute__((target("aes,sse2"))) void decrypt_blocks(const uint32_t* roundKeys, uint32_t nr, uint8_t* blocks,
+                                                          size_t count) noexcept {
+    constexpr size_t k_Lanes = 8;
+
+    auto rk = reinterpret_cast<const __m128i*>(roundKeys);
+    auto data = reinterpret_cast<__m128i*>(blocks);
+
+    size_t ii = 0;
+    for(; ii + k_Lanes <= count; ii += k_Lanes) {
+      __m128i state[k_Lanes];
+
+      const __m128i first = _mm_load_si128(rk + nr);
+      for(size_t ll = 0; ll < k_Lanes; ++ll)
+        state[ll] = _mm_xor_si128(_mm_loadu_si128(data + ii + ll), first);
+
+      for(uint32_t round = nr - 1; round > 0; --round) {
+        const __m128i key = _mm_load_si128(rk + round);
+        for(size_t ll = 0; ll < k_Lanes; ++ll)
+          state[ll] = _mm_aesdec_si128(state[ll], key);
+      }
+
+      const __m128i last = _mm_load_si128(rk);
+      for(size_t ll = 0; ll < k_Lanes; ++ll)
+        _mm_storeu_si128(data + ii + ll, _mm_aesdeclast_si128(state[ll], last));
+    }
+
+    for(; ii < count; ++ii)
+      decrypt(roundKeys, nr, blocks + 16 * ii);
+  }
+#else
+  bool supported() noexcept {
+    return false;
+  }
+
+  void encrypt(const uint32_t*, uint32_t, uint8_t*) noexcept {}
+  void decrypt(const uint32_t*, uint32_t, uint8_t*) noexcept {}
+  void decrypt_blocks(const uint32_t*, uint32_t, uint8_t*, size_t) noexcept {}
+#endif
+}    // namespace rijndael::aesni
@@ -0,0 +1,23 @@
+#ifndef WIN32API_RIJNDAEL_AESNI_HPP
+#define WIN32API_RIJNDAEL_AESNI_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * AES-NI rounds for 16 byte blocks. The round keys are the ones from the portable key schedule, in memory order, so
+ * every key length the portable code accepts works here too. Only call these if supported() returns true.
+ */
+namespace rijndael::aesni {
+  bool supported() noexcept;
+
+  void encrypt(const uint32_t* roundKeys, uint32_t nr, uint8_t* block) noexcept;
+
+  // roundKeys must be the equivalent inverse cipher keys (InvMixColumns applied to rounds 1 to nr - 1)
+  void decrypt(const uint32_t* roundKeys, uint32_t nr, uint8_t* block) noexcept;
+
+  // same as decrypt over count consecutive blocks, with eight of them in flight at a time
+  void decrypt_blocks(const uint32_t* roundKeys, uint32_t nr, uint8_t* blocks, size_t count) noexcept;
+}    // namespace rijndael::aesni
+
+#endif    //WIN32API_RIJNDAEL_AESNI_HPP
@@ -0,0 +1,446 @@
+/*
+ * The bit layout, the S-box circuit and the linear layers below are ported from aes_ct64 in BearSSL, which carries
+ * the following notice:
+ *
+ * Copyright (c) 2016 Thomas Pornin <pornin@bolet.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "rijndael_bitsliced.hpp"
+
+#include <strings.h>
+
+#include <cstring>
+
+#include <initializer_list>
+
+/*
+ * The S-box circuit is Boyar-Peralta's, as in BearSSL. Every operation stays within a 64-bit word, so the same code
+ * runs on plain words (four blocks) and on GCC vectors of them (four blocks per vector lane).
+ */
+namespace rijndael::bitsliced {
+  namespace {
+    using u64x2 = uint64_t __attribute__((vector_size(16)));
+
+    template <typename V>
+    inline void swap_bits(V& x, V& y, uint64_t cl, uint64_t ch, unsigned s) noexcept {
+      V a = x, b = y;
+      x = (a & cl) | ((b & cl) << s);
+      y = ((a & ch) >> s) | (b & ch);
+    }
+
+    // transposes between one block word per slot and one bit plane per slot
+    template <typename V>
+    void ortho(V* q) noexcept {
+      for(unsigned ii = 0; ii < 8; ii += 2)
+        swap_bits(q[ii], q[ii + 1], 0x5555555555555555, 0xAAAAAAAAAAAAAAAA, 1);
+
+      for(unsigned ii : {0, 1, 4, 5})
+        swap_bits(q[ii], q[ii + 2], 0x3333333333333333, 0xCCCCCCCCCCCCCCCC, 2);
+
+      for(unsigned ii = 0; ii < 4; ++ii)
+        swap_bits(q[ii], q[ii + 4], 0x0F0F0F0F0F0F0F0F, 0xF0F0F0F0F0F0F0F0, 4);
+    }
+
+    void interleave_in(uint64_t& q0, uint64_t& q1, const uint32_t* w) noexcept {
+      uint64_t x[4];
+      for(unsigned ii = 0; ii < 4; ++ii) {
+        x[ii] = w[ii];
+        x[ii] = (x[ii] | (x[ii] << 16)) & 0x0000FFFF0000FFFF;
+        x[ii] = (x[ii] | (x[ii] << 8)) & 0x00FF00FF00FF00FF;
+      }
+
+      q0 = x[0] | (x[2] << 8);
+      q1 = x[1] | (x[3] << 8);
+    }
+
+    void interleave_out(uint32_t* w, uint64_t q0, uint64_t q1) noexcept {
+      uint64_t x[4] = {q0 & 0x00FF00FF00FF00FF, q1 & 0x00FF00FF00FF00FF, (q0 >> 8) & 0x00FF00FF00FF00FF,
+                       (q1 >> 8) & 0x00FF00FF00FF00FF};
+      for(unsigned ii = 0; ii < 4; ++ii) {
+        x[ii] = (x[ii] | (x[ii] >> 8)) & 0x0000FFFF0000FFFF;
+        w[ii] = uint32_t(x[ii]) | uint32_t(x[ii] >> 16);
+      }
+    }
+
+    inline uint32_t load_le(const uint8_t* p) noexcept {
+      return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+    }
+
+    inline void store_le(uint8_t* p, uint32_t w) noexcept {
+      p[0] = uint8_t(w);
+      p[1] = uint8_t(w >> 8);
+      p[2] = uint8_t(w >> 16);
+      p[3] = uint8_t(w >> 24);
+    }
+
+    inline uint64_t& lane(uint64_t& v, unsigned) noexcept {
+      return v;
+    }
+
+    inline uint64_t lane(const u64x2& v, unsigned l) noexcept {
+      return v[l];
+    }
+
+    inline void set_lane(uint64_t& v, unsigned, uint64_t x) noexcept {
+      v = x;
+    }
+
+    inline void set_lane(u64x2& v, unsigned l, uint64_t x) noexcept {
+      v[l] = x;
+    }
+
+    // loads 4 * lanes blocks, lane l holding blocks 4l to 4l + 3
+    template <typename V, unsigned Lanes>
+    void load(V* q, const uint8_t* blocks) noexcept {
+      for(unsigned l = 0; l < Lanes; ++l) {
+        uint32_t w[16];
+        for(unsigned ii = 0; ii < 16; ++ii)
+          w[ii] = load_le(blocks + 64 * l + 4 * ii);
+
+        for(unsigned ii = 0; ii < 4; ++ii) {
+          uint64_t q0, q1;
+          interleave_in(q0, q1, w + 4 * ii);
+          set_lane(q[ii], l, q0);
+          set_lane(q[ii + 4], l, q1);
+        }
+      }
+
+      ortho(q);
+    }
+
+    template <typename V, unsigned Lanes>
+    void store(V* q, uint8_t* blocks) noexcept {
+      ortho(q);
+
+      for(unsigned l = 0; l < Lanes; ++l) {
+        uint32_t w[16];
+        for(unsigned ii = 0; ii < 4; ++ii)
+          interleave_out(w + 4 * ii, lane(q[ii], l), lane(q[ii + 4], l));
+
+        for(unsigned ii = 0; ii < 16; ++ii)
+          store_le(blocks + 64 * l + 4 * ii, w[ii]);
+      }
+    }
+
+    template <typename V>
+    void sub_bytes(V* q) noexcept {
+      const V x0 = q[7], x1 = q[6], x2 = q[5], x3 = q[4], x4 = q[3], x5 = q[2], x6 = q[1], x7 = q[0];
+
+      // top linear transformation
+      const V y14 = x3 ^ x5;
+      const V y13 = x0 ^ x6;
+      const V y9 = x0 ^ x3;
+      const V y8 = x0 ^ x5;
+      const V t0 = x1 ^ x2;
+      const V y1 = t0 ^ x7;
+      const V y4 = y1 ^ x3;
+      const V y12 = y13 ^ y14;
+      const V y2 = y1 ^ x0;
+      const V y5 = y1 ^ x6;
+      const V y3 = y5 ^ y8;
+      const V t1 = x4 ^ y12;
+      const V y15 = t1 ^ x5;
+      const V y20 = t1 ^ x1;
+      const V y6 = y15 ^ x7;
+      const V y10 = y15 ^ t0;
+      const V y11 = y20 ^ y9;
+      const V y7 = x7 ^ y11;
+      const V y17 = y10 ^ y11;
+      const V y19 = y10 ^ y8;
+      const V y16 = t0 ^ y11;
+      const V y21 = y13 ^ y16;
+      const V y18 = x0 ^ y16;
+
+      // non-linear section
+      const V t2 = y12 & y15;
+      const V t3 = y3 & y6;
+      const V t4 = t3 ^ t2;
+      const V t5 = y4 & x7;
+      const V t6 = t5 ^ t2;
+      const V t7 = y13 & y16;
+      const V t8 = y5 & y1;
+      const V t9 = t8 ^ t7;
+      const V t10 = y2 & y7;
+      const V t11 = t10 ^ t7;
+      const V t12 = y9 & y11;
+      const V t13 = y14 & y17;
+      const V t14 = t13 ^ t12;
+      const V t15 = y8 & y10;
+      const V t16 = t15 ^ t12;
+      const V t17 = t4 ^ t14;
+      const V t18 = t6 ^ t16;
+      const V t19 = t9 ^ t14;
+      const V t20 = t11 ^ t16;
+      const V t21 = t17 ^ y20;
+      const V t22 = t18 ^ y19;
+      const V t23 = t19 ^ y21;
+      const V t24 = t20 ^ y18;
+
+      const V t25 = t21 ^ t22;
+      const V t26 = t21 & t23;
+      const V t27 = t24 ^ t26;
+      const V t28 = t25 & t27;
+      const V t29 = t28 ^ t22;
+      const V t30 = t23 ^ t24;
+      const V t31 = t22 ^ t26;
+      const V t32 = t31 & t30;
+      const V t33 = t32 ^ t24;
+      const V t34 = t23 ^ t33;
+      const V t35 = t27 ^ t33;
+      const V t36 = t24 & t35;
+      const V t37 = t36 ^ t34;
+      const V t38 = t27 ^ t36;
+      const V t39 = t29 & t38;
+      const V t40 = t25 ^ t39;
+
+      const V t41 = t40 ^ t37;
+      const V t42 = t29 ^ t33;
+      const V t43 = t29 ^ t40;
+      const V t44 = t33 ^ t37;
+      const V t45 = t42 ^ t41;
+      const V z0 = t44 & y15;
+      const V z1 = t37 & y6;
+      const V z2 = t33 & x7;
+      const V z3 = t43 & y16;
+      const V z4 = t40 & y1;
+      const V z5 = t29 & y7;
+      const V z6 = t42 & y11;
+      const V z7 = t45 & y17;
+      const V z8 = t41 & y10;
+      const V z9 = t44 & y12;
+      const V z10 = t37 & y3;
+      const V z11 = t33 & y4;
+      const V z12 = t43 & y13;
+      const V z13 = t40 & y5;
+      const V z14 = t29 & y2;
+      const V z15 = t42 & y9;
+      const V z16 = t45 & y14;
+      const V z17 = t41 & y8;
+
+      // bottom linear transformation
+      const V t46 = z15 ^ z16;
+      const V t47 = z10 ^ z11;
+      const V t48 = z5 ^ z13;
+      const V t49 = z9 ^ z10;
+      const V t50 = z2 ^ z12;
+      const V t51 = z2 ^ z5;
+      const V t52 = z7 ^ z8;
+      const V t53 = z0 ^ z3;
+      const V t54 = z6 ^ z7;
+      const V t55 = z16 ^ z17;
+      const V t56 = z12 ^ t48;
+      const V t57 = t50 ^ t53;
+      const V t58 = z4 ^ t46;
+      const V t59 = z3 ^ t54;
+      const V t60 = t46 ^ t57;
+      const V t61 = z14 ^ t57;
+      const V t62 = t52 ^ t58;
+      const V t63 = t49 ^ t58;
+      const V t64 = z4 ^ t59;
+      const V t65 = t61 ^ t62;
+      const V t66 = z1 ^ t63;
+      const V s0 = t59 ^ t63;
+      const V s6 = t56 ^ ~t62;
+      const V s7 = t48 ^ ~t60;
+      const V t67 = t64 ^ t65;
+      const V s3 = t53 ^ t66;
+      const V s4 = t51 ^ t66;
+      const V s5 = t47 ^ t65;
+      const V s1 = t64 ^ ~s3;
+      const V s2 = t55 ^ ~t67;
+
+      q[7] = s0;
+      q[6] = s1;
+      q[5] = s2;
+      q[4] = s3;
+      q[3] = s4;
+      q[2] = s5;
+      q[1] = s6;
+      q[0] = s7;
+    }
+
+    // inverse of the S-box affine transformation (with its constant), which sandwiches the forward circuit
+    template <typename V>
+    void inv_affine(V* q) noexcept {
+      const V q0 = ~q[0], q1 = ~q[1], q2 = q[2], q3 = q[3], q4 = q[4], q5 = ~q[5], q6 = ~q[6], q7 = q[7];
+
+      q[7] = q1 ^ q4 ^ q6;
+      q[6] = q0 ^ q3 ^ q5;
+      q[5] = q7 ^ q2 ^ q4;
+      q[4] = q6 ^ q1 ^ q3;
+      q[3] = q5 ^ q0 ^ q2;
+      q[2] = q4 ^ q7 ^ q1;
+      q[1] = q3 ^ q6 ^ q0;
+      q[0] = q2 ^ q5 ^ q7;
+    }
+
+    template <typename V>
+    void inv_sub_bytes(V* q) noexcept {
+      inv_affine(q);
+      sub_bytes(q);
+      inv_affine(q);
+    }
+
+    template <typename V>
+    void shift_rows(V* q) noexcept {
+      for(unsigned ii = 0; ii < 8; ++ii) {
+        const V x = q[ii];
+        q[ii] = (x & 0x000000000000FFFF) | ((x & 0x00000000FFF00000) >> 4) | ((x & 0x00000000000F0000) << 12) |
+                ((x & 0x0000FF0000000000) >> 8) | ((x & 0x000000FF00000000) << 8) | ((x & 0xF000000000000000) >> 12) |
+                ((x & 0x0FFF000000000000) << 4);
+      }
+    }
+
+    template <typename V>
+    void inv_shift_rows(V* q) noexcept {
+      for(unsigned ii = 0; ii < 8; ++ii) {
+        const V x = q[ii];
+        q[ii] = (x & 0x000000000000FFFF) | ((x & 0x000000000FFF0000) << 4) | ((x & 0x00000000F0000000) >> 12) |
+                ((x & 0x000000FF00000000) << 8) | ((x & 0x0000FF0000000000) >> 8) | ((x & 0x000F000000000000) << 12) |
+                ((x & 0xFFF0000000000000) >> 4);
+      }
+    }
+
+    template <typename V>
+    inline V rotr32(V x) noexcept {
+      return (x << 32) | (x >> 32);
+    }
+
+    template <typename V>
+    void mix_columns(V* q) noexcept {
+      const V q0 = q[0], q1 = q[1], q2 = q[2], q3 = q[3], q4 = q[4], q5 = q[5], q6 = q[6], q7 = q[7];
+      const V r0 = (q0 >> 16) | (q0 << 48), r1 = (q1 >> 16) | (q1 << 48), r2 = (q2 >> 16) | (q2 << 48),
+              r3 = (q3 >> 16) | (q3 << 48), r4 = (q4 >> 16) | (q4 << 48), r5 = (q5 >> 16) | (q5 << 48),
+              r6 = (q6 >> 16) | (q6 << 48), r7 = (q7 >> 16) | (q7 << 48);
+
+      q[0] = q7 ^ r7 ^ r0 ^ rotr32(q0 ^ r0);
+      q[1] = q0 ^ r0 ^ q7 ^ r7 ^ r1 ^ rotr32(q1 ^ r1);
+      q[2] = q1 ^ r1 ^ r2 ^ rotr32(q2 ^ r2);
+      q[3] = q2 ^ r2 ^ q7 ^ r7 ^ r3 ^ rotr32(q3 ^ r3);
+      q[4] = q3 ^ r3 ^ q7 ^ r7 ^ r4 ^ rotr32(q4 ^ r4);
+      q[5] = q4 ^ r4 ^ r5 ^ rotr32(q5 ^ r5);
+      q[6] = q5 ^ r5 ^ r6 ^ rotr32(q6 ^ r6);
+      q[7] = q6 ^ r6 ^ r7 ^ rotr32(q7 ^ r7);
+    }
+
+    template <typename V>
+    void inv_mix_columns(V* q) noexcept {
+      const V q0 = q[0], q1 = q[1], q2 = q[2], q3 = q[3], q4 = q[4], q5 = q[5], q6 = q[6], q7 = q[7];
+      const V r0 = (q0 >> 16) | (q0 << 48), r1 = (q1 >> 16) | (q1 << 48), r2 = (q2 >> 16) | (q2 << 48),
+              r3 = (q3 >> 16) | (q3 << 48), r4 = (q4 >> 16) | (q4 << 48), r5 = (q5 >> 16) | (q5 << 48),
+              r6 = (q6 >> 16) | (q6 << 48), r7 = (q7 >> 16) | (q7 << 48);
+
+      q[0] = q5 ^ q6 ^ q7 ^ r0 ^ r5 ^ r7 ^ rotr32(q0 ^ q5 ^ q6 ^ r0 ^ r5);
+      q[1] = q0 ^ q5 ^ r0 ^ r1 ^ r5 ^ r6 ^ r7 ^ rotr32(q1 ^ q5 ^ q7 ^ r1 ^ r5 ^ r6);
+      q[2] = q0 ^ q1 ^ q6 ^ r1 ^ r2 ^ r6 ^ r7 ^ rotr32(q0 ^ q2 ^ q6 ^ r2 ^ r6 ^ r7);
+      q[3] = q0 ^ q1 ^ q2 ^ q5 ^ q6 ^ r0 ^ r2 ^ r3 ^ r5 ^ rotr32(q0 ^ q1 ^ q3 ^ q5 ^ q6 ^ q7 ^ r0 ^ r3 ^ r5 ^ r7);
+      q[4] = q1 ^ q2 ^ q3 ^ q5 ^ r1 ^ r3 ^ r4 ^ r5 ^ r6 ^ r7 ^ rotr32(q1 ^ q2 ^ q4 ^ q5 ^ q7 ^ r1 ^ r4 ^ r5 ^ r6);
+      q[5] = q2 ^ q3 ^ q4 ^ q6 ^ r2 ^ r4 ^ r5 ^ r6 ^ r7 ^ rotr32(q2 ^ q3 ^ q5 ^ q6 ^ r2 ^ r5 ^ r6 ^ r7);
+      q[6] = q3 ^ q4 ^ q5 ^ q7 ^ r3 ^ r5 ^ r6 ^ r7 ^ rotr32(q3 ^ q4 ^ q6 ^ q7 ^ r3 ^ r6 ^ r7);
+      q[7] = q4 ^ q5 ^ q6 ^ r4 ^ r6 ^ r7 ^ rotr32(q4 ^ q5 ^ q7 ^ r4 ^ r7);
+    }
+
+    template <typename V>
+    inline void add_round_key(V* q, const uint64_t* key) noexcept {
+      for(unsigned ii = 0; ii < 8; ++ii)
+        q[ii] ^= key[ii];
+    }
+
+    template <typename V, unsigned Lanes>
+    void encrypt_batch(const uint64_t* keys, uint32_t nr, uint8_t* blocks) noexcept {
+      V q[8];
+      load<V, Lanes>(q, blocks);
+
+      add_round_key(q, keys);
+      for(uint32_t round = 1; round < nr; ++round) {
+        sub_bytes(q);
+        shift_rows(q);
+        mix_columns(q);
+        add_round_key(q, keys + 8 * round);
+      }
+      sub_bytes(q);
+      shift_rows(q);
+      add_round_key(q, keys + 8 * nr);
+
+      store<V, Lanes>(q, blocks);
+    }
+
+    template <typename V, unsigned Lanes>
+    void decrypt_batch(const uint64_t* keys, uint32_t nr, uint8_t* blocks) noexcept {
+      V q[8];
+      load<V, Lanes>(q, blocks);
+
+      add_round_key(q, keys + 8 * nr);
+      for(uint32_t round = nr - 1; round > 0; --round) {
+        inv_shift_rows(q);
+        inv_sub_bytes(q);
+        add_round_key(q, keys + 8 * round);
+        inv_mix_columns(q);
+      }
+      inv_shift_rows(q);
+      inv_sub_bytes(q);
+      add_round_key(q, keys);
+
+      store<V, Lanes>(q, blocks);
+    }
+
+    using batch_fn = void (*)(const uint64_t*, uint32_t, uint8_t*) noexcept;
+
+    // full batches of eight in place; the remainder goes through a zero-padded copy
+    void for_batches(batch_fn wide, batch_fn narrow, const uint64_t* keys, uint32_t nr, uint8_t* blocks,
+                     size_t count) noexcept {
+      size_t ii = 0;
+      for(; ii + 8 <= count; ii += 8)
+        wide(keys, nr, blocks + 16 * ii);
+
+      if(ii == count)
+        return;
+
+      uint8_t tail[16 * 8] = {};
+      const size_t tailSize = 16 * (count - ii);
+      std::memcpy(tail, blocks + 16 * ii, tailSize);
+      (count - ii > 4 ? wide : narrow)(keys, nr, tail);
+      std::memcpy(blocks + 16 * ii, tail, tailSize);
+      explicit_bzero(tail, sizeof(tail));
+    }
+  }    // namespace
+}    // namespace rijndael::bitsliced
+
+void rijndael::bitsliced::expand_key(const uint32_t* roundKeys, uint32_t nr, uint64_t* bitslicedKeys) noexcept {
+  for(uint32_t round = 0; round <= nr; ++round) {
+    // the same round key for all four blocks of a word
+    uint64_t* q = bitslicedKeys + 8 * round;
+    for(unsigned ii = 0; ii < 4; ++ii)
+      interleave_in(q[ii], q[ii + 4], roundKeys + 4 * round);
+    ortho(q);
+  }
+}
+
+void rijndael::bitsliced::encrypt_blocks(const uint64_t* bitslicedKeys, uint32_t nr, uint8_t* blocks,
+                                         size_t count) noexcept {
+  for_batches(encrypt_batch<u64x2, 2>, encrypt_batch<uint64_t, 1>, bitslicedKeys, nr, blocks, count);
+}
+
+void rijndael::bitsliced::decrypt_blocks(const uint64_t* bitslicedKeys, uint32_t nr, uint8_t* blocks,
+                                         size_t count) noexcept {
+  for_batches(decrypt_batch<u64x2, 2>, decrypt_batch<uint64_t, 1>, bitslicedKeys, nr, blocks, count);
+}
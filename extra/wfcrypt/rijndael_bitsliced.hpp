@@ -0,0 +1,21 @@
+#ifndef WIN32API_RIJNDAEL_BITSLICED_HPP
+#define WIN32API_RIJNDAEL_BITSLICED_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Bitsliced rounds for 16 byte blocks: no table lookups and no data-dependent branches, so the timing doesn't depend on
+ * the key or the data. The state of four blocks is spread over eight 64-bit words, one per bit of every byte, and the
+ * S-box is computed as a boolean circuit. Eight blocks are processed at a time on 128-bit vectors. Anything less
+ * still costs a whole batch, so use the bulk functions whenever there is more than one block to process.
+ */
+namespace rijndael::bitsliced {
+  // eight words per round key; roundKeys are the little-endian column words of the portable key schedule
+  void expand_key(const uint32_t* roundKeys, uint32_t nr, uint64_t* bitslicedKeys) noexcept;
+
+  void encrypt_blocks(const uint64_t* bitslicedKeys, uint32_t nr, uint8_t* blocks, size_t count) noexcept;
+  void decrypt_blocks(const uint64_t* bitslicedKeys, uint32_t nr, uint8_t* blocks, size_t count) noexcept;
+}    // namespace rijndael::bitsliced
+
+#endif    //WIN32API_RIJNDAEL_BITSLICED_HPP
@@ -1,9 +1,19 @@
 #include "wfcrypt.h"
 
+#include <pthread.h>
+#include <strings.h>
+#include <sys/random.h>
+
+#include <cerrno>
+#include <cstdio>
+
 #include <cstring>
 
 #include <algorithm>
-#include <random>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 #include <buffer/buffer_span.hpp>
 #include <buffer/buffer_view.hpp>
@@ -11,7 +21,9 @@
 
 #include <kernel32.h>
 
+#include "keycache.hpp"
 #include "rijndael.hpp"
+#include "threadpool.h"
 
 namespace wflib {
   namespace {
@@ -21,6 +33,9 @@ namespace wflib {
       eWrongNK            = 0x24400004,
       eWrongKeyLength     = 0x24400008,
       eInvalidMemoryWrite = 0x24000010,
+      eInvalidHandle      = 0x24000020,
+      eBadPadding         = 0x24000040,
+      eNoEntropy          = 0x24000080,
     };
 
     inline int error(Error err) noexcept {
@@ -28,9 +43,303 @@ namespace wflib {
       return false;
     }
 
-    inline uint32_t random(uint32_t max = UINT32_MAX) {
-      thread_local std::mt19937 engine{std::random_device{}()};
-      return std::uniform_int_distribution<uint32_t>{0, max}(engine);
+    // for the functions that return a byte count
+    inline int count_error(Error err) noexcept {
+      kernel32_SetLastError((DWORD) err);
+      return -1;
+    }
+
+    /*
+     * Bumped in the child of every fork(): a forked child starts with a copy of the forking thread's entropy pool, and
+     * drawing from it would hand the child the same IVs as its parent.
+     */
+    std::atomic<uint32_t> s_ForkGeneration{0};
+
+    [[maybe_unused]] const int s_AtFork =
+        pthread_atfork(nullptr, nullptr, [] { s_ForkGeneration.fetch_add(1, std::memory_order_relaxed); });
+
+    /*
+     * Per-thread buffer of kernel entropy, refilled with a single getrandom call, so that encrypting many small records
+     * doesn't cost a system call per IV.
+     */
+    class EntropyPool {
+     public:
+      bool fill(char* out, size_t size) {
+        if(m_Generation != s_ForkGeneration.load(std::memory_order_relaxed))
+          discard();
+
+        while(size > 0) {
+          if(m_Offset == sizeof(m_Buffer) && !refill())
+            return false;
+
+          size_t take = std::min(size, sizeof(m_Buffer) - m_Offset);
+          std::memcpy(out, m_Buffer + m_Offset, take);
+          m_Offset += take;
+          out += take;
+          size -= take;
+        }
+        return true;
+      }
+
+     private:
+      void discard() noexcept {
+        explicit_bzero(m_Buffer, sizeof(m_Buffer));
+        m_Offset = sizeof(m_Buffer);
+        m_Generation = s_ForkGeneration.load(std::memory_order_relaxed);
+      }
+
+      bool refill() {
+        size_t filled = 0;
+        while(filled < sizeof(m_Buffer)) {
+          ssize_t res = getrandom(m_Buffer + filled, sizeof(m_Buffer) - filled, 0);
+          if(res < 0) {
+            if(errno == EINTR)
+              continue;
+            return (errno == ENOSYS && read_urandom());
+          }
+          filled += res;
+        }
+        m_Offset = 0;
+        return true;
+      }
+
+      // kernels older than 3.17
+      bool read_urandom() {
+        std::unique_ptr<FILE, decltype(&fclose)> file{fopen("/dev/urandom", "rb"), &fclose};
+        if(!file || fread(m_Buffer, 1, sizeof(m_Buffer), file.get()) != sizeof(m_Buffer))
+          return false;
+        m_Offset = 0;
+        return true;
+      }
+
+
+      char m_Buffer[4096];
+      size_t m_Offset{sizeof(m_Buffer)};
+      uint32_t m_Generation{s_ForkGeneration.load(std::memory_order_relaxed)};
+    };
+
+    thread_local EntropyPool s_EntropyPool;
+
+    inline bool is_valid_n(uint32_t n) noexcept {
+      return (n == 4 || n == 6 || n == 8);
+    }
+
+
+    KeyCache s_KeyCache;
+
+
+    // What a wfcrypt context handle points to.
+    struct ContextHandle {
+      std::shared_ptr<const rijndael::Context> context;
+    };
+
+    ContextHandle* from_handle(HANDLE handle) noexcept {
+      return static_cast<ContextHandle*>(handle ? fromHANDLE(handle, HandleKind::eWfcryptContext) : nullptr);
+    }
+
+
+    // blocks handed to decrypt_blocks at once
+    constexpr uint32_t k_CbcChunkBlocks = 8;
+
+    // payloads from this size on are split over the thread pool, in ranges of at least the minimum size
+    constexpr size_t k_ParallelThreshold = 256 * 1024;
+    constexpr size_t k_MinParallelRange = 64 * 1024;
+
+    /*
+     * CBC-decrypts text in place. prev is the block that precedes it in the cipher text (the IV for the first one);
+     * it must not point into text.
+     */
+    void cbc_decrypt(const rijndael::Context& ctx, buffer::byte_buffer_span text, buffer::byte_buffer_view prev) {
+      const uint32_t blockSize = ctx.blockSize();
+
+      // the previous cipher text block followed by the cipher text of the current chunk
+      buffer::static_byte_buffer<32 * (k_CbcChunkBlocks + 1)> savedBuf;
+      const buffer::byte_buffer_span saved = buffer::to_byte_span(savedBuf);
+      saved.first(blockSize).copy_from(prev);
+
+      while(!text.empty()) {
+        uint32_t chunkSize = std::min<uint32_t>(text.size(), blockSize * k_CbcChunkBlocks);
+        buffer::byte_buffer_span chunk = text.take_first(chunkSize);
+
+        saved.subspan(blockSize, chunkSize).copy_from(chunk);
+        ctx.decrypt_blocks(chunk);
+
+        for(uint32_t ii = 0; ii < chunkSize; ++ii)
+          chunk[ii] ^= saved[ii];
+
+        saved.first(blockSize).copy_from(saved.subspan(chunkSize, blockSize));
+      }
+    }
+
+    void decrypt_payload(const rijndael::Context& ctx, buffer::byte_buffer_span text, buffer::byte_buffer_view iv) {
+      const uint32_t blockSize = ctx.blockSize();
+
+      size_t ranges = std::min(threads::concurrency(), text.size() / k_MinParallelRange);
+      if(text.size() < k_ParallelThreshold || ranges < 2) {
+        cbc_decrypt(ctx, text, iv);
+        return;
+      }
+
+      const size_t blockCount = text.size() / blockSize;
+      const size_t rangeBlocks = (blockCount + ranges - 1) / ranges;
+      ranges = (blockCount + rangeBlocks - 1) / rangeBlocks;
+
+      // the cipher text block in front of each range, saved before any range is decrypted over it
+      std::vector<uint8_t> boundaries(ranges * blockSize);
+      iv.copy_to(buffer::byte_buffer_span{boundaries.data(), blockSize});
+      for(size_t ii = 1; ii < ranges; ++ii) {
+        text.subspan((ii * rangeBlocks - 1) * blockSize, blockSize)
+            .copy_to(buffer::byte_buffer_span{boundaries.data() + ii * blockSize, blockSize});
+      }
+
+      threads::parallel_for(ranges, [&](size_t ii) {
+        size_t first = ii * rangeBlocks;
+        size_t count = std::min(rangeBlocks, blockCount - first);
+
+        cbc_decrypt(ctx, text.subspan(first * blockSize, count * blockSize),
+                    buffer::byte_buffer_view{boundaries.data() + ii * blockSize, blockSize});
+      });
+    }
+
+    bool generate_iv(char* iv, uint32_t size) {
+      return s_EntropyPool.fill(iv, size);
+    }
+
+    // CBC-encrypts text in place; chain holds the IV on entry and the last cipher text block on return
+    void cbc_encrypt(const rijndael::Context& ctx, buffer::byte_buffer_span text, buffer::byte_buffer_span chain) {
+      while(!text.empty()) {
+        buffer::byte_buffer_span block = text.take_first(ctx.blockSize());
+
+        std::transform(block.begin(), block.end(), chain.begin(), block.begin(),
+                       [](uint8_t b, uint8_t v) -> uint8_t { return b ^ v; });
+
+        ctx.encrypt(block);
+
+        block.copy_to(chain);
+      }
+    }
+
+    // fills iv with a fresh random block and CBC-encrypts text in place; fails only if no entropy is available
+    bool encrypt_payload(const rijndael::Context& ctx, buffer::byte_buffer_span text, char* iv) {
+      if(!generate_iv(iv, ctx.blockSize()))
+        return false;
+
+      buffer::static_byte_buffer<32> ivBuf;
+      const buffer::byte_buffer_span initVector = buffer::to_byte_span(ivBuf).first(ctx.blockSize());
+      buffer::byte_buffer_view{iv, ctx.blockSize()}.copy_to(initVector);
+
+      cbc_encrypt(ctx, text, initVector);
+      return true;
+    }
+
+
+    /*
+     * State of an incremental encryption or decryption: the CBC chaining block and the input that does not make up a
+     * whole block yet. Decryption always holds the last whole block back, since it carries the padding.
+     */
+    struct StreamHandle {
+      StreamHandle(std::shared_ptr<const rijndael::Context> context, bool decrypting) noexcept
+          : context{std::move(context)}, decrypting{decrypting} {}
+
+      ~StreamHandle() {
+        explicit_bzero(chain, sizeof(chain));
+        explicit_bzero(pending, sizeof(pending));
+      }
+
+      std::shared_ptr<const rijndael::Context> context;
+      bool decrypting;
+
+      uint8_t chain[32]{};
+      uint8_t pending[32]{};
+      uint32_t pendingSize{0};
+
+      [[nodiscard]] uint32_t blockSize() const noexcept {
+        return context->blockSize();
+      }
+
+      [[nodiscard]] buffer::byte_buffer_span chainSpan() noexcept {
+        return buffer::byte_buffer_span{chain, blockSize()};
+      }
+
+      // tops up the pending block from the input; returns the number of bytes taken
+      uint32_t fill(const uint8_t* in, uint32_t size) noexcept {
+        uint32_t take = std::min(blockSize() - pendingSize, size);
+        std::memcpy(pending + pendingSize, in, take);
+        pendingSize += take;
+        return take;
+      }
+
+      uint32_t encrypt(const uint8_t* in, uint32_t size, uint8_t* out) {
+        const uint32_t bs = blockSize();
+        uint32_t written = 0;
+
+        if(pendingSize > 0) {
+          uint32_t taken = fill(in, size);
+          in += taken;
+          size -= taken;
+
+          if(pendingSize < bs)
+            return 0;
+
+          std::memcpy(out, pending, bs);
+          cbc_encrypt(*context, buffer::byte_buffer_span{out, bs}, chainSpan());
+          pendingSize = 0;
+          written += bs;
+        }
+
+        uint32_t bulk = size - size % bs;
+        std::memmove(out + written, in, bulk);
+        cbc_encrypt(*context, buffer::byte_buffer_span{out + written, bulk}, chainSpan());
+        written += bulk;
+
+        fill(in + bulk, size - bulk);
+        return written;
+      }
+
+      uint32_t decrypt(const uint8_t* in, uint32_t size, uint8_t* out) {
+        const uint32_t bs = blockSize();
+        uint32_t written = 0;
+
+        // complete the pending block, and decrypt it once there is more input behind it
+        if(pendingSize < bs) {
+          uint32_t taken = fill(in, size);
+          in += taken;
+          size -= taken;
+        }
+        if(pendingSize < bs || size == 0)
+          return 0;
+
+        uint8_t cipher[32];
+        std::memcpy(cipher, pending, bs);
+        std::memcpy(out, pending, bs);
+        decrypt_payload(*context, buffer::byte_buffer_span{out, bs}, buffer::byte_buffer_view{chain, bs});
+        std::memcpy(chain, cipher, bs);
+        pendingSize = 0;
+        written += bs;
+
+        // every whole block but the last one
+        uint32_t bulk = ((size - 1) / bs) * bs;
+        if(bulk > 0) {
+          std::memcpy(cipher, in + bulk - bs, bs);
+          std::memmove(out + written, in, bulk);
+          decrypt_payload(*context, buffer::byte_buffer_span{out + written, bulk}, buffer::byte_buffer_view{chain, bs});
+          std::memcpy(chain, cipher, bs);
+          written += bulk;
+        }
+
+        fill(in + bulk, size - bulk);
+        explicit_bzero(cipher, sizeof(cipher));
+        return written;
+      }
+    };
+
+    StreamHandle* from_stream_handle(HANDLE handle) noexcept {
+      return static_cast<StreamHandle*>(handle ? fromHANDLE(handle, HandleKind::eWfcryptStream) : nullptr);
+    }
+
+    void destroy_stream(HANDLE handle, StreamHandle* h) noexcept {
+      releaseHANDLE(handle);
+      delete h;
     }
   }    // namespace
 }    // namespace wflib
@@ -38,13 +347,9 @@ namespace wflib {
 WIN32_API int wfcrypt_encrypt(char* plainText, int nb, int nk, char* iv, const char* key, int plainTextLength) {
   using namespace wflib;
 
-  auto fn_is_valid_n = [](uint32_t n) -> bool {
-    return (n == 4 || n == 6 || n == 8);
-  };
-
-  if(!fn_is_valid_n(nb))
+  if(!is_valid_n(nb))
     return error(Error::eWrongNB);
-  if(!fn_is_valid_n(nk))
+  if(!is_valid_n(nk))
     return error(Error::eWrongNK);
   if(!plainTextLength)
     return error(Error::eInvalidMemoryRead);
@@ -52,73 +357,215 @@ WIN32_API int wfcrypt_encrypt(char* plainText, int nb, int nk, char* iv, const c
   if(plainTextLength % (sizeof(uint32_t) * nb) != 0)
     return error(Error::eInvalidMemoryRead);
 
-  for(uint32_t ii = 0; ii < uint32_t(nb); ++ii) {
-    uint32_t rv = wflib::random();
-    memcpy(iv + sizeof(uint32_t) * ii, &rv, sizeof(uint32_t));
-  }
-
-  buffer::static_byte_buffer<32> ivBuf;
-  rijndael::Context ctx{static_cast<uint32_t>(nb), buffer::byte_buffer_view{key, sizeof(uint32_t) * nk}};
-  {
-    const buffer::byte_buffer_span initVector = buffer::to_byte_span(ivBuf);
-    buffer::byte_buffer_view{iv, ctx.blockSize()}.copy_to(initVector);
+  auto ctx = s_KeyCache.acquire(nb, buffer::byte_buffer_view{key, sizeof(uint32_t) * nk});
+  if(!encrypt_payload(*ctx, buffer::byte_buffer_span{plainText, static_cast<uint32_t>(plainTextLength)}, iv))
+    return error(Error::eNoEntropy);
 
-    buffer::byte_buffer_span text = buffer::byte_buffer_span{plainText, static_cast<uint32_t>(plainTextLength)};
-    while(!text.empty()) {
-      buffer::byte_buffer_span block = text.take_first(sizeof(uint32_t) * nb);
+  kernel32_SetLastError(0);
+  return true;
+}
+WIN32_API int wfcrypt_decrypt(char* cipherText, int nb, int nk, const char* iv, const char* key, int cipherTextLength) {
+  using namespace wflib;
 
-      std::transform(block.begin(), block.end(), initVector.begin(), block.begin(),
-                     [](uint8_t b, uint8_t v) -> uint8_t { return b ^ v; });
+  if(!is_valid_n(nb))
+    return error(Error::eWrongNB);
+  if(!is_valid_n(nk))
+    return error(Error::eWrongNK);
+  if(!cipherTextLength)
+    return error(Error::eInvalidMemoryRead);
 
-      ctx.encrypt(block);
+  if(cipherTextLength % (sizeof(uint32_t) * nb) != 0)
+    return error(Error::eInvalidMemoryRead);
 
-      block.copy_to(initVector);
-    }
-  }
+  auto ctx = s_KeyCache.acquire(nb, buffer::byte_buffer_view{key, sizeof(uint32_t) * nk});
+  decrypt_payload(*ctx, buffer::byte_buffer_span{cipherText, static_cast<uint32_t>(cipherTextLength)},
+                  buffer::byte_buffer_view{iv, ctx->blockSize()});
 
   kernel32_SetLastError(0);
   return true;
 }
-WIN32_API int wfcrypt_decrypt(char* cipherText, int nb, int nk, const char* iv, const char* key, int cipherTextLength) {
-  using namespace wflib;
 
-  auto fn_is_valid_n = [](uint32_t n) -> bool {
-    return (n == 4 || n == 6 || n == 8);
-  };
+WIN32_API HANDLE wfcrypt_create_context(int nb, int nk, const char* key) {
+  using namespace wflib;
 
-  if(!fn_is_valid_n(nb))
+  if(!is_valid_n(nb))
     return error(Error::eWrongNB);
-  if(!fn_is_valid_n(nk))
+  if(!is_valid_n(nk))
     return error(Error::eWrongNK);
-  if(!cipherTextLength)
+  if(!key)
     return error(Error::eInvalidMemoryRead);
 
-  if(cipherTextLength % (sizeof(uint32_t) * nb) != 0)
+  auto* h = new ContextHandle;
+  h->context = s_KeyCache.acquire(nb, buffer::byte_buffer_view{key, sizeof(uint32_t) * nk});
+
+  kernel32_SetLastError(0);
+  return newHANDLE<HANDLE>(h, HandleKind::eWfcryptContext);
+}
+
+WIN32_API int wfcrypt_encrypt_with(HANDLE context, char* plainText, char* iv, int plainTextLength) {
+  using namespace wflib;
+
+  ContextHandle* h = from_handle(context);
+  if(!h)
+    return error(Error::eInvalidHandle);
+  if(!plainTextLength || plainTextLength % h->context->blockSize() != 0)
     return error(Error::eInvalidMemoryRead);
 
-  buffer::static_byte_buffer<32> ivBuf1;
-  buffer::static_byte_buffer<32> ivBuf2;
-  rijndael::Context ctx{static_cast<uint32_t>(nb), buffer::byte_buffer_view{key, sizeof(uint32_t) * nk}};
-  {
-    buffer::byte_buffer_span initVector = buffer::to_byte_span(ivBuf1);
-    buffer::byte_buffer_view{iv, ctx.blockSize()}.copy_to(initVector);
+  if(!encrypt_payload(*h->context, buffer::byte_buffer_span{plainText, static_cast<uint32_t>(plainTextLength)}, iv))
+    return error(Error::eNoEntropy);
 
-    buffer::byte_buffer_span nextInitVector = buffer::to_byte_span(ivBuf2);
+  kernel32_SetLastError(0);
+  return true;
+}
+
+WIN32_API int wfcrypt_decrypt_with(HANDLE context, char* cipherText, const char* iv, int cipherTextLength) {
+  using namespace wflib;
 
-    buffer::byte_buffer_span text = buffer::byte_buffer_span{cipherText, static_cast<uint32_t>(cipherTextLength)};
-    while(!text.empty()) {
-      buffer::byte_buffer_span block = text.take_first(ctx.blockSize());
-      block.copy_to(buffer::to_byte_span(nextInitVector));
+  ContextHandle* h = from_handle(context);
+  if(!h)
+    return error(Error::eInvalidHandle);
+  if(!cipherTextLength || cipherTextLength % h->context->blockSize() != 0)
+    return error(Error::eInvalidMemoryRead);
 
-      ctx.decrypt(block);
+  decrypt_payload(*h->context, buffer::byte_buffer_span{cipherText, static_cast<uint32_t>(cipherTextLength)},
+                  buffer::byte_buffer_view{iv, h->context->blockSize()});
 
-      std::transform(block.begin(), block.end(), initVector.begin(), block.begin(),
-                     [](uint8_t b, uint8_t v) -> uint8_t { return b ^ v; });
+  kernel32_SetLastError(0);
+  return true;
+}
 
-      std::swap(initVector, nextInitVector);
-    }
+WIN32_API int wfcrypt_destroy_context(HANDLE context) {
+  using namespace wflib;
+
+  ContextHandle* h = from_handle(context);
+  if(!h)
+    return error(Error::eInvalidHandle);
+
+  releaseHANDLE(context);
+  delete h;
+
+  kernel32_SetLastError(0);
+  return true;
+}
+
+WIN32_API HANDLE wfcrypt_encrypt_begin(HANDLE context, char* iv) {
+  using namespace wflib;
+
+  ContextHandle* h = from_handle(context);
+  if(!h)
+    return error(Error::eInvalidHandle);
+  if(!iv)
+    return error(Error::eInvalidMemoryWrite);
+
+  if(!generate_iv(iv, h->context->blockSize()))
+    return error(Error::eNoEntropy);
+
+  auto* stream = new StreamHandle{h->context, false};
+  std::memcpy(stream->chain, iv, stream->blockSize());
+
+  kernel32_SetLastError(0);
+  return newHANDLE<HANDLE>(stream, HandleKind::eWfcryptStream);
+}
+
+WIN32_API HANDLE wfcrypt_decrypt_begin(HANDLE context, const char* iv) {
+  using namespace wflib;
+
+  ContextHandle* h = from_handle(context);
+  if(!h)
+    return error(Error::eInvalidHandle);
+  if(!iv)
+    return error(Error::eInvalidMemoryRead);
+
+  auto* stream = new StreamHandle{h->context, true};
+  std::memcpy(stream->chain, iv, stream->blockSize());
+
+  kernel32_SetLastError(0);
+  return newHANDLE<HANDLE>(stream, HandleKind::eWfcryptStream);
+}
+
+WIN32_API int wfcrypt_stream_update(HANDLE stream, const char* input, int inputLength, char* output, int outputLength) {
+  using namespace wflib;
+
+  StreamHandle* h = from_stream_handle(stream);
+  if(!h)
+    return count_error(Error::eInvalidHandle);
+  if(inputLength < 0 || (inputLength > 0 && !input))
+    return count_error(Error::eInvalidMemoryRead);
+  if(!output || outputLength < int64_t(inputLength) + h->blockSize())
+    return count_error(Error::eInvalidMemoryWrite);
+
+  auto in = reinterpret_cast<const uint8_t*>(input);
+  auto out = reinterpret_cast<uint8_t*>(output);
+  uint32_t written = (h->decrypting ? h->decrypt(in, inputLength, out) : h->encrypt(in, inputLength, out));
+
+  kernel32_SetLastError(0);
+  return int(written);
+}
+
+WIN32_API int wfcrypt_stream_final(HANDLE stream, char* output, int outputLength) {
+  using namespace wflib;
+
+  StreamHandle* h = from_stream_handle(stream);
+  if(!h)
+    return count_error(Error::eInvalidHandle);
+
+  const uint32_t bs = h->blockSize();
+  if(!output || outputLength < int(bs))
+    return count_error(Error::eInvalidMemoryWrite);
+
+  auto out = reinterpret_cast<uint8_t*>(output);
+  if(!h->decrypting) {
+    // PKCS#7: always at least one byte of padding, each holding the padding length
+    uint8_t pad = bs - h->pendingSize;
+    std::memset(h->pending + h->pendingSize, pad, pad);
+    std::memcpy(out, h->pending, bs);
+    cbc_encrypt(*h->context, buffer::byte_buffer_span{out, bs}, h->chainSpan());
+
+    destroy_stream(stream, h);
+    kernel32_SetLastError(0);
+    return int(bs);
+  }
+
+  if(h->pendingSize != bs) {
+    destroy_stream(stream, h);
+    return count_error(Error::eInvalidMemoryRead);
+  }
+
+  uint8_t block[32];
+  std::memcpy(block, h->pending, bs);
+  decrypt_payload(*h->context, buffer::byte_buffer_span{block, bs}, buffer::byte_buffer_view{h->chain, bs});
+  destroy_stream(stream, h);
+
+  // checked in constant time: how far a bad padding got must not show up in the timing
+  const uint32_t pad = block[bs - 1];
+  uint32_t bad = (pad - 1) >> 8;             // non-zero if pad is 0
+  bad |= (bs - pad) >> 8;                    // non-zero if pad is over bs
+  for(uint32_t ii = 0; ii < bs; ++ii) {
+    const uint32_t inPad = 0u - (((bs - 1 - ii) - pad) >> 31);    // all ones for the last pad bytes
+    bad |= inPad & (block[ii] ^ pad);
   }
 
+  if(bad != 0) {
+    explicit_bzero(block, sizeof(block));
+    return count_error(Error::eBadPadding);
+  }
+
+  std::memcpy(out, block, bs - pad);
+  explicit_bzero(block, sizeof(block));
+
+  kernel32_SetLastError(0);
+  return int(bs - pad);
+}
+
+WIN32_API int wfcrypt_destroy_stream(HANDLE stream) {
+  using namespace wflib;
+
+  StreamHandle* h = from_stream_handle(stream);
+  if(!h)
+    return error(Error::eInvalidHandle);
+
+  destroy_stream(stream, h);
+
   kernel32_SetLastError(0);
   return true;
 }
@@ -10,6 +10,29 @@ extern "C" {
 WIN32_API int wfcrypt_encrypt(char* plainText, int nb, int nk, char* iv, const char* key, int plainTextLength);
 WIN32_API int wfcrypt_decrypt(char* cipherText, int nb, int nk, const char* iv, const char* key, int cipherTextLength);
 
+/*
+ * Not part of the original library: the key is expanded once when the context is created, and the context can then
+ * be used for any number of encrypt_with/decrypt_with calls, from any thread. The functions behave like
+ * wfcrypt_encrypt/wfcrypt_decrypt otherwise.
+ */
+WIN32_API HANDLE wfcrypt_create_context(int nb, int nk, const char* key);
+WIN32_API int wfcrypt_encrypt_with(HANDLE context, char* plainText, char* iv, int plainTextLength);
+WIN32_API int wfcrypt_decrypt_with(HANDLE context, char* cipherText, const char* iv, int cipherTextLength);
+WIN32_API int wfcrypt_destroy_context(HANDLE context);
+
+/*
+ * Incremental CBC with PKCS#7 padding, so that data can be encrypted or decrypted in chunks of any size.
+ * wfcrypt_encrypt_begin writes a fresh IV (one block) to iv. update writes whole blocks only and returns the number
+ * of bytes written; the output must have room for inputLength plus one block. final (room for one block) writes the
+ * padded last block or the unpadded last plain text, and frees the stream either way. Functions returning a byte
+ * count return -1 on error. wfcrypt_destroy_stream abandons a stream.
+ */
+WIN32_API HANDLE wfcrypt_encrypt_begin(HANDLE context, char* iv);
+WIN32_API HANDLE wfcrypt_decrypt_begin(HANDLE context, const char* iv);
+WIN32_API int wfcrypt_stream_update(HANDLE stream, const char* input, int inputLength, char* output, int outputLength);
+WIN32_API int wfcrypt_stream_final(HANDLE stream, char* output, int outputLength);
+WIN32_API int wfcrypt_destroy_stream(HANDLE stream);
+
 #ifdef __cplusplus
 }
 #endif
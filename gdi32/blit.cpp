@@ -0,0 +1,232 @@
+#include "blit.h"
+
+#include <cstring>
+
+#include <algorithm>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#  include <immintrin.h>
+#  define BLIT_HAVE_SSE 1
+#endif
+
+namespace gdi::blit {
+  namespace {
+    // bilinear weights are 7 bits, so that a vertically blended channel (at most 255 * 128) still fits an int16
+    constexpr int k_WeightBits = 7;
+    constexpr int k_One = 1 << k_WeightBits;
+
+    // two source pixels and the weight of the second one
+    struct Tap {
+      int i0, i1;
+      int w;
+    };
+
+    // centre of destination pixel ii in source pixels, 16.16 fixed point
+    inline int64_t centre(int ii, int srcSize, int dstSize) noexcept {
+      return ((2 * int64_t(ii) + 1) * srcSize << 16) / (2 * int64_t(dstSize));
+    }
+
+    std::vector<int> nearest_map(int first, int count, int srcSize, int dstSize) {
+      std::vector<int> map(count);
+      for(int ii = 0; ii < count; ++ii)
+        map[ii] = std::min(int(centre(first + ii, srcSize, dstSize) >> 16), srcSize - 1);
+      return map;
+    }
+
+    std::vector<Tap> bilinear_taps(int first, int count, int srcSize, int dstSize) {
+      std::vector<Tap> taps(count);
+      for(int ii = 0; ii < count; ++ii) {
+        const int64_t p = std::max<int64_t>(centre(first + ii, srcSize, dstSize) - 0x8000, 0);
+        const int i0 = int(p >> 16);
+
+        if(i0 >= srcSize - 1)
+          taps[ii] = Tap{srcSize - 1, srcSize - 1, 0};
+        else
+          taps[ii] = Tap{i0, i0 + 1, int(p & 0xFFFF) >> (16 - k_WeightBits)};
+      }
+      return taps;
+    }
+
+
+    /* scalar reference */
+
+    void nearest_row_scalar(const uint8_t* src, uint8_t* dst, const int* map, size_t count) noexcept {
+      for(size_t ii = 0; ii < count; ++ii)
+        std::memcpy(dst + 4 * ii, src + 4 * map[ii], 4);
+    }
+
+    void vertical_scalar(const uint8_t* r0, const uint8_t* r1, int16_t* out, size_t count, int w) noexcept {
+      for(size_t ii = 0; ii < count; ++ii)
+        out[ii] = int16_t(r0[ii] * (k_One - w) + r1[ii] * w);
+    }
+
+    void horizontal_scalar(const int16_t* row, uint8_t* dst, const Tap* taps, size_t count) noexcept {
+      constexpr int round = 1 << (2 * k_WeightBits - 1);
+
+      for(size_t ii = 0; ii < count; ++ii) {
+        const Tap& t = taps[ii];
+        for(int cc = 0; cc < 4; ++cc) {
+          int v = row[4 * t.i0 + cc] * (k_One - t.w) + row[4 * t.i1 + cc] * t.w;
+          dst[4 * ii + cc] = uint8_t((v + round) >> (2 * k_WeightBits));
+        }
+      }
+    }
+
+
+#if defined(BLIT_HAVE_SSE)
+    /* SSE2 */
+
+    size_t vertical_sse2(const uint8_t* r0, const uint8_t* r1, int16_t* out, size_t count, int w) noexcept {
+      const __m128i zero = _mm_setzero_si128();
+      const __m128i w0 = _mm_set1_epi16(int16_t(k_One - w)), w1 = _mm_set1_epi16(int16_t(w));
+
+      size_t ii = 0;
+      for(; ii + 16 <= count; ii += 16) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r0 + ii));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r1 + ii));
+
+        const __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), w0),
+                                         _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), w1));
+        const __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), w0),
+                                         _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), w1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + ii), lo);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + ii + 8), hi);
+      }
+      return ii;
+    }
+
+    // one pixel: the four channels of both taps interleaved, so a single madd blends them
+    inline __m128i horizontal_pixel_sse2(const int16_t* row, const Tap& t) noexcept {
+      const __m128i a = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(row + 4 * t.i0));
+      const __m128i b = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(row + 4 * t.i1));
+      const __m128i w = _mm_set1_epi32((t.w << 16) | (k_One - t.w));
+      const __m128i v = _mm_madd_epi16(_mm_unpacklo_epi16(a, b), w);
+      return _mm_srai_epi32(_mm_add_epi32(v, _mm_set1_epi32(1 << (2 * k_WeightBits - 1))), 2 * k_WeightBits);
+    }
+
+    size_t horizontal_sse2(const int16_t* row, uint8_t* dst, const Tap* taps, size_t count) noexcept {
+      size_t ii = 0;
+      for(; ii + 2 <= count; ii += 2) {
+        const __m128i v = _mm_packs_epi32(horizontal_pixel_sse2(row, taps[ii]), horizontal_pixel_sse2(row, taps[ii + 1]));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + 4 * ii), _mm_packus_epi16(v, v));
+      }
+      return ii;
+    }
+
+
+    /* AVX2 */
+
+    bool has_avx2() noexcept {
+      static const bool s_Supported = (__builtin_cpu_init(), __builtin_cpu_supports("avx2") != 0);
+      return s_Supported;
+    }
+
+    __attribute__((target("avx2"))) size_t nearest_row_avx2(const uint8_t* src, uint8_t* dst, const int* map,
+                                                            size_t count) noexcept {
+      auto s = reinterpret_cast<const int*>(src);
+
+      size_t ii = 0;
+      for(; ii + 8 <= count; ii += 8) {
+        const __m256i idx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(map + ii));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 4 * ii), _mm256_i32gather_epi32(s, idx, 4));
+      }
+      return ii;
+    }
+#endif
+
+
+    void stretch_nearest(const Surface& src, const RECT& srcRect, Surface& dst, const RECT& dstRect, const RECT& clip,
+                         bool simd) {
+      const int srcW = srcRect.right - srcRect.left, srcH = srcRect.bottom - srcRect.top;
+      const int dstW = dstRect.right - dstRect.left, dstH = dstRect.bottom - dstRect.top;
+      const size_t count = clip.right - clip.left;
+
+      const std::vector<int> columns = nearest_map(clip.left - dstRect.left, count, srcW, dstW);
+      const std::vector<int> rows = nearest_map(clip.top - dstRect.top, clip.bottom - clip.top, srcH, dstH);
+
+#if defined(BLIT_HAVE_SSE)
+      const bool avx2 = simd && has_avx2();
+#endif
+
+      for(LONG y = clip.top; y < clip.bottom; ++y) {
+        uint8_t* out = dst.row(y) + 4 * clip.left;
+        const int sy = rows[y - clip.top];
+
+        // when enlarging, neighbouring rows often come from the same source row
+        if(y > clip.top && rows[y - clip.top - 1] == sy) {
+          std::memcpy(out, dst.row(y - 1) + 4 * clip.left, 4 * count);
+          continue;
+        }
+
+        const uint8_t* in = src.row(srcRect.top + sy) + 4 * srcRect.left;
+        size_t done = 0;
+#if defined(BLIT_HAVE_SSE)
+        if(avx2)
+          done = nearest_row_avx2(in, out, columns.data(), count);
+#endif
+        nearest_row_scalar(in, out + 4 * done, columns.data() + done, count - done);
+      }
+    }
+
+    void stretch_bilinear(const Surface& src, const RECT& srcRect, Surface& dst, const RECT& dstRect, const RECT& clip,
+                          bool simd) {
+      const int srcW = srcRect.right - srcRect.left, srcH = srcRect.bottom - srcRect.top;
+      const int dstW = dstRect.right - dstRect.left, dstH = dstRect.bottom - dstRect.top;
+      const size_t count = clip.right - clip.left, rowCount = 4 * size_t(srcW);
+
+      const std::vector<Tap> columns = bilinear_taps(clip.left - dstRect.left, count, srcW, dstW);
+      const std::vector<Tap> rows = bilinear_taps(clip.top - dstRect.top, clip.bottom - clip.top, srcH, dstH);
+
+      // the vertically blended source row, reused for as long as the taps stay the same
+      std::vector<int16_t> blended(rowCount);
+      const Tap* last = nullptr;
+
+      for(LONG y = clip.top; y < clip.bottom; ++y) {
+        const Tap& t = rows[y - clip.top];
+        if(!last || last->i0 != t.i0 || last->w != t.w) {
+          const uint8_t* r0 = src.row(srcRect.top + t.i0) + 4 * srcRect.left;
+          const uint8_t* r1 = src.row(srcRect.top + t.i1) + 4 * srcRect.left;
+
+          size_t done = 0;
+#if defined(BLIT_HAVE_SSE)
+          if(simd)
+            done = vertical_sse2(r0, r1, blended.data(), rowCount, t.w);
+#endif
+          vertical_scalar(r0 + done, r1 + done, blended.data() + done, rowCount - done, t.w);
+          last = &t;
+        }
+
+        uint8_t* out = dst.row(y) + 4 * clip.left;
+        size_t done = 0;
+#if defined(BLIT_HAVE_SSE)
+        if(simd)
+          done = horizontal_sse2(blended.data(), out, columns.data(), count);
+#endif
+        horizontal_scalar(blended.data(), out + 4 * done, columns.data() + done, count - done);
+      }
+    }
+  }    // namespace
+}    // namespace gdi::blit
+
+void gdi::blit::copy(const Surface& src, int sx, int sy, Surface& dst, int dx, int dy, int w, int h) noexcept {
+  // going up when copying downwards within a surface, so no row is overwritten before it is read
+  if(&src == &dst && dy > sy) {
+    for(int y = h - 1; y >= 0; --y)
+      std::memmove(dst.row(dy + y) + 4 * dx, src.row(sy + y) + 4 * sx, 4 * size_t(w));
+  } else {
+    for(int y = 0; y < h; ++y)
+      std::memmove(dst.row(dy + y) + 4 * dx, src.row(sy + y) + 4 * sx, 4 * size_t(w));
+  }
+}
+
+void gdi::blit::stretch(const Surface& src, const RECT& srcRect, Surface& dst, const RECT& dstRect, const RECT& clip,
+                        Filter filter, bool simd) noexcept {
+  if(clip.left >= clip.right || clip.top >= clip.bottom)
+    return;
+
+  if(filter == Filter::eBilinear)
+    stretch_bilinear(src, srcRect, dst, dstRect, clip, simd);
+  else
+    stretch_nearest(src, srcRect, dst, dstRect, clip, simd);
+}
@@ -0,0 +1,26 @@
+#ifndef GDI32_BLIT_H
+#define GDI32_BLIT_H
+
+#include "objects.h"
+
+/*
+ * Pixel copies between surfaces. Rectangles are expected to lie within their surfaces already.
+ */
+namespace gdi::blit {
+  enum class Filter {
+    eNearest,
+    eBilinear,
+  };
+
+  // w x h pixels from (sx, sy) to (dx, dy); the two may overlap when src and dst are the same surface
+  void copy(const Surface& src, int sx, int sy, Surface& dst, int dx, int dy, int w, int h) noexcept;
+
+  /*
+   * Scales srcRect to dstRect, writing only the part of dstRect inside clip. src and dst must be different surfaces.
+   * simd = false runs the scalar reference kernels, which give exactly the same results.
+   */
+  void stretch(const Surface& src, const RECT& srcRect, Surface& dst, const RECT& dstRect, const RECT& clip,
+               Filter filter, bool simd = true) noexcept;
+}    // namespace gdi::blit
+
+#endif
@@ -1,9 +1,353 @@
 #include "gdi32.h"
 
+#include <cstdlib>
+#include <cstring>
+
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <utility>
+
+#include "blit.h"
+#include "log.h"
+#include "mkxpGlue.h"
+#include "objects.h"
+#include "text.h"
+
+namespace {
+    // Blits out of a window DC read the game frame when mkxp can provide it, and just the overlay otherwise.
+    std::shared_ptr<gdi::Surface> sourceOf(const gdi::DC& dc) {
+        static std::shared_ptr<gdi::Surface> s_Frame;
+
+        if(!dc.hwnd)
+            return dc.surface;
+
+        const gdi::Surface& overlay = *dc.surface;
+        if(!s_Frame || s_Frame->width != overlay.width || s_Frame->height != overlay.height)
+            s_Frame = gdi::Surface::create(overlay.width, overlay.height);
+
+        if(s_Frame && mkxp::captureFrame(s_Frame->row(0), int(s_Frame->stride), s_Frame->width, s_Frame->height))
+            return s_Frame;
+
+        return dc.surface;
+    }
+
+    // Moves both origins so that the copied block lies within both surfaces; false if nothing is left.
+    bool clipCopy(int& x, int& y, int& w, int& h, int& sx, int& sy, const gdi::Surface& dst,
+                  const gdi::Surface& src) {
+        auto clipAxis = [](int& d, int& s, int& size, int dstSize, int srcSize) {
+            int shift = std::max({0, -d, -s});
+            d += shift;
+            s += shift;
+            size -= shift;
+            size = std::min({size, dstSize - d, srcSize - s});
+        };
+
+        clipAxis(x, sx, w, dst.width, src.width);
+        clipAxis(y, sy, h, dst.height, src.height);
+        return w > 0 && h > 0;
+    }
+
+    bool checkRop(DWORD rop) {
+        if((rop & ~DWORD(CAPTUREBLT)) == SRCCOPY)
+            return true;
+
+        spdlog::warn("Raster operation {:#x} is not supported, only SRCCOPY is", rop);
+        return false;
+    }
+}
+
+BOOL gdi32_BitBlt(HDC hdc, int x, int y, int cx, int cy, HDC hdcSrc, int x1, int y1, DWORD rop) {
+    auto dst = gdi::get<gdi::DC>(hdc);
+    auto srcDC = gdi::get<gdi::DC>(hdcSrc);
+    if(!dst || !srcDC || cx < 0 || cy < 0 || !checkRop(rop))
+        return FALSE;
+
+    auto src = sourceOf(*srcDC);
+    if(!clipCopy(x, y, cx, cy, x1, y1, *dst->surface, *src))
+        return TRUE;
+
+    gdi::blit::copy(*src, x1, y1, *dst->surface, x, y, cx, cy);
+    dst->dirty.add(RECT{x, y, x + cx, y + cy});
+    return TRUE;
+}
+
+HBITMAP gdi32_CreateCompatibleBitmap(HDC hdc, int cx, int cy) {
+    if(!gdi::get<gdi::DC>(hdc))
+        return toHANDLE<HBITMAP>(NULL);
+
+    auto surface = gdi::Surface::create(cx, cy);
+    if(!surface)
+        return toHANDLE<HBITMAP>(NULL);
+
+    return gdi::add(new(std::nothrow) gdi::Bitmap{std::move(surface)});
+}
+
+HDC gdi32_CreateCompatibleDC(HDC hdc) {
+    // everything is 32 bpp, so there is nothing to be compatible with
+    if(hdc && !gdi::get<gdi::DC>(hdc))
+        return toHANDLE<HDC>(NULL);
+
+    HBITMAP stock = gdi::stock_bitmap();
+    auto bitmap = gdi::get<gdi::Bitmap>(stock);
+    if(!bitmap)
+        return toHANDLE<HDC>(NULL);
+
+    auto dc = new(std::nothrow) gdi::DC{0, bitmap->surface};
+    if(dc)
+        dc->select_bitmap(stock);
+
+    return gdi::add(dc);
+}
+
+HFONT gdi32_CreateFontA(int cHeight, int cWidth, int cEscapement, int cOrientation, int cWeight, DWORD bItalic,
+                        DWORD bUnderline, DWORD bStrikeOut, DWORD iCharSet, DWORD iOutPrecision, DWORD iClipPrecision,
+                        DWORD iQuality, DWORD iPitchAndFamily, LPCSTR pszFaceName) {
+    LOGFONTA logfont{cHeight, cWidth, cEscapement, cOrientation, cWeight, BYTE(bItalic), BYTE(bUnderline),
+                     BYTE(bStrikeOut), BYTE(iCharSet), BYTE(iOutPrecision), BYTE(iClipPrecision), BYTE(iQuality),
+                     BYTE(iPitchAndFamily), {}};
+    if(pszFaceName)
+        std::strncpy(logfont.lfFaceName, pszFaceName, LF_FACESIZE - 1);
+
+    return gdi32_CreateFontIndirectA(&logfont);
+}
+
+HFONT gdi32_CreateFontIndirectA(const LOGFONTA* lplf) {
+    if(!lplf)
+        return toHANDLE<HFONT>(NULL);
+
+    auto face = gdi::text::find(*lplf);
+    if(!face)
+        return toHANDLE<HFONT>(NULL);
+
+    return gdi::add(new(std::nothrow) gdi::Font{*lplf, std::move(face)});
+}
+
 HBRUSH gdi32_CreateSolidBrush(COLORREF color) {
-    return toHANDLE<HBRUSH>(NULL);
+    return gdi::add(new(std::nothrow) gdi::Brush{color});
+}
+
+BOOL gdi32_DeleteDC(HDC hdc) {
+    // window DCs go back through ReleaseDC
+    auto dc = gdi::get<gdi::DC>(hdc);
+    if(!dc || dc->hwnd)
+        return FALSE;
+
+    gdi::destroy(hdc);
+    return TRUE;
 }
 
 BOOL gdi32_DeleteObject(HGDIOBJ ho) {
-    return FALSE;
+    // device contexts go through ReleaseDC or DeleteDC instead, and stock objects stay
+    if(ho == gdi::stock_bitmap() || ho == gdi::stock_font())
+        return FALSE;
+
+    auto bitmap = gdi::get<gdi::Bitmap>(ho);
+    auto font = gdi::get<gdi::Font>(ho);
+    if(!gdi::get<gdi::Brush>(ho) && !bitmap && !font)
+        return FALSE;
+
+    // like Windows, an object still selected into a DC stays until it is selected out or the DC is gone
+    if((bitmap && bitmap->selections > 0) || (font && font->selections > 0)) {
+        spdlog::warn("Object {} is still selected into a device context and was not deleted", (void*) (ho));
+        return FALSE;
+    }
+
+    gdi::destroy(ho);
+    return TRUE;
+}
+
+int gdi32_GetDIBits(HDC hdc, HBITMAP hbm, UINT start, UINT cLines, LPVOID lpvBits, LPBITMAPINFO lpbmi, UINT usage) {
+    auto bitmap = gdi::get<gdi::Bitmap>(hbm);
+    if(!gdi::get<gdi::DC>(hdc) || !bitmap || !lpbmi || usage != DIB_RGB_COLORS)
+        return 0;
+
+    BITMAPINFOHEADER& header = lpbmi->bmiHeader;
+    if(header.biSize < sizeof(BITMAPINFOHEADER))
+        return 0;
+
+    const gdi::Surface& surface = *bitmap->surface;
+
+    // without a buffer, only the format is asked for
+    if(!lpvBits) {
+        header.biWidth = surface.width;
+        header.biHeight = surface.height;
+        header.biPlanes = 1;
+        header.biBitCount = 32;
+        header.biCompression = BI_RGB;
+        header.biSizeImage = 4 * DWORD(surface.width) * DWORD(surface.height);
+        header.biClrUsed = 0;
+        header.biClrImportant = 0;
+        return TRUE;
+    }
+
+    enum class Layout { eBgr24, eBgra32, eRgba32 } layout;
+    if(header.biBitCount == 24 && header.biCompression == BI_RGB) {
+        layout = Layout::eBgr24;
+    } else if(header.biBitCount == 32 && header.biCompression == BI_RGB) {
+        layout = Layout::eBgra32;
+    } else if(header.biBitCount == 32 && header.biCompression == BI_BITFIELDS) {
+        const auto* masks = reinterpret_cast<const DWORD*>(lpbmi->bmiColors);
+        if(masks[0] == 0xFF0000 && masks[1] == 0xFF00 && masks[2] == 0xFF) {
+            layout = Layout::eBgra32;
+        } else if(masks[0] == 0xFF && masks[1] == 0xFF00 && masks[2] == 0xFF0000) {
+            layout = Layout::eRgba32;
+        } else {
+            spdlog::warn("GetDIBits only supports the BGRA and RGBA channel masks");
+            return 0;
+        }
+    } else {
+        spdlog::warn("GetDIBits does not support {} bpp with compression {}", header.biBitCount, header.biCompression);
+        return 0;
+    }
+
+    if(header.biWidth != surface.width || start >= UINT(surface.height))
+        return 0;
+
+    // scan lines count up from the bottom row unless the height is negative
+    const bool bottomUp = (header.biHeight > 0);
+    const UINT lines = std::min(cLines, UINT(surface.height) - start);
+    const size_t stride = ((size_t(surface.width) * header.biBitCount + 31) / 32) * 4;
+    auto* bits = static_cast<BYTE*>(lpvBits);
+
+    for(UINT ii = 0; ii < lines; ++ii) {
+        const UINT scan = start + ii;
+        const uint8_t* row = surface.row(bottomUp ? surface.height - 1 - scan : scan);
+        BYTE* out = bits + stride * ii;
+
+        switch(layout) {
+            case Layout::eBgr24:
+                pixels::bgra32_to_bgr24(row, out, surface.width);
+                break;
+
+            case Layout::eBgra32:
+                std::memcpy(out, row, 4 * size_t(surface.width));
+                break;
+
+            case Layout::eRgba32:
+                pixels::swap_rb32(row, out, surface.width);
+                break;
+        }
+    }
+
+    return int(lines);
+}
+
+BOOL gdi32_GetTextExtentPoint32A(HDC hdc, LPCSTR lpString, int c, LPSIZE psizl) {
+    auto dc = gdi::get<gdi::DC>(hdc);
+    if(!dc || !psizl || c < 0 || (c > 0 && !lpString))
+        return FALSE;
+
+    return gdi::text::measure(*dc, std::string_view{lpString, size_t(c)}, *psizl);
+}
+
+BOOL gdi32_GetPixelBufferStats(LPPIXELBUFFERSTATS lpStats) {
+    if(!lpStats)
+        return FALSE;
+
+    const pixels::Stats stats = pixels::stats();
+    lpStats->liveBytes = stats.liveBytes;
+    lpStats->peakBytes = stats.peakBytes;
+    lpStats->cachedBytes = stats.cachedBytes;
+    lpStats->liveBuffers = DWORD(stats.liveBuffers);
+    return TRUE;
+}
+
+HGDIOBJ gdi32_SelectObject(HDC hdc, HGDIOBJ h) {
+    auto dc = gdi::get<gdi::DC>(hdc);
+    if(!dc)
+        return toHANDLE<HGDIOBJ>(NULL);
+
+    if(gdi::get<gdi::Font>(h))
+        return dc->select_font(h);
+
+    if(!gdi::get<gdi::Bitmap>(h) || dc->hwnd) {
+        spdlog::warn("Only fonts and bitmaps can be selected, bitmaps only into memory device contexts");
+        return toHANDLE<HGDIOBJ>(NULL);
+    }
+
+    return dc->select_bitmap(h);
+}
+
+COLORREF gdi32_SetBkColor(HDC hdc, COLORREF color) {
+    auto dc = gdi::get<gdi::DC>(hdc);
+    if(!dc)
+        return CLR_INVALID;
+
+    return std::exchange(dc->bkColor, color & 0xFFFFFF);
+}
+
+int gdi32_SetBkMode(HDC hdc, int mode) {
+    auto dc = gdi::get<gdi::DC>(hdc);
+    if(!dc || (mode != TRANSPARENT && mode != OPAQUE))
+        return 0;
+
+    return std::exchange(dc->bkMode, mode);
+}
+
+int gdi32_SetStretchBltMode(HDC hdc, int mode) {
+    auto dc = gdi::get<gdi::DC>(hdc);
+    if(!dc || mode < BLACKONWHITE || mode > HALFTONE)
+        return 0;
+
+    return std::exchange(dc->stretchMode, mode);
+}
+
+COLORREF gdi32_SetTextColor(HDC hdc, COLORREF color) {
+    auto dc = gdi::get<gdi::DC>(hdc);
+    if(!dc)
+        return CLR_INVALID;
+
+    return std::exchange(dc->textColor, color & 0xFFFFFF);
+}
+
+BOOL gdi32_StretchBlt(HDC hdcDest, int xDest, int yDest, int wDest, int hDest, HDC hdcSrc, int xSrc, int ySrc,
+                      int wSrc, int hSrc, DWORD rop) {
+    auto dst = gdi::get<gdi::DC>(hdcDest);
+    auto srcDC = gdi::get<gdi::DC>(hdcSrc);
+    if(!dst || !srcDC || !checkRop(rop))
+        return FALSE;
+
+    if(wDest <= 0 || hDest <= 0 || wSrc <= 0 || hSrc <= 0) {
+        spdlog::warn("StretchBlt only supports positive sizes");
+        return FALSE;
+    }
+
+    if(wDest == wSrc && hDest == hSrc)
+        return gdi32_BitBlt(hdcDest, xDest, yDest, wDest, hDest, hdcSrc, xSrc, ySrc, rop);
+
+    auto src = sourceOf(*srcDC);
+    const RECT srcRect{xSrc, ySrc, xSrc + wSrc, ySrc + hSrc};
+    if(xSrc < 0 || ySrc < 0 || srcRect.right > src->width || srcRect.bottom > src->height)
+        return FALSE;
+
+    const RECT dstRect{xDest, yDest, xDest + wDest, yDest + hDest};
+    RECT clip = dstRect;
+    if(!dst->clip(clip))
+        return TRUE;
+
+    // scaling within a surface reads pixels it already wrote, so it works from a copy
+    if(src == dst->surface) {
+        auto copy = gdi::Surface::create(wSrc, hSrc);
+        if(!copy)
+            return FALSE;
+
+        gdi::blit::copy(*src, xSrc, ySrc, *copy, 0, 0, wSrc, hSrc);
+        src = std::move(copy);
+        xSrc = ySrc = 0;
+    }
+
+    const auto filter = (dst->stretchMode == HALFTONE ? gdi::blit::Filter::eBilinear : gdi::blit::Filter::eNearest);
+    gdi::blit::stretch(*src, RECT{xSrc, ySrc, xSrc + wSrc, ySrc + hSrc}, *dst->surface, dstRect, clip, filter);
+    dst->dirty.add(clip);
+    return TRUE;
+}
+
+BOOL gdi32_TextOutA(HDC hdc, int x, int y, LPCSTR lpString, int c) {
+    auto dc = gdi::get<gdi::DC>(hdc);
+    if(!dc || c < 0 || (c > 0 && !lpString))
+        return FALSE;
+
+    return gdi::text::draw(*dc, x, y, std::string_view{lpString, size_t(c)}, nullptr);
 }
@@ -3,10 +3,64 @@
 
 #include "wintypes.h"
 
+enum BiCompression : DWORD {
+  BI_RGB       = 0,
+  BI_BITFIELDS = 3
+};
+
+enum BackgroundMode : int {
+  TRANSPARENT = 1,
+  OPAQUE      = 2
+};
+
+enum DIBColors : UINT {
+  DIB_RGB_COLORS = 0
+};
+
+enum RasterOperation : DWORD {
+  SRCCOPY    = 0x00CC0020,
+  CAPTUREBLT = 0x40000000
+};
+
+enum FontWeight : int {
+  FW_DONTCARE = 0,
+  FW_NORMAL   = 400,
+  FW_SEMIBOLD = 600,
+  FW_BOLD     = 700
+};
+
+enum StretchBltMode : int {
+  BLACKONWHITE = 1,
+  WHITEONBLACK = 2,
+  COLORONCOLOR = 3,
+  HALFTONE     = 4
+};
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+#define CLR_INVALID 0xFFFFFFFF
+
+#define LF_FACESIZE 32
+
+typedef struct tagLOGFONTA {
+  LONG lfHeight;
+  LONG lfWidth;
+  LONG lfEscapement;
+  LONG lfOrientation;
+  LONG lfWeight;
+  BYTE lfItalic;
+  BYTE lfUnderline;
+  BYTE lfStrikeOut;
+  BYTE lfCharSet;
+  BYTE lfOutPrecision;
+  BYTE lfClipPrecision;
+  BYTE lfQuality;
+  BYTE lfPitchAndFamily;
+  CHAR lfFaceName[LF_FACESIZE];
+} LOGFONTA, *PLOGFONTA, *LPLOGFONTA;
+
 typedef struct tagRGBQUAD {
   BYTE rgbBlue;
   BYTE rgbGreen;
@@ -35,17 +89,158 @@ typedef struct tagBITMAPINFO {
 
 typedef HANDLE HBITMAP;
 typedef HANDLE HBRUSH;
+typedef HANDLE HFONT;
 typedef HANDLE HGDIOBJ;
 typedef HANDLE HPALETTE;
 
+WIN32_API BOOL gdi32_BitBlt(
+    HDC   hdc,
+    int   x,
+    int   y,
+    int   cx,
+    int   cy,
+    HDC   hdcSrc,
+    int   x1,
+    int   y1,
+    DWORD rop
+);
+
+WIN32_API HBITMAP gdi32_CreateCompatibleBitmap(
+    HDC hdc,
+    int cx,
+    int cy
+);
+
+WIN32_API HDC gdi32_CreateCompatibleDC(
+    HDC hdc
+);
+
+/*
+ * Fonts are matched by face name, weight and slant through fontconfig, so Windows face names end up as their usual
+ * substitutes. Weight and italics missing from the matched font are synthesized. Width, escapement, underline and
+ * strike out are ignored. Text is UTF-8.
+ */
+WIN32_API HFONT gdi32_CreateFontA(
+    int    cHeight,
+    int    cWidth,
+    int    cEscapement,
+    int    cOrientation,
+    int    cWeight,
+    DWORD  bItalic,
+    DWORD  bUnderline,
+    DWORD  bStrikeOut,
+    DWORD  iCharSet,
+    DWORD  iOutPrecision,
+    DWORD  iClipPrecision,
+    DWORD  iQuality,
+    DWORD  iPitchAndFamily,
+    LPCSTR pszFaceName
+);
+
+WIN32_API HFONT gdi32_CreateFontIndirectA(
+    const LOGFONTA* lplf
+);
+
 WIN32_API HBRUSH gdi32_CreateSolidBrush(
     COLORREF color
 );
 
+WIN32_API BOOL gdi32_DeleteDC(
+    HDC hdc
+);
+
 WIN32_API BOOL gdi32_DeleteObject(
     HGDIOBJ ho
 );
 
+/*
+ * Bitmaps are always 32 bpp inside, and can be read as 24 or 32 bpp BI_RGB, or as 32 bpp BI_BITFIELDS with either
+ * the usual masks or the red and blue ones swapped (RGBA in memory).
+ */
+WIN32_API int gdi32_GetDIBits(
+    HDC          hdc,
+    HBITMAP      hbm,
+    UINT         start,
+    UINT         cLines,
+    LPVOID       lpvBits,
+    LPBITMAPINFO lpbmi,
+    UINT         usage
+);
+
+WIN32_API BOOL gdi32_GetTextExtentPoint32A(
+    HDC    hdc,
+    LPCSTR lpString,
+    int    c,
+    LPSIZE psizl
+);
+
+/*
+ * Not part of the Win32 API: the pixel memory of every GDI and GDI+ bitmap, surface and pending screenshot, which all
+ * come from one pool. Sizes are rounded up to the pool's size classes. Live bytes that only ever grow usually mean a
+ * script creates bitmaps without disposing of them.
+ */
+typedef struct tagPIXELBUFFERSTATS {
+  ULONGLONG liveBytes;
+  ULONGLONG peakBytes;
+  ULONGLONG cachedBytes;
+  DWORD     liveBuffers;
+} PIXELBUFFERSTATS, *LPPIXELBUFFERSTATS;
+
+WIN32_API BOOL gdi32_GetPixelBufferStats(
+    LPPIXELBUFFERSTATS lpStats
+);
+
+WIN32_API HGDIOBJ gdi32_SelectObject(
+    HDC     hdc,
+    HGDIOBJ h
+);
+
+WIN32_API COLORREF gdi32_SetBkColor(
+    HDC      hdc,
+    COLORREF color
+);
+
+WIN32_API int gdi32_SetBkMode(
+    HDC hdc,
+    int mode
+);
+
+WIN32_API int gdi32_SetStretchBltMode(
+    HDC hdc,
+    int mode
+);
+
+WIN32_API COLORREF gdi32_SetTextColor(
+    HDC      hdc,
+    COLORREF color
+);
+
+/*
+ * HALFTONE stretches bilinearly, every other mode picks the nearest pixel. Mirroring through negative sizes is not
+ * supported.
+ */
+WIN32_API BOOL gdi32_StretchBlt(
+    HDC   hdcDest,
+    int   xDest,
+    int   yDest,
+    int   wDest,
+    int   hDest,
+    HDC   hdcSrc,
+    int   xSrc,
+    int   ySrc,
+    int   wSrc,
+    int   hSrc,
+    DWORD rop
+);
+
+WIN32_API BOOL gdi32_TextOutA(
+    HDC    hdc,
+    int    x,
+    int    y,
+    LPCSTR lpString,
+    int    c
+);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,147 @@
+#include "objects.h"
+
+#include <algorithm>
+#include <new>
+
+#include "text.h"
+
+namespace gdi {
+  namespace {
+    inline bool touches(const RECT& a, const RECT& b) noexcept {
+      return a.left <= b.right && b.left <= a.right && a.top <= b.bottom && b.top <= a.bottom;
+    }
+
+    inline RECT bounds(const RECT& a, const RECT& b) noexcept {
+      return RECT{std::min(a.left, b.left), std::min(a.top, b.top), std::max(a.right, b.right),
+                  std::max(a.bottom, b.bottom)};
+    }
+  }    // namespace
+}    // namespace gdi
+
+std::shared_ptr<gdi::Surface> gdi::Surface::create(int width, int height) noexcept {
+  if(width <= 0 || height <= 0)
+    return nullptr;
+
+  auto surface = std::shared_ptr<Surface>{new(std::nothrow) Surface};
+  if(!surface)
+    return nullptr;
+
+  surface->width = width;
+  surface->height = height;
+  surface->stride = pixels::aligned_stride(4 * size_t(width));
+  surface->storage.reset(pixels::allocate(surface->stride * height));
+  if(!surface->storage)
+    return nullptr;
+
+  return surface;
+}
+
+void gdi::DirtyRegion::add(const RECT& rect) noexcept {
+  RECT merged = rect;
+
+  // merging can make the rectangle touch ones it skipped before, so go again until nothing changes
+  for(bool changed = true; changed;) {
+    changed = false;
+    for(auto it = m_Rects.begin(); it != m_Rects.end();) {
+      if(touches(merged, *it)) {
+        merged = bounds(merged, *it);
+        it = m_Rects.erase(it);
+        changed = true;
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  if(m_Rects.size() >= k_MaxRects) {
+    for(const auto& r : m_Rects)
+      merged = bounds(merged, r);
+    m_Rects.clear();
+  }
+
+  m_Rects.push_back(merged);
+}
+
+gdi::Brush::Brush(COLORREF color) noexcept : Object{k_Magic}, color{color}, pixel{to_pixel(color)} {}
+
+gdi::DC::~DC() {
+  if(auto* f = get<Font>(font))
+    --f->selections;
+  if(auto* b = get<Bitmap>(bitmap))
+    --b->selections;
+}
+
+HFONT gdi::DC::select_font(HFONT h) noexcept {
+  const HFONT previous = (font ? font : stock_font());
+
+  if(auto* f = get<Font>(font))
+    --f->selections;
+  if(auto* f = get<Font>(h))
+    ++f->selections;
+
+  font = h;
+  return previous;
+}
+
+HBITMAP gdi::DC::select_bitmap(HBITMAP h) noexcept {
+  const HBITMAP previous = bitmap;
+
+  if(auto* b = get<Bitmap>(bitmap))
+    --b->selections;
+  auto* b = get<Bitmap>(h);
+  ++b->selections;
+
+  bitmap = h;
+  surface = b->surface;
+  dirty.clear();
+  return previous;
+}
+
+bool gdi::DC::clip(RECT& rect) const noexcept {
+  rect.left = std::max<LONG>(rect.left, 0);
+  rect.top = std::max<LONG>(rect.top, 0);
+  rect.right = std::min<LONG>(rect.right, surface->width);
+  rect.bottom = std::min<LONG>(rect.bottom, surface->height);
+
+  return rect.left < rect.right && rect.top < rect.bottom;
+}
+
+void gdi::DC::fill(RECT rect, uint32_t pixel) noexcept {
+  if(!clip(rect))
+    return;
+
+  for(LONG y = rect.top; y < rect.bottom; ++y)
+    pixels::fill32(surface->row(y) + 4 * rect.left, pixel, rect.right - rect.left);
+
+  dirty.add(rect);
+}
+
+HBITMAP gdi::stock_bitmap() noexcept {
+  static const HBITMAP s_Bitmap = add(new(std::nothrow) Bitmap{Surface::create(1, 1)});
+  return s_Bitmap;
+}
+
+HFONT gdi::stock_font() noexcept {
+  static const HFONT s_Font = [] {
+    LOGFONTA logfont{};
+    logfont.lfWeight = FW_NORMAL;
+    return add(new(std::nothrow) Font{logfont, text::find(logfont)});
+  }();
+  return s_Font;
+}
+
+HANDLE gdi::add(Object* object) noexcept {
+  if(!object)
+    return 0;
+
+  return newHANDLE<HANDLE>(object, HandleKind::eGdiObject);
+}
+
+void gdi::destroy(HANDLE handle) noexcept {
+  auto* o = static_cast<Object*>(handle ? fromHANDLE(handle, HandleKind::eGdiObject) : nullptr);
+  if(!o)
+    return;
+
+  releaseHANDLE(handle);
+  delete o;
+}
@@ -0,0 +1,150 @@
+#ifndef GDI32_OBJECTS_H
+#define GDI32_OBJECTS_H
+
+#include <cstdint>
+
+#include <memory>
+#include <vector>
+
+#include "gdi32.h"
+#include "pixels.h"
+
+/*
+ * The objects behind GDI handles. Their handles are tagged as GDI objects in the handle table, and each starts with a
+ * magic value telling which one it is.
+ */
+namespace gdi {
+  namespace text {
+    class Face;
+  }
+
+  // top-down 32 bpp BGRA pixels; whatever GDI has not drawn on yet is transparent
+  struct Surface {
+    static std::shared_ptr<Surface> create(int width, int height) noexcept;
+
+    uint8_t* row(int y) noexcept {
+      return storage.get() + stride * y;
+    }
+
+    const uint8_t* row(int y) const noexcept {
+      return storage.get() + stride * y;
+    }
+
+    int width{0}, height{0};
+    size_t stride{0};
+    pixels::buffer_ptr storage;
+  };
+
+  /*
+   * The parts of a surface changed since they were last uploaded. Rectangles that overlap or touch are merged, and
+   * past k_MaxRects they all collapse into their bounding box, as many small uploads cost more than a larger one.
+   */
+  class DirtyRegion {
+   public:
+    static constexpr size_t k_MaxRects = 16;
+
+    void add(const RECT& rect) noexcept;
+
+    void clear() noexcept {
+      m_Rects.clear();
+    }
+
+    const std::vector<RECT>& rects() const noexcept {
+      return m_Rects;
+    }
+
+   private:
+    std::vector<RECT> m_Rects;
+  };
+
+  struct Object {
+    explicit Object(uint32_t magic) noexcept : magic{magic} {}
+    virtual ~Object() = default;
+
+    const uint32_t magic;
+  };
+
+  struct Brush : Object {
+    static constexpr uint32_t k_Magic = 0x42494447;    // "GDIB"
+
+    explicit Brush(COLORREF color) noexcept;
+
+    COLORREF color;
+    uint32_t pixel;    // opaque BGRA
+  };
+
+  struct Bitmap : Object {
+    static constexpr uint32_t k_Magic = 0x4D494447;    // "GDIM"
+
+    explicit Bitmap(std::shared_ptr<Surface> surface) noexcept : Object{k_Magic}, surface{std::move(surface)} {}
+
+    std::shared_ptr<Surface> surface;
+    // DCs it is selected into; it cannot be deleted until that is 0
+    int selections{0};
+  };
+
+  struct Font : Object {
+    static constexpr uint32_t k_Magic = 0x46494447;    // "GDIF"
+
+    Font(const LOGFONTA& logfont, std::shared_ptr<text::Face> face) noexcept
+        : Object{k_Magic}, logfont{logfont}, face{std::move(face)} {}
+
+    LOGFONTA logfont;
+    std::shared_ptr<text::Face> face;
+    // DCs it is selected into; it cannot be deleted until that is 0
+    int selections{0};
+  };
+
+  /*
+   * Window DCs draw on the overlay of their window. Memory DCs (hwnd 0) draw on whatever bitmap is selected into
+   * them, starting with the 1x1 stock one.
+   */
+  struct DC : Object {
+    static constexpr uint32_t k_Magic = 0x44494447;    // "GDID"
+
+    DC(HWND hwnd, std::shared_ptr<Surface> surface) noexcept
+        : Object{k_Magic}, hwnd{hwnd}, surface{std::move(surface)} {}
+    ~DC() override;
+
+    // select a font (0 for the stock one) or a bitmap and return the previous one; bitmap must be a gdi::Bitmap
+    HFONT select_font(HFONT h) noexcept;
+    HBITMAP select_bitmap(HBITMAP h) noexcept;
+
+    // clips rect to the surface; false if nothing is left of it
+    bool clip(RECT& rect) const noexcept;
+
+    void fill(RECT rect, uint32_t pixel) noexcept;
+
+    HWND hwnd;
+    std::shared_ptr<Surface> surface;
+    HBITMAP bitmap{0};
+    HFONT font{0};
+    int stretchMode{BLACKONWHITE};
+    COLORREF textColor{0x000000};
+    COLORREF bkColor{0xFFFFFF};
+    int bkMode{OPAQUE};
+    DirtyRegion dirty;
+  };
+
+  // what every memory DC starts with (a 1x1 bitmap), and every DC (the default font); neither can be deleted
+  HBITMAP stock_bitmap() noexcept;
+  HFONT stock_font() noexcept;
+
+  // COLORREF to opaque BGRA
+  constexpr uint32_t to_pixel(COLORREF color) noexcept {
+    return 0xFF000000 | ((color & 0xFF) << 16) | (color & 0xFF00) | ((color >> 16) & 0xFF);
+  }
+
+  // takes ownership of the object; 0 if it is null (out of memory)
+  HANDLE add(Object* object) noexcept;
+  // handle must be one get() has accepted
+  void destroy(HANDLE handle) noexcept;
+
+  template <typename T>
+  T* get(HANDLE handle) noexcept {
+    auto* o = static_cast<Object*>(handle ? fromHANDLE(handle, HandleKind::eGdiObject) : nullptr);
+    return (o && o->magic == T::k_Magic ? static_cast<T*>(o) : nullptr);
+  }
+}    // namespace gdi
+
+#endif
@@ -0,0 +1,413 @@
+#include "text.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <new>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include <fontconfig/fontconfig.h>
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include FT_SYNTHESIS_H
+
+#include <unicode.hpp>
+
+#include "log.h"
+
+namespace gdi::text {
+  namespace {
+    // cell height of fonts asking for height 0
+    constexpr LONG k_DefaultHeight = 16;
+    // glyphs are packed into pages this many pixels square; larger ones get a page of their own
+    constexpr int k_PageSize = 256;
+    // strings remembered per face; past this the cache starts over
+    constexpr size_t k_MaxRuns = 1024;
+
+    struct Glyph {
+      size_t page;
+      int x, y, width, height;    // in the page
+      int left, top;              // from the pen position on the baseline
+      FT_Pos advance;             // 26.6
+    };
+
+    // 8 bit coverage, filled shelf by shelf: glyphs go left to right along a shelf as high as its tallest glyph
+    class Page {
+     public:
+      Page(int width, int height) : width{width}, height{height}, coverage(size_t(width) * height) {}
+
+      bool place(int w, int h, int& x, int& y) noexcept {
+        if(m_X + w > width) {
+          m_Y += m_ShelfHeight;
+          m_X = m_ShelfHeight = 0;
+        }
+        if(w > width || m_Y + h > height)
+          return false;
+
+        x = m_X;
+        y = m_Y;
+        m_X += w + 1;
+        m_ShelfHeight = std::max(m_ShelfHeight, h + 1);
+        return true;
+      }
+
+      int width, height;
+      std::vector<uint8_t> coverage;
+
+     private:
+      int m_X{0}, m_Y{0}, m_ShelfHeight{0};
+    };
+
+    // a line of text, as glyphs and their pen positions
+    struct Run {
+      struct Placed {
+        FT_UInt index;
+        int x;
+      };
+
+      std::vector<Placed> glyphs;
+      int width{0};
+    };
+
+    // FreeType isn't thread safe, so this guards the library and every face. Recursive, as a face may be released
+    // while it is held.
+    std::recursive_mutex s_Mutex;
+
+    FT_Library library() {
+      static FT_Library s_Library = [] {
+        FT_Library lib = nullptr;
+        if(FT_Init_FreeType(&lib) != 0) {
+          spdlog::error("Failed to initialise FreeType");
+          return FT_Library{nullptr};
+        }
+        return lib;
+      }();
+      return s_Library;
+    }
+
+    // straight alpha "over" of an opaque colour at the given coverages
+    void blend(uint8_t* dst, const uint8_t* coverage, size_t count, uint32_t color) noexcept {
+      const int c[3] = {int(color & 0xFF), int((color >> 8) & 0xFF), int((color >> 16) & 0xFF)};
+
+      for(size_t ii = 0; ii < count; ++ii, dst += 4) {
+        const int a = coverage[ii];
+        if(a == 0)
+          continue;
+
+        const int da = dst[3];
+        if(a == 255 || da == 0) {
+          dst[0] = uint8_t(c[0]);
+          dst[1] = uint8_t(c[1]);
+          dst[2] = uint8_t(c[2]);
+          dst[3] = uint8_t(std::max(a, da));
+          continue;
+        }
+
+        const int wa = a * 255, wd = da * (255 - a), sum = wa + wd;
+        for(int cc = 0; cc < 3; ++cc)
+          dst[cc] = uint8_t((c[cc] * wa + dst[cc] * wd + sum / 2) / sum);
+        dst[3] = uint8_t((sum + 127) / 255);
+      }
+    }
+
+    inline RECT intersect(const RECT& a, const RECT& b) noexcept {
+      return RECT{std::max(a.left, b.left), std::max(a.top, b.top), std::min(a.right, b.right),
+                  std::min(a.bottom, b.bottom)};
+    }
+
+    inline bool empty(const RECT& r) noexcept {
+      return r.left >= r.right || r.top >= r.bottom;
+    }
+  }    // namespace
+
+  class Face {
+   public:
+    Face(FT_Face face, bool embolden, bool oblique) noexcept
+        : m_Face{face}, m_Embolden{embolden}, m_Oblique{oblique},
+          m_Ascent{int((face->size->metrics.ascender + 63) >> 6)},
+          m_Descent{int((-face->size->metrics.descender + 63) >> 6)} {}
+
+    ~Face() {
+      std::lock_guard lock{s_Mutex};
+      FT_Done_Face(m_Face);
+    }
+
+    int ascent() const noexcept {
+      return m_Ascent;
+    }
+
+    int height() const noexcept {
+      return m_Ascent + m_Descent;
+    }
+
+    const Page& page(size_t index) const noexcept {
+      return m_Pages[index];
+    }
+
+    const Glyph& glyph(FT_UInt index) {
+      auto it = m_Glyphs.find(index);
+      if(it != m_Glyphs.end())
+        return it->second;
+
+      // a glyph that fails to render is remembered as a blank one, so it is not tried again
+      Glyph g{};
+      if(!rasterize(index, g))
+        g = Glyph{};
+      return m_Glyphs.emplace(index, g).first->second;
+    }
+
+    const Run& run(std::string_view utf8) {
+      m_Key.assign(utf8.data(), utf8.size());
+
+      auto it = m_Runs.find(m_Key);
+      if(it != m_Runs.end())
+        return it->second;
+
+      if(m_Runs.size() >= k_MaxRuns)
+        m_Runs.clear();
+
+      return m_Runs.emplace(m_Key, shape(utf8)).first->second;
+    }
+
+   private:
+    // no ligatures or reordering, just characters to glyphs with kerning
+    Run shape(std::string_view utf8) {
+      Run run;
+
+      auto text = unicode::fromUTF8(utf8);
+      if(!text)
+        return run;
+
+      FT_Pos pen = 0;
+      FT_UInt previous = 0;
+      for(size_t ii = 0; ii < text->size(); ++ii) {
+        char32_t cp = (*text)[ii];
+        if(cp >= 0xD800 && cp < 0xDC00 && ii + 1 < text->size())
+          cp = 0x10000 + ((cp - 0xD800) << 10) + ((*text)[++ii] - 0xDC00);
+
+        const FT_UInt index = FT_Get_Char_Index(m_Face, cp);
+
+        FT_Vector kerning;
+        if(previous && FT_HAS_KERNING(m_Face) &&
+           FT_Get_Kerning(m_Face, previous, index, FT_KERNING_DEFAULT, &kerning) == 0)
+          pen += kerning.x;
+
+        run.glyphs.push_back(Run::Placed{index, int((pen + 32) >> 6)});
+        pen += glyph(index).advance;
+        previous = index;
+      }
+
+      run.width = int((pen + 32) >> 6);
+      return run;
+    }
+
+    bool rasterize(FT_UInt index, Glyph& out) {
+      if(FT_Load_Glyph(m_Face, index, FT_LOAD_NO_BITMAP) != 0)
+        return false;
+
+      FT_GlyphSlot slot = m_Face->glyph;
+      if(m_Oblique)
+        FT_GlyphSlot_Oblique(slot);
+      if(m_Embolden)
+        FT_GlyphSlot_Embolden(slot);
+      if(FT_Render_Glyph(slot, FT_RENDER_MODE_NORMAL) != 0)
+        return false;
+
+      const FT_Bitmap& bitmap = slot->bitmap;
+      out.left = slot->bitmap_left;
+      out.top = slot->bitmap_top;
+      out.advance = slot->advance.x;
+      out.width = int(bitmap.width);
+      out.height = int(bitmap.rows);
+      if(out.width == 0 || out.height == 0)
+        return true;
+
+      if(m_Pages.empty() || !m_Pages.back().place(out.width, out.height, out.x, out.y)) {
+        m_Pages.emplace_back(std::max(k_PageSize, out.width), std::max(k_PageSize, out.height));
+        m_Pages.back().place(out.width, out.height, out.x, out.y);
+      }
+      out.page = m_Pages.size() - 1;
+
+      Page& page = m_Pages.back();
+      for(int y = 0; y < out.height; ++y)
+        std::memcpy(page.coverage.data() + size_t(page.width) * (out.y + y) + out.x, bitmap.buffer + bitmap.pitch * y,
+                    out.width);
+
+      return true;
+    }
+
+    FT_Face m_Face;
+    bool m_Embolden, m_Oblique;
+    int m_Ascent, m_Descent;
+
+    std::vector<Page> m_Pages;
+    std::unordered_map<FT_UInt, Glyph> m_Glyphs;
+    std::unordered_map<std::string, Run> m_Runs;
+    std::string m_Key;    // kept around so that lookups don't allocate
+  };
+
+  namespace {
+    std::shared_ptr<Face> face_of(const DC& dc) noexcept {
+      auto* font = get<Font>(dc.font ? dc.font : stock_font());
+      return (font ? font->face : nullptr);
+    }
+
+    struct Match {
+      std::string file;
+      int index;
+      int weight, slant;
+    };
+
+    bool match(const std::string& family, LONG weight, bool italic, Match& out) {
+      FcPattern* pattern = FcPatternCreate();
+      if(!pattern)
+        return false;
+
+      FcPatternAddString(pattern, FC_FAMILY, reinterpret_cast<const FcChar8*>(family.c_str()));
+      FcPatternAddInteger(pattern, FC_WEIGHT, FcWeightFromOpenType(weight == FW_DONTCARE ? FW_NORMAL : weight));
+      FcPatternAddInteger(pattern, FC_SLANT, (italic ? FC_SLANT_ITALIC : FC_SLANT_ROMAN));
+      FcConfigSubstitute(nullptr, pattern, FcMatchPattern);
+      FcDefaultSubstitute(pattern);
+
+      FcResult result;
+      FcPattern* font = FcFontMatch(nullptr, pattern, &result);
+      FcPatternDestroy(pattern);
+      if(!font)
+        return false;
+
+      FcChar8* file = nullptr;
+      bool ok = (FcPatternGetString(font, FC_FILE, 0, &file) == FcResultMatch);
+      if(ok) {
+        out.file = reinterpret_cast<const char*>(file);
+        if(FcPatternGetInteger(font, FC_INDEX, 0, &out.index) != FcResultMatch)
+          out.index = 0;
+        if(FcPatternGetInteger(font, FC_WEIGHT, 0, &out.weight) != FcResultMatch)
+          out.weight = FC_WEIGHT_REGULAR;
+        if(FcPatternGetInteger(font, FC_SLANT, 0, &out.slant) != FcResultMatch)
+          out.slant = FC_SLANT_ROMAN;
+      }
+
+      FcPatternDestroy(font);
+      return ok;
+    }
+  }    // namespace
+}    // namespace gdi::text
+
+std::shared_ptr<gdi::text::Face> gdi::text::find(const LOGFONTA& logfont) noexcept {
+  using Key = std::tuple<std::string, LONG, LONG, bool>;
+  static std::map<Key, std::weak_ptr<Face>> s_Faces;
+
+  std::string family{logfont.lfFaceName, strnlen(logfont.lfFaceName, LF_FACESIZE)};
+  if(family.empty())
+    family = "sans-serif";
+
+  const LONG height = (logfont.lfHeight ? logfont.lfHeight : k_DefaultHeight);
+  const bool italic = (logfont.lfItalic != 0);
+  const Key key{family, height, logfont.lfWeight, italic};
+
+  std::lock_guard lock{s_Mutex};
+
+  auto& cached = s_Faces[key];
+  if(auto face = cached.lock())
+    return face;
+
+  Match m;
+  if(!library() || !match(family, logfont.lfWeight, italic, m)) {
+    spdlog::warn("No font found for '{}'", family);
+    return nullptr;
+  }
+
+  FT_Face ftFace;
+  if(FT_New_Face(library(), m.file.c_str(), m.index, &ftFace) != 0) {
+    spdlog::warn("Failed to load font file '{}'", m.file);
+    return nullptr;
+  }
+
+  // negative heights are the em size, positive ones the whole cell
+  FT_Size_RequestRec request{};
+  request.type = (height < 0 ? FT_SIZE_REQUEST_TYPE_NOMINAL : FT_SIZE_REQUEST_TYPE_REAL_DIM);
+  request.height = FT_Long(std::abs(height)) << 6;
+  if(FT_Request_Size(ftFace, &request) != 0) {
+    FT_Done_Face(ftFace);
+    return nullptr;
+  }
+
+  const bool embolden = (logfont.lfWeight >= FW_SEMIBOLD && m.weight < FC_WEIGHT_DEMIBOLD);
+  const bool oblique = (italic && m.slant == FC_SLANT_ROMAN);
+
+  auto face = std::shared_ptr<Face>{new(std::nothrow) Face{ftFace, embolden, oblique}};
+  if(!face) {
+    FT_Done_Face(ftFace);
+    return nullptr;
+  }
+
+  cached = face;
+  return face;
+}
+
+bool gdi::text::measure(const DC& dc, std::string_view utf8, SIZE& size) noexcept {
+  auto face = face_of(dc);
+  if(!face)
+    return false;
+
+  std::lock_guard lock{s_Mutex};
+
+  size.cx = face->run(utf8).width;
+  size.cy = face->height();
+  return true;
+}
+
+bool gdi::text::draw(DC& dc, int x, int y, std::string_view utf8, const RECT* clip) noexcept {
+  auto face = face_of(dc);
+  if(!face)
+    return false;
+
+  std::lock_guard lock{s_Mutex};
+
+  Surface& surface = *dc.surface;
+  RECT bounds{0, 0, surface.width, surface.height};
+  if(clip)
+    bounds = intersect(bounds, *clip);
+
+  const Run& run = face->run(utf8);
+  const RECT cell = intersect(RECT{x, y, x + run.width, y + face->height()}, bounds);
+  if(empty(cell))
+    return true;
+
+  if(dc.bkMode == OPAQUE)
+    dc.fill(cell, to_pixel(dc.bkColor));
+
+  const uint32_t color = to_pixel(dc.textColor);
+  const int baseline = y + face->ascent();
+  RECT drawn = cell;
+
+  for(const Run::Placed& placed : run.glyphs) {
+    const Glyph& g = face->glyph(placed.index);
+    if(g.width == 0)
+      continue;
+
+    const int gx = x + placed.x + g.left, gy = baseline - g.top;
+    const RECT box = intersect(RECT{gx, gy, gx + g.width, gy + g.height}, bounds);
+    if(empty(box))
+      continue;
+
+    const Page& page = face->page(g.page);
+    for(LONG yy = box.top; yy < box.bottom; ++yy) {
+      const uint8_t* coverage = page.coverage.data() + size_t(page.width) * (g.y + yy - gy) + g.x + (box.left - gx);
+      blend(surface.row(yy) + 4 * box.left, coverage, box.right - box.left, color);
+    }
+
+    // glyphs may reach a little outside their cell
+    drawn = RECT{std::min(drawn.left, box.left), std::min(drawn.top, box.top), std::max(drawn.right, box.right),
+                 std::max(drawn.bottom, box.bottom)};
+  }
+
+  dc.dirty.add(drawn);
+  return true;
+}
@@ -0,0 +1,28 @@
+#ifndef GDI32_TEXT_H
+#define GDI32_TEXT_H
+
+#include <memory>
+#include <string_view>
+
+#include "objects.h"
+
+/*
+ * Text through FreeType. Every face (a font file at one size) keeps its rasterized glyphs in atlas pages, and the
+ * glyph runs of the strings it was asked about, so measuring or drawing a string again touches neither FreeType nor
+ * the UTF-8 decoder.
+ */
+namespace gdi::text {
+  // the closest installed font, shared by every logical font that matches it; nullptr if none could be loaded
+  std::shared_ptr<Face> find(const LOGFONTA& logfont) noexcept;
+
+  // the cell of a single line in the font selected into dc, with the given text; false if there is no usable font
+  bool measure(const DC& dc, std::string_view utf8, SIZE& size) noexcept;
+
+  /*
+   * Draws a single line with the top left of its cell at (x, y), filling the cell first if the DC's background mode
+   * is OPAQUE. Nothing outside clip (if given) or the surface is touched.
+   */
+  bool draw(DC& dc, int x, int y, std::string_view utf8, const RECT* clip) noexcept;
+}    // namespace gdi::text
+
+#endif
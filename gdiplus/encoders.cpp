@@ -0,0 +1,455 @@
+#include "encoders.h"
+
+#include <csetjmp>
+#include <cstdio>
+#include <cstring>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <initializer_list>
+#include <deque>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <png.h>
+#include <zlib.h>
+
+#include "log.h"
+#include "threadpool.h"
+
+namespace gdiplus::encoders {
+  namespace {
+    struct Codec {
+      const char* clsid;
+      Format format;
+    };
+
+    constexpr Codec k_Codecs[] = {
+        {"557cf400-1a04-11d3-9a73-0000f81ef32e", Format::eBmp},
+        {"557cf406-1a04-11d3-9a73-0000f81ef32e", Format::ePng},
+    };
+
+    // below this much filtered image data, starting the workers costs more than it saves
+    constexpr size_t k_MinParallelBytes = 1 << 20;
+    // and every stripe gets at least this much, so the restarted compression doesn't hurt the ratio too much
+    constexpr size_t k_MinStripeBytes = 128 << 10;
+
+    std::atomic<UINT> s_Workers{0};
+
+    struct Job {
+      Format format;
+      std::string path;
+      Snapshot snapshot;
+    };
+
+    bool has_alpha(PixelFormat format) noexcept {
+      return (format == PixelFormat32bppARGB || format == PixelFormat32bppPARGB);
+    }
+
+    // 255 / a in 16.16 fixed point, so un-premultiplying doesn't divide per channel
+    constexpr auto k_Reciprocals = []() {
+      std::array<uint32_t, 256> r{};
+      for(uint32_t a = 1; a < 256; ++a)
+        r[a] = ((255u << 16) + a / 2) / a;
+      return r;
+    }();
+
+    void unpremultiply(const BYTE* src, BYTE* dst, INT count) noexcept {
+      for(INT ii = 0; ii < count; ++ii, src += 4, dst += 4) {
+        const uint32_t a = src[3], r = k_Reciprocals[a];
+        for(int cc = 0; cc < 3; ++cc)
+          dst[cc] = BYTE(std::min<uint32_t>(255, (src[cc] * r + 0x8000) >> 16));
+        dst[3] = BYTE(a);
+      }
+    }
+
+    bool write_bytes(FILE* fp, const void* data, size_t size) {
+      return std::fwrite(data, 1, size, fp) == size;
+    }
+
+    bool write_u16le(FILE* fp, uint16_t v) {
+      const BYTE b[2] = {BYTE(v), BYTE(v >> 8)};
+      return write_bytes(fp, b, sizeof(b));
+    }
+
+    bool write_u32le(FILE* fp, uint32_t v) {
+      const BYTE b[4] = {BYTE(v), BYTE(v >> 8), BYTE(v >> 16), BYTE(v >> 24)};
+      return write_bytes(fp, b, sizeof(b));
+    }
+
+    void store_u32be(BYTE* p, uint32_t v) noexcept {
+      p[0] = BYTE(v >> 24);
+      p[1] = BYTE(v >> 16);
+      p[2] = BYTE(v >> 8);
+      p[3] = BYTE(v);
+    }
+
+    /*
+     * The snapshot rows already are DIB rows, so this only writes them bottom-up (with the DIB row padding). Premultiplied
+     * pixels are the only ones that need converting.
+     */
+    bool write_bmp(FILE* fp, const Snapshot& s) {
+      const UINT bpp = gdiplus::bits_per_pixel(s.format);
+      const size_t dibStride = ((size_t(s.width) * bpp + 31) / 32) * 4;
+      const size_t imageSize = dibStride * s.height;
+      constexpr uint32_t k_HeadersSize = 14 + 40;
+
+      if(imageSize + k_HeadersSize > UINT32_MAX)
+        return false;
+
+      bool ok = write_bytes(fp, "BM", 2) && write_u32le(fp, k_HeadersSize + imageSize) && write_u32le(fp, 0) &&
+                write_u32le(fp, k_HeadersSize);
+      ok = ok && write_u32le(fp, 40) && write_u32le(fp, s.width) && write_u32le(fp, s.height) && write_u16le(fp, 1) &&
+           write_u16le(fp, bpp) && write_u32le(fp, BI_RGB) && write_u32le(fp, imageSize) && write_u32le(fp, 0) &&
+           write_u32le(fp, 0) && write_u32le(fp, 0) && write_u32le(fp, 0);
+
+      std::vector<BYTE> row(dibStride, 0);
+      for(INT y = s.height - 1; ok && y >= 0; --y) {
+        const BYTE* src = s.pixels.get() + s.stride * y;
+        if(s.format == PixelFormat32bppPARGB) {
+          unpremultiply(src, row.data(), s.width);
+        } else if(dibStride == s.stride) {
+          ok = write_bytes(fp, src, s.stride);
+          continue;
+        } else {
+          std::memcpy(row.data(), src, s.stride);
+        }
+        ok = write_bytes(fp, row.data(), dibStride);
+      }
+
+      return ok;
+    }
+
+    bool write_chunk(FILE* fp, const char* type, std::initializer_list<std::pair<const BYTE*, size_t>> parts) {
+      size_t length = 0;
+      uLong crc = crc32(0, reinterpret_cast<const Bytef*>(type), 4);
+      for(auto [data, size] : parts) {
+        length += size;
+        crc = crc32_z(crc, data, size);
+      }
+
+      BYTE header[8], trailer[4];
+      store_u32be(header, length);
+      std::memcpy(header + 4, type, 4);
+      store_u32be(trailer, crc);
+
+      bool ok = write_bytes(fp, header, sizeof(header));
+      for(auto [data, size] : parts)
+        ok = ok && write_bytes(fp, data, size);
+      return ok && write_bytes(fp, trailer, sizeof(trailer));
+    }
+
+    struct Stripe {
+      INT first, count;
+      std::vector<BYTE> deflated;
+      uLong adler;
+      size_t rawSize;
+      bool ok;
+    };
+
+    // one filtered scanline: the filter type byte, then the SUB-filtered RGB(A) bytes; scratch holds 8 bytes per pixel
+    void filter_row(const Snapshot& s, INT y, UINT channels, BYTE* scratch, BYTE* out) noexcept {
+      const BYTE* src = s.pixels.get() + s.stride * y;
+      const UINT srcBytes = gdiplus::bits_per_pixel(s.format) / 8;
+
+      BYTE* line = scratch;
+      if(s.format == PixelFormat32bppPARGB) {
+        unpremultiply(src, scratch + size_t(4) * s.width, s.width);
+        src = scratch + size_t(4) * s.width;
+      }
+
+      for(INT x = 0; x < s.width; ++x) {
+        const BYTE* px = src + srcBytes * x;
+        BYTE* dst = line + channels * x;
+        dst[0] = px[2];
+        dst[1] = px[1];
+        dst[2] = px[0];
+        if(channels == 4)
+          dst[3] = px[3];
+      }
+
+      out[0] = PNG_FILTER_VALUE_SUB;
+      const size_t lineBytes = size_t(channels) * s.width;
+      for(size_t ii = 0; ii < lineBytes; ++ii)
+        out[1 + ii] = line[ii] - (ii >= channels ? line[ii - channels] : 0);
+    }
+
+    // raw deflate of the stripe's scanlines, ending on a byte boundary (or the final block for the last stripe)
+    void compress_stripe(const Snapshot& s, UINT channels, Stripe& stripe, bool last) {
+      const size_t scanline = 1 + size_t(channels) * s.width;
+      std::vector<BYTE> raw(scanline * stripe.count), scratch(size_t(8) * s.width);
+      for(INT ii = 0; ii < stripe.count; ++ii)
+        filter_row(s, stripe.first + ii, channels, scratch.data(), raw.data() + scanline * ii);
+
+      stripe.rawSize = raw.size();
+      stripe.adler = adler32_z(adler32(0, nullptr, 0), raw.data(), raw.size());
+
+      z_stream z{};
+      // same settings libpng uses for filtered images
+      if(deflateInit2(&z, Z_BEST_SPEED, Z_DEFLATED, -MAX_WBITS, 8, Z_FILTERED) != Z_OK) {
+        stripe.ok = false;
+        return;
+      }
+
+      // the bound doesn't count the empty block a sync flush ends with
+      stripe.deflated.resize(deflateBound(&z, raw.size()) + 16);
+      z.next_in = raw.data();
+      z.avail_in = raw.size();
+      z.next_out = stripe.deflated.data();
+      z.avail_out = stripe.deflated.size();
+
+      int res = deflate(&z, last ? Z_FINISH : Z_SYNC_FLUSH);
+      stripe.ok = (last ? res == Z_STREAM_END : res == Z_OK && z.avail_in == 0 && z.avail_out > 0);
+      stripe.deflated.resize(z.total_out);
+      deflateEnd(&z);
+    }
+
+    /*
+     * pigz-style: horizontal stripes are filtered and deflated independently on the shared thread pool, and the raw
+     * deflate streams are concatenated into one zlib stream (one IDAT chunk per stripe). The SUB filter only looks at
+     * the current row, so stripes don't depend on each other.
+     */
+    bool write_png_parallel(FILE* fp, const Snapshot& s, size_t workers) {
+      const UINT channels = (has_alpha(s.format) ? 4 : 3);
+      const size_t scanline = 1 + size_t(channels) * s.width;
+
+      const size_t stripeCount = std::clamp<size_t>(s.height * scanline / k_MinStripeBytes, 1, 4 * workers);
+      std::vector<Stripe> stripes(std::min<size_t>(stripeCount, s.height));
+      for(size_t ii = 0; ii < stripes.size(); ++ii) {
+        stripes[ii].first = INT(s.height * ii / stripes.size());
+        stripes[ii].count = INT(s.height * (ii + 1) / stripes.size()) - stripes[ii].first;
+      }
+
+      // worker ww takes stripes ww, ww + workers, ...
+      threads::parallel_for(std::min(workers, stripes.size()), [&](size_t ww) {
+        for(size_t ii = ww; ii < stripes.size(); ii += workers)
+          compress_stripe(s, channels, stripes[ii], ii + 1 == stripes.size());
+      });
+
+      uLong adler = adler32(0, nullptr, 0);
+      for(const Stripe& stripe : stripes) {
+        if(!stripe.ok)
+          return false;
+        adler = adler32_combine(adler, stripe.adler, stripe.rawSize);
+      }
+
+      BYTE ihdr[13];
+      store_u32be(ihdr, s.width);
+      store_u32be(ihdr + 4, s.height);
+      ihdr[8] = 8;
+      ihdr[9] = (channels == 4 ? PNG_COLOR_TYPE_RGB_ALPHA : PNG_COLOR_TYPE_RGB);
+      ihdr[10] = ihdr[11] = ihdr[12] = 0;
+
+      // deflate with a 32K window at the fastest level
+      const BYTE zlibHeader[2] = {0x78, 0x01};
+      BYTE zlibTrailer[4];
+      store_u32be(zlibTrailer, adler);
+
+      static constexpr BYTE k_Signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+      bool ok = write_bytes(fp, k_Signature, sizeof(k_Signature)) && write_chunk(fp, "IHDR", {{ihdr, sizeof(ihdr)}});
+      for(size_t ii = 0; ok && ii < stripes.size(); ++ii) {
+        const Stripe& stripe = stripes[ii];
+        if(ii == 0)
+          ok = write_chunk(fp, "IDAT", {{zlibHeader, sizeof(zlibHeader)}, {stripe.deflated.data(), stripe.deflated.size()}});
+        else
+          ok = write_chunk(fp, "IDAT", {{stripe.deflated.data(), stripe.deflated.size()}});
+      }
+
+      return ok && write_chunk(fp, "IDAT", {{zlibTrailer, sizeof(zlibTrailer)}}) && write_chunk(fp, "IEND", {});
+    }
+
+    /*
+     * Screenshots are large and written often, so this trades size for speed: the fastest zlib level and only the
+     * cheap SUB filter.
+     */
+    bool write_png(FILE* fp, const Snapshot& s) {
+      png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+      png_infop info = (png ? png_create_info_struct(png) : nullptr);
+
+      // constructed before setjmp, so a longjmp back here doesn't skip its destructor
+      std::vector<BYTE> row(s.format == PixelFormat32bppPARGB ? s.stride : 0);
+
+      if(!info || setjmp(png_jmpbuf(png))) {
+        png_destroy_write_struct(&png, &info);
+        return false;
+      }
+
+      png_init_io(png, fp);
+      png_set_compression_level(png, Z_BEST_SPEED);
+      png_set_filter(png, PNG_FILTER_TYPE_BASE, PNG_FILTER_SUB);
+
+      png_set_IHDR(png, info, s.width, s.height, 8, (has_alpha(s.format) ? PNG_COLOR_TYPE_RGB_ALPHA : PNG_COLOR_TYPE_RGB),
+                   PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+      png_write_info(png, info);
+
+      // GDI+ pixels are BGR(A) in memory; libpng swaps them and strips the unused byte of 32bppRGB
+      png_set_bgr(png);
+      if(s.format == PixelFormat32bppRGB)
+        png_set_filler(png, 0, PNG_FILLER_AFTER);
+
+      for(INT y = 0; y < s.height; ++y) {
+        BYTE* src = s.pixels.get() + s.stride * y;
+        if(s.format == PixelFormat32bppPARGB) {
+          unpremultiply(src, row.data(), s.width);
+          src = row.data();
+        }
+        png_write_row(png, src);
+      }
+
+      png_write_end(png, nullptr);
+      png_destroy_write_struct(&png, &info);
+      return true;
+    }
+
+    bool write(const Job& job) {
+      const std::string tmpPath = job.path + ".tmp";
+
+      FILE* fp = std::fopen(tmpPath.c_str(), "wb");
+      if(!fp)
+        return false;
+
+      // large images are written in big chunks anyway, so a bigger buffer saves system calls
+      std::setvbuf(fp, nullptr, _IOFBF, 1 << 20);
+
+      const Snapshot& s = job.snapshot;
+      const UINT workers = s_Workers.load(std::memory_order_relaxed);
+      const size_t workerCount = (workers == 0 ? threads::concurrency() : workers);
+
+      bool ok = false;
+      switch(job.format) {
+        case Format::eBmp:
+          ok = write_bmp(fp, s);
+          break;
+
+        case Format::ePng:
+          if(workerCount > 1 && s.stride * s.height >= k_MinParallelBytes)
+            ok = write_png_parallel(fp, s, workerCount);
+          else
+            ok = write_png(fp, s);
+          break;
+      }
+
+      ok = (std::fclose(fp) == 0) && ok;
+      if(ok)
+        ok = (std::rename(tmpPath.c_str(), job.path.c_str()) == 0);
+      if(!ok)
+        std::remove(tmpPath.c_str());
+
+      return ok;
+    }
+
+    class Writer {
+     public:
+      Writer() : m_Thread{[this]() { run(); }} {}
+
+      // whatever is still queued at exit gets written first
+      ~Writer() {
+        {
+          std::lock_guard lock{m_Mutex};
+          m_Stop = true;
+        }
+        m_Wake.notify_all();
+        m_Thread.join();
+      }
+
+      void submit(Job job) {
+        {
+          std::lock_guard lock{m_Mutex};
+          m_Jobs.push_back(std::move(job));
+        }
+        m_Wake.notify_all();
+      }
+
+      void flush() {
+        std::unique_lock lock{m_Mutex};
+        m_Idle.wait(lock, [this]() { return m_Jobs.empty() && !m_Busy; });
+      }
+
+     private:
+      void run() {
+        std::unique_lock lock{m_Mutex};
+
+        while(true) {
+          m_Wake.wait(lock, [this]() { return m_Stop || !m_Jobs.empty(); });
+          if(m_Jobs.empty())
+            return;
+
+          Job job = std::move(m_Jobs.front());
+          m_Jobs.pop_front();
+          m_Busy = true;
+          lock.unlock();
+
+          if(!write(job))
+            spdlog::error("gdiplus: failed to write image to {}", job.path);
+
+          job.snapshot.pixels.reset();
+
+          lock.lock();
+          m_Busy = false;
+          if(m_Jobs.empty())
+            m_Idle.notify_all();
+        }
+      }
+
+
+      std::mutex m_Mutex;
+      std::condition_variable m_Wake;
+      std::condition_variable m_Idle;
+      std::deque<Job> m_Jobs;
+      bool m_Busy{false};
+      bool m_Stop{false};
+      std::thread m_Thread;
+    };
+
+    Writer& writer() {
+      static Writer s_Writer;
+      return s_Writer;
+    }
+  }    // namespace
+
+  std::optional<Format> find(const CLSID& clsid) {
+    static const auto s_Clsids = []() {
+      std::array<CLSID, std::size(k_Codecs)> clsids{};
+      for(size_t ii = 0; ii < clsids.size(); ++ii)
+        rpcrt4_UuidFromString(k_Codecs[ii].clsid, &clsids[ii]);
+      return clsids;
+    }();
+
+    for(size_t ii = 0; ii < s_Clsids.size(); ++ii) {
+      if(s_Clsids[ii] == clsid)
+        return k_Codecs[ii].format;
+    }
+
+    return std::nullopt;
+  }
+
+  std::optional<Snapshot> Snapshot::take(const GpBitmap& bitmap) {
+    Snapshot s{bitmap.width, bitmap.height, bitmap.format, bitmap.rowBytes(), nullptr};
+
+    s.pixels.reset(::pixels::allocate(s.stride * s.height, false));
+    if(!s.pixels)
+      return std::nullopt;
+
+    for(INT y = 0; y < s.height; ++y)
+      std::memcpy(s.pixels.get() + s.stride * y, bitmap.row(y), s.stride);
+
+    return s;
+  }
+
+  void submit(Format format, std::string path, Snapshot snapshot) {
+    writer().submit(Job{format, std::move(path), std::move(snapshot)});
+  }
+
+  void flush() {
+    writer().flush();
+  }
+
+  void set_workers(UINT count) noexcept {
+    s_Workers.store(count, std::memory_order_relaxed);
+  }
+}    // namespace gdiplus::encoders
@@ -0,0 +1,47 @@
+#ifndef GDIPLUS_ENCODERS_H
+#define GDIPLUS_ENCODERS_H
+
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "image.h"
+
+namespace gdiplus::encoders {
+  enum class Format {
+    eBmp,
+    ePng,
+  };
+
+  std::optional<Format> find(const CLSID& clsid);
+
+  /*
+   * Copy of a bitmap's rows (top-down, tightly packed), taken on the calling thread so the bitmap can change or go away
+   * while the snapshot is being encoded.
+   */
+  struct Snapshot {
+    INT width, height;
+    PixelFormat format;
+    size_t stride;
+    ::pixels::buffer_ptr pixels;
+
+    static std::optional<Snapshot> take(const GpBitmap& bitmap);
+  };
+
+  /*
+   * Encodes and writes the snapshot on the background writer thread. Files are written under a temporary name and
+   * renamed once complete, in the order they were submitted.
+   */
+  void submit(Format format, std::string path, Snapshot snapshot);
+
+  // waits until everything submitted so far has been written
+  void flush();
+
+  /*
+   * Number of threads a large PNG is compressed on; 0 (the default) uses every thread of the shared pool, 1 keeps
+   * everything on the writer thread.
+   */
+  void set_workers(UINT count) noexcept;
+}    // namespace gdiplus::encoders
+
+#endif    //GDIPLUS_ENCODERS_H
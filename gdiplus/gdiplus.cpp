@@ -1,25 +1,140 @@
 #include "gdiplus.h"
 
+#include <cstdlib>
+#include <cstring>
+
+#include <unicode.hpp>
+
+#include "encoders.h"
+#include "image.h"
+#include "objects.h"
+
 WIN32_API Status gdiplus_GdiplusStartup(ULONG_PTR* token, const GdiplusStartupInput* input,
                                         GdiplusStartupOutput* output) {
   return Ok;
 }
-WIN32_API void gdiplus_GdiplusShutdown(ULONG_PTR token) {}
+WIN32_API void gdiplus_GdiplusShutdown(ULONG_PTR token) {
+  gdiplus::encoders::flush();
+}
 WIN32_API GpStatus gdiplus_GdipDisposeImage(GpImage* image) {
+  if(!image)
+    return InvalidParameter;
+
+  delete image;
   return Ok;
 }
 WIN32_API GpStatus gdiplus_GdipSaveImageToFile(GpImage* image, const WCHAR* filename, const CLSID* clsidEncoder,
                                                const EncoderParameters* encoderParams) {
+  if(!image || !filename || !clsidEncoder)
+    return InvalidParameter;
+
+  auto* bitmap = dynamic_cast<GpBitmap*>(image);
+  if(!bitmap)
+    return InvalidParameter;
+
+  auto format = gdiplus::encoders::find(*clsidEncoder);
+  if(!format)
+    return UnknownImageFormat;
+
+  auto path = unicode::toUTF8(unicode::string_view{filename});
+  if(!path)
+    return InvalidParameter;
+
+  // only the copy happens here; encoding and writing are left to the background writer
+  auto snapshot = gdiplus::encoders::Snapshot::take(*bitmap);
+  if(!snapshot)
+    return OutOfMemory;
+
+  gdiplus::encoders::submit(*format, std::move(*path), std::move(*snapshot));
   return Ok;
 }
 WIN32_API GpStatus gdiplus_GdipCreateBitmapFromGdiDib(const BITMAPINFO* gdiBitmapInfo, void* gdiBitmapData,
                                                       GpBitmap** bitmap) {
+  if(!gdiBitmapInfo || !gdiBitmapData || !bitmap)
+    return InvalidParameter;
+
+  const BITMAPINFOHEADER& header = gdiBitmapInfo->bmiHeader;
+  const INT width = header.biWidth, height = std::abs(header.biHeight);
+  if(width <= 0 || height <= 0)
+    return InvalidParameter;
+
+  // BI_BITFIELDS is only accepted for 32 bpp, assuming the usual X8R8G8B8 masks
+  if(header.biCompression != BI_RGB && !(header.biCompression == BI_BITFIELDS && header.biBitCount == 32))
+    return NotImplemented;
+  if(header.biBitCount != 24 && header.biBitCount != 32)
+    return NotImplemented;
+
+  std::unique_ptr<GpBitmap> bmp = GpBitmap::create(width, height, PixelFormat32bppRGB);
+  if(!bmp)
+    return OutOfMemory;
+
+  // DIB rows are padded to 4 bytes and stored bottom-up unless the height is negative
+  const size_t srcStride = ((size_t(width) * header.biBitCount + 31) / 32) * 4;
+  const bool bottomUp = (header.biHeight > 0);
+  const auto* src = static_cast<const BYTE*>(gdiBitmapData);
+
+  for(INT y = 0; y < height; ++y) {
+    const BYTE* srcRow = src + srcStride * (bottomUp ? height - 1 - y : y);
+    if(header.biBitCount == 24)
+      pixels::bgr24_to_bgra32(srcRow, bmp->row(y), width);
+    else
+      pixels::bgrx32_to_bgra32(srcRow, bmp->row(y), width);
+  }
+
+  *bitmap = bmp.release();
   return Ok;
 }
 WIN32_API GpStatus gdiplus_GdipCreateBitmapFromHBITMAP(HBITMAP hbm, HPALETTE hpal, GpBitmap** bitmap) {
+  if(!bitmap)
+    return InvalidParameter;
+
+  *bitmap = nullptr;
+
+  auto* source = gdi::get<gdi::Bitmap>(hbm);
+  if(!source)
+    return InvalidParameter;
+
+  const gdi::Surface& surface = *source->surface;
+  std::unique_ptr<GpBitmap> bmp = GpBitmap::create(surface.width, surface.height, PixelFormat32bppRGB);
+  if(!bmp)
+    return OutOfMemory;
+
+  for(INT y = 0; y < surface.height; ++y)
+    pixels::bgrx32_to_bgra32(surface.row(y), bmp->row(y), surface.width);
+
+  *bitmap = bmp.release();
   return Ok;
 }
 WIN32_API GpStatus gdiplus_GdipCreateBitmapFromScan0(INT width, INT height, INT stride, PixelFormat format, BYTE* scan0,
                                                      GpBitmap** bitmap) {
+  if(!bitmap || width <= 0 || height <= 0 || !gdiplus::is_supported(format))
+    return InvalidParameter;
+
+  std::unique_ptr<GpBitmap> bmp;
+  if(!scan0) {
+    bmp = GpBitmap::create(width, height, format);
+  } else {
+    const size_t rowBytes = size_t(width) * gdiplus::bits_per_pixel(format) / 8;
+    const size_t absStride = std::abs(int64_t(stride));
+    if(absStride < rowBytes)
+      return InvalidParameter;
+
+    if(absStride % 4 == 0) {
+      // the caller keeps ownership of scan0 and has to keep it alive as long as the bitmap
+      bmp = GpBitmap::wrap(width, height, stride, format, scan0);
+    } else {
+      bmp = GpBitmap::create(width, height, format);
+      for(INT y = 0; bmp && y < height; ++y)
+        std::memcpy(bmp->row(y), scan0 + ptrdiff_t(y) * stride, rowBytes);
+    }
+  }
+
+  if(!bmp)
+    return OutOfMemory;
+
+  *bitmap = bmp.release();
   return Ok;
 }
+WIN32_API void gdiplus_SetEncoderWorkers(UINT count) {
+  gdiplus::encoders::set_workers(count);
+}
@@ -38,7 +38,12 @@ enum Status {
 };
 typedef Status GpStatus;
 
-enum PixelFormat {};
+enum PixelFormat {
+  PixelFormat24bppRGB   = 0x00021808,
+  PixelFormat32bppRGB   = 0x00022009,
+  PixelFormat32bppARGB  = 0x0026200A,
+  PixelFormat32bppPARGB = 0x000E200B
+};
 
 struct EncoderParameters;
 
@@ -76,6 +81,12 @@ WIN32_API GpStatus gdiplus_GdipCreateBitmapFromHBITMAP(HBITMAP hbm, HPALETTE hpa
 WIN32_API GpStatus gdiplus_GdipCreateBitmapFromScan0(INT width, INT height, INT stride, PixelFormat format, BYTE* scan0,
                                                      GpBitmap** bitmap);
 
+/*
+ * Not part of the GDI+ API: the number of threads large PNG images are compressed on. 0 (the default) uses all
+ * hardware threads and 1 disables parallel compression.
+ */
+WIN32_API void gdiplus_SetEncoderWorkers(UINT count);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,27 @@
+#include "image.h"
+
+#include <limits>
+#include <new>
+
+namespace {
+  constexpr int64_t k_MaxPixelBytes = std::numeric_limits<INT>::max();
+}
+
+std::unique_ptr<GpBitmap> GpBitmap::create(INT width, INT height, PixelFormat format) noexcept {
+  const int64_t stride = pixels::aligned_stride(size_t(width) * gdiplus::bits_per_pixel(format) / 8);
+  if(stride * height > k_MaxPixelBytes)
+    return nullptr;
+
+  pixels::buffer_ptr storage{pixels::allocate(stride * height)};
+  if(!storage)
+    return nullptr;
+
+  std::unique_ptr<GpBitmap> bitmap{new(std::nothrow) GpBitmap{width, height, INT(stride), format, storage.get()}};
+  if(bitmap)
+    bitmap->m_Storage = std::move(storage);
+  return bitmap;
+}
+
+std::unique_ptr<GpBitmap> GpBitmap::wrap(INT width, INT height, INT stride, PixelFormat format, BYTE* scan0) noexcept {
+  return std::unique_ptr<GpBitmap>{new(std::nothrow) GpBitmap{width, height, stride, format, scan0}};
+}
@@ -0,0 +1,62 @@
+#ifndef GDIPLUS_IMAGE_H
+#define GDIPLUS_IMAGE_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <memory>
+
+#include "gdiplus.h"
+
+#include "pixels.h"
+
+namespace gdiplus {
+  constexpr UINT bits_per_pixel(PixelFormat format) noexcept {
+    return (format >> 8) & 0xFF;
+  }
+
+  constexpr bool is_supported(PixelFormat format) noexcept {
+    switch(format) {
+      case PixelFormat24bppRGB:
+      case PixelFormat32bppRGB:
+      case PixelFormat32bppARGB:
+      case PixelFormat32bppPARGB:
+        return true;
+      default:
+        return false;
+    }
+  }
+}    // namespace gdiplus
+
+struct GpImage {
+  virtual ~GpImage() = default;
+};
+
+/*
+ * Pixels are either owned, with every row starting on a cache line, or borrowed from the caller's scan0 (the stride
+ * may then be negative, for bottom-up memory).
+ */
+struct GpBitmap : GpImage {
+  INT width, height, stride;
+  PixelFormat format;
+  BYTE* scan0;
+
+  static std::unique_ptr<GpBitmap> create(INT width, INT height, PixelFormat format) noexcept;
+  static std::unique_ptr<GpBitmap> wrap(INT width, INT height, INT stride, PixelFormat format, BYTE* scan0) noexcept;
+
+  [[nodiscard]] BYTE* row(INT y) const noexcept {
+    return scan0 + ptrdiff_t(y) * stride;
+  }
+
+  [[nodiscard]] size_t rowBytes() const noexcept {
+    return size_t(width) * gdiplus::bits_per_pixel(format) / 8;
+  }
+
+ private:
+  GpBitmap(INT width, INT height, INT stride, PixelFormat format, BYTE* scan0) noexcept
+      : width{width}, height{height}, stride{stride}, format{format}, scan0{scan0} {}
+
+  pixels::buffer_ptr m_Storage;
+};
+
+#endif    //GDIPLUS_IMAGE_H
@@ -0,0 +1,143 @@
+#include "wintypes.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+#include "log.h"
+
+
+//#include <map>
+//
+//namespace {
+//    std::map<void*, HANDLE> s_PtrToHANDLE = {{nullptr, 0}};
+//    std::map<HANDLE, void*> s_HANDLEToPtr = {{0, nullptr}};
+//}
+//
+//template <>
+//HANDLE newHANDLE(void* ptr) {
+//    auto it = s_PtrToHANDLE.find(ptr);
+//
+//    if(it == s_PtrToHANDLE.end()) {
+//        auto handle = s_PtrToHANDLE.crbegin()->second + 1;
+//        s_PtrToHANDLE[ptr] = handle;
+//        s_HANDLEToPtr[handle] = ptr;
+//
+//        return handle;
+//    }
+//
+//    return it->second;
+//}
+//
+//template <>
+//void* fromHANDLE(HANDLE handle) {
+//    return s_HANDLEToPtr.at(handle);
+//}
+
+namespace {
+    /*
+     * A handle is a slot index in its low bits and the slot's generation above them. Releasing a handle bumps the
+     * generation, so a stale handle kept by a script no longer resolves once its slot is reused for another object.
+     * Handles stay below 2^31, as scripts pack them into 32-bit integers.
+     */
+    constexpr unsigned k_IndexBits = 20;
+    constexpr unsigned k_GenerationBits = 11;
+    constexpr HANDLE k_IndexMask = (HANDLE(1) << k_IndexBits) - 1;
+    constexpr uint32_t k_GenerationMask = (uint32_t(1) << k_GenerationBits) - 1;
+
+    struct HandleSlot {
+        void* ptr;
+        uint32_t generation;
+        HandleKind kind;
+    };
+
+    // handles are created and looked up from helper threads too (message windows, for one)
+    std::shared_mutex s_HandlesMutex;
+    std::vector<HandleSlot> s_Handles = {{nullptr, 0, HandleKind::eWindow}};
+    std::vector<uint32_t> s_FreeHandles;
+
+    inline HANDLE makeHANDLE(size_t index) {
+        return HANDLE(index) | (HANDLE(s_Handles[index].generation) << k_IndexBits);
+    }
+
+    // the slot a handle refers to, if it is still alive
+    inline HandleSlot* findHANDLE(HANDLE handle) {
+        const size_t index = handle & k_IndexMask;
+        if(index == 0 || index >= s_Handles.size() || (handle >> k_IndexBits) != s_Handles[index].generation)
+            return nullptr;
+
+        return &s_Handles[index];
+    }
+
+    inline auto findPtr(void* ptr) {
+        return std::find_if(s_Handles.begin() + 1, s_Handles.end(), [ptr](const HandleSlot& slot) { return slot.ptr == ptr; });
+    }
+
+    inline auto findPtr(void* ptr, HandleKind kind) {
+        return std::find_if(s_Handles.begin() + 1, s_Handles.end(),
+                            [ptr, kind](const HandleSlot& slot) { return slot.ptr == ptr && slot.kind == kind; });
+    }
+}
+
+template <>
+HANDLE newHANDLE<HANDLE>(void* ptr, HandleKind kind) {
+    if(!ptr)
+        return 0;
+
+    std::unique_lock lock{s_HandlesMutex};
+
+    auto it = findPtr(ptr, kind);
+    if(it != s_Handles.end())
+        return makeHANDLE(std::distance(s_Handles.begin(), it));
+
+    size_t index;
+    if(!s_FreeHandles.empty()) {
+        index = s_FreeHandles.back();
+        s_FreeHandles.pop_back();
+    } else if(s_Handles.size() <= k_IndexMask) {
+        index = s_Handles.size();
+        s_Handles.push_back({nullptr, 0, kind});
+    } else {
+        spdlog::error("Out of handles");
+        return 0;
+    }
+
+    s_Handles[index].ptr = ptr;
+    s_Handles[index].kind = kind;
+    return makeHANDLE(index);
+}
+
+template <>
+void* fromHANDLE<HANDLE>(HANDLE handle, HandleKind kind) {
+    std::shared_lock lock{s_HandlesMutex};
+
+    auto* slot = findHANDLE(handle);
+    return (slot && slot->kind == kind ? slot->ptr : nullptr);
+}
+
+template <>
+HANDLE toHANDLE<HANDLE>(void* ptr) {
+  if(!ptr)
+    return 0;
+
+  std::shared_lock lock{s_HandlesMutex};
+
+  auto it = findPtr(ptr);
+  return (it != s_Handles.end() ? makeHANDLE(std::distance(s_Handles.begin(), it)) : 0);
+}
+
+template <>
+void releaseHANDLE<HANDLE>(HANDLE handle) {
+    std::unique_lock lock{s_HandlesMutex};
+
+    auto* slot = findHANDLE(handle);
+    if(!slot || !slot->ptr)
+        return;
+
+    slot->ptr = nullptr;
+    slot->generation = (slot->generation + 1) & k_GenerationMask;
+    s_FreeHandles.push_back(uint32_t(handle & k_IndexMask));
+}
@@ -1,5 +1,7 @@
 #include "kernel32.h"
 
+#include <time.h>
+
 #include <cstdlib>
 
 #include <unicode.hpp>
@@ -11,6 +13,22 @@
 namespace {
     thread_local DWORD tl_LastError = 0;
 
+    // the performance counter ticks in nanoseconds of CLOCK_MONOTONIC
+    constexpr LONGLONG k_PerformanceFrequency = 1000000000;
+
+    // both clocks are served from the vDSO, so none of these make a system call
+    inline uint64_t monotonicNanoseconds() noexcept {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return uint64_t(ts.tv_sec) * 1000000000u + uint64_t(ts.tv_nsec);
+    }
+
+    inline uint64_t coarseMilliseconds() noexcept {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+        return uint64_t(ts.tv_sec) * 1000u + uint64_t(ts.tv_nsec) / 1000000u;
+    }
+
     inline std::string toUnixPath(std::string_view winpath) {
         if(winpath.size() >= 2 && winpath[1] == ':')
             winpath = winpath.substr(2);
@@ -135,6 +153,14 @@ WIN32_API DWORD kernel32_GetPrivateProfileStringA(LPCSTR lpAppName, LPCSTR lpKey
     return numCharsToCopy;
 }
 
+WIN32_API DWORD kernel32_GetTickCount(void) {
+    return DWORD(coarseMilliseconds());
+}
+
+WIN32_API ULONGLONG kernel32_GetTickCount64(void) {
+    return coarseMilliseconds();
+}
+
 WIN32_API int kernel32_MultiByteToWideChar(UINT CodePage, DWORD dwFlags, LPCCH lpMultiByteStr, int cbMultiByte,
                                            LPWSTR lpWideCharStr, int cchWideChar) {
     unicode::UTF16Converter conv{CodePage};
@@ -173,6 +199,22 @@ WIN32_API int kernel32_MultiByteToWideChar(UINT CodePage, DWORD dwFlags, LPCCH l
     return utf16String.length() + extraNullCharacter;
 }
 
+WIN32_API BOOL kernel32_QueryPerformanceCounter(LARGE_INTEGER* lpPerformanceCount) {
+    if(!lpPerformanceCount)
+        return FALSE;
+
+    lpPerformanceCount->QuadPart = LONGLONG(monotonicNanoseconds());
+    return TRUE;
+}
+
+WIN32_API BOOL kernel32_QueryPerformanceFrequency(LARGE_INTEGER* lpFrequency) {
+    if(!lpFrequency)
+        return FALSE;
+
+    lpFrequency->QuadPart = k_PerformanceFrequency;
+    return TRUE;
+}
+
 WIN32_API void kernel32_RtlZeroMemory(PVOID pDestination, SIZE_T nSize) {
     SPDLOG_TRACE("kernel32::RtlZeroMemory(pDestination={}, nSize={})", pDestination, nSize);
 
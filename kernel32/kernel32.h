@@ -69,6 +69,10 @@ WIN32_API DWORD kernel32_GetPrivateProfileStringA(
     LPCSTR lpFileName
 );
 
+WIN32_API DWORD kernel32_GetTickCount(void);
+
+WIN32_API ULONGLONG kernel32_GetTickCount64(void);
+
 WIN32_API int kernel32_MultiByteToWideChar(
     UINT CodePage,
     DWORD dwFlags,
@@ -78,6 +82,14 @@ WIN32_API int kernel32_MultiByteToWideChar(
     int cchWideChar
 );
 
+WIN32_API BOOL kernel32_QueryPerformanceCounter(
+    LARGE_INTEGER* lpPerformanceCount
+);
+
+WIN32_API BOOL kernel32_QueryPerformanceFrequency(
+    LARGE_INTEGER* lpFrequency
+);
+
 WIN32_API void kernel32_RtlZeroMemory(
     PVOID pDestination,
     SIZE_T nSize
@@ -3,43 +3,18 @@
 #include <cassert>
 
 #include <algorithm>
-#include <vector>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string_view>
+#include <type_traits>
 
 #include "log.h"
 #include "wintypes.h"
 
 
-//#include <map>
-//
-//namespace {
-//    std::map<void*, HANDLE> s_PtrToHANDLE = {{nullptr, 0}};
-//    std::map<HANDLE, void*> s_HANDLEToPtr = {{0, nullptr}};
-//}
-//
-//template <>
-//HANDLE newHANDLE(void* ptr) {
-//    auto it = s_PtrToHANDLE.find(ptr);
-//
-//    if(it == s_PtrToHANDLE.end()) {
-//        auto handle = s_PtrToHANDLE.crbegin()->second + 1;
-//        s_PtrToHANDLE[ptr] = handle;
-//        s_HANDLEToPtr[handle] = ptr;
-//
-//        return handle;
-//    }
-//
-//    return it->second;
-//}
-//
-//template <>
-//void* fromHANDLE(HANDLE handle) {
-//    return s_HANDLEToPtr.at(handle);
-//}
-
 namespace {
-    std::vector<void*> s_HandledPtrs = {nullptr};
-
-
     __attribute__((constructor)) void setupLogger() {
 #if SPDLOG_ACTIVE_LEVEL == SPDLOG_LEVEL_TRACE
         spdlog::set_level(spdlog::level::trace);
@@ -52,28 +27,320 @@ namespace {
     }
 }
 
-template <>
-HANDLE newHANDLE<HANDLE>(void* ptr) {
-    auto it = std::find(s_HandledPtrs.begin(), s_HandledPtrs.end(), ptr);
+// Every export Win32API.new can ask for, as (dll, function).
+#define WIN32API_EXPORTS(X)                     \
+    X(advapi32, GetUserName)                    \
+    X(advapi32, GetUserNameA)                   \
+    X(camouse, DisposeHook)                     \
+    X(camouse, GetWheelDelta)                   \
+    X(camouse, GetWindowHandle)                 \
+    X(camouse, RegenerationHook)                \
+    X(gdi32, BitBlt)                            \
+    X(gdi32, CreateCompatibleBitmap)            \
+    X(gdi32, CreateCompatibleDC)                \
+    X(gdi32, CreateFontA)                       \
+    X(gdi32, CreateFontIndirectA)               \
+    X(gdi32, CreateSolidBrush)                  \
+    X(gdi32, DeleteDC)                          \
+    X(gdi32, DeleteObject)                      \
+    X(gdi32, GetDIBits)                         \
+    X(gdi32, GetPixelBufferStats)               \
+    X(gdi32, GetTextExtentPoint32A)             \
+    X(gdi32, SelectObject)                      \
+    X(gdi32, SetBkColor)                        \
+    X(gdi32, SetBkMode)                         \
+    X(gdi32, SetStretchBltMode)                 \
+    X(gdi32, SetTextColor)                      \
+    X(gdi32, StretchBlt)                        \
+    X(gdi32, TextOutA)                          \
+    X(gdiplus, GdipCreateBitmapFromGdiDib)      \
+    X(gdiplus, GdipCreateBitmapFromHBITMAP)     \
+    X(gdiplus, GdipCreateBitmapFromScan0)       \
+    X(gdiplus, GdipDisposeImage)                \
+    X(gdiplus, GdipSaveImageToFile)             \
+    X(gdiplus, GdiplusShutdown)                 \
+    X(gdiplus, GdiplusStartup)                  \
+    X(gdiplus, SetEncoderWorkers)               \
+    X(kernel32, GetLastError)                   \
+    X(kernel32, GetPrivateProfileInt)           \
+    X(kernel32, GetPrivateProfileIntA)          \
+    X(kernel32, GetPrivateProfileSection)       \
+    X(kernel32, GetPrivateProfileSectionA)      \
+    X(kernel32, GetPrivateProfileSectionNames)  \
+    X(kernel32, GetPrivateProfileSectionNamesA) \
+    X(kernel32, GetPrivateProfileString)        \
+    X(kernel32, GetPrivateProfileStringA)       \
+    X(kernel32, GetTickCount)                   \
+    X(kernel32, GetTickCount64)                 \
+    X(kernel32, MultiByteToWideChar)            \
+    X(kernel32, QueryPerformanceCounter)        \
+    X(kernel32, QueryPerformanceFrequency)      \
+    X(kernel32, RtlZeroMemory)                  \
+    X(kernel32, SetLastError)                   \
+    X(kernel32, WideCharToMultiByte)            \
+    X(kernel32, WritePrivateProfileSection)     \
+    X(kernel32, WritePrivateProfileSectionA)    \
+    X(kernel32, WritePrivateProfileString)      \
+    X(kernel32, WritePrivateProfileStringA)     \
+    X(rpcrt4, UuidFromString)                   \
+    X(tktk_bitmap, Blur)                        \
+    X(tktk_bitmap, ChangeHue)                   \
+    X(tktk_bitmap, ChangeTone)                  \
+    X(tktk_bitmap, InvertColor)                 \
+    X(tktk_bitmap, Mosaic)                      \
+    X(tktk_bitmap, PngSaveA)                    \
+    X(user32, ClientToScreen)                   \
+    X(user32, CreateWindowEx)                   \
+    X(user32, CreateWindowExA)                  \
+    X(user32, DestroyWindow)                    \
+    X(user32, DispatchMessage)                  \
+    X(user32, DispatchMessageA)                 \
+    X(user32, DrawText)                         \
+    X(user32, DrawTextA)                        \
+    X(user32, FillRect)                         \
+    X(user32, FindWindow)                       \
+    X(user32, FindWindowA)                      \
+    X(user32, FindWindowEx)                     \
+    X(user32, FindWindowExA)                    \
+    X(user32, GetAsyncKeyState)                 \
+    X(user32, GetAsyncKeyStateMask)             \
+    X(user32, GetClientRect)                    \
+    X(user32, GetCursorPos)                     \
+    X(user32, GetDC)                            \
+    X(user32, GetDesktopWindow)                 \
+    X(user32, GetKeyState)                      \
+    X(user32, GetKeyboardState)                 \
+    X(user32, GetMessage)                       \
+    X(user32, GetMessageA)                      \
+    X(user32, GetSystemMetrics)                 \
+    X(user32, GetWindowLong)                    \
+    X(user32, GetWindowLongA)                   \
+    X(user32, GetWindowRect)                    \
+    X(user32, KillTimer)                        \
+    X(user32, MessageBox)                       \
+    X(user32, MessageBoxA)                      \
+    X(user32, MoveWindow)                       \
+    X(user32, PeekMessage)                      \
+    X(user32, PeekMessageA)                     \
+    X(user32, PostMessage)                      \
+    X(user32, PostMessageA)                     \
+    X(user32, PostQuitMessage)                  \
+    X(user32, ReleaseDC)                        \
+    X(user32, ReplyMessage)                     \
+    X(user32, ScreenToClient)                   \
+    X(user32, SendInput)                        \
+    X(user32, SendMessage)                      \
+    X(user32, SendMessageA)                     \
+    X(user32, SetCursorPos)                     \
+    X(user32, SetTimer)                         \
+    X(user32, SetWindowLong)                    \
+    X(user32, SetWindowLongA)                   \
+    X(user32, SetWindowLongPtr)                 \
+    X(user32, SetWindowLongPtrA)                \
+    X(user32, SetWindowPos)                     \
+    X(user32, ShowCursor)                       \
+    X(user32, ShowWindow)                       \
+    X(user32, SystemParametersInfo)             \
+    X(user32, SystemParametersInfoA)            \
+    X(user32, TranslateMessage)                 \
+    X(user32, UpdateWindow)                     \
+    X(wfcrypt, create_context)                  \
+    X(wfcrypt, decrypt)                         \
+    X(wfcrypt, decrypt_begin)                   \
+    X(wfcrypt, decrypt_with)                    \
+    X(wfcrypt, destroy_context)                 \
+    X(wfcrypt, destroy_stream)                  \
+    X(wfcrypt, encrypt)                         \
+    X(wfcrypt, encrypt_begin)                   \
+    X(wfcrypt, encrypt_with)                    \
+    X(wfcrypt, stream_final)                    \
+    X(wfcrypt, stream_update)                   \
+    X(winmm, timeBeginPeriod)                   \
+    X(winmm, timeEndPeriod)                     \
+    X(winmm, timeGetTime)                       \
 
-    if(it == s_HandledPtrs.end()) {
-        s_HandledPtrs.push_back(ptr);
-        return s_HandledPtrs.size()-1;
+namespace {
+    // Win32API's letter for a parameter or return type.
+    template <typename T>
+    constexpr char typeCode() {
+        if constexpr(std::is_void_v<T>)
+            return 'v';
+        else if constexpr(std::is_pointer_v<T>)
+            return 'p';
+        else if constexpr(std::is_integral_v<T> || std::is_enum_v<T>) {
+            static_assert(!std::is_same_v<T, bool> && sizeof(T) >= sizeof(int16_t), "widen this export's type");
+            return (sizeof(T) == sizeof(int16_t) ? 's' : sizeof(T) == sizeof(int32_t) ? 'i' : 'l');
+        } else {
+            static_assert(std::is_void_v<T>, "this export's type has no Win32API equivalent");
+            return '\0';
+        }
     }
 
-    return std::distance(s_HandledPtrs.begin(), it);
-}
+    template <typename F>
+    struct Signature;
+
+    template <typename R, typename... Args>
+    struct Signature<R (*)(Args...)> {
+        static constexpr char value[] = {typeCode<Args>()..., ':', typeCode<R>(), '\0'};
+    };
+
+    template <typename R, typename... Args>
+    struct Signature<R (*)(Args...) noexcept> : Signature<R (*)(Args...)> {};
+
+    constexpr uint32_t hashName(std::string_view name) {
+        uint32_t h = 2166136261u;
+        for(char c : name)
+            h = (h ^ uint8_t(c)) * 16777619u;
+        return h;
+    }
+
+    constexpr uint32_t mixHash(uint32_t h, uint32_t seed) {
+        h ^= seed * 0x9E3779B9u;
+        h ^= h >> 16;
+        h *= 0x85EBCA6Bu;
+        h ^= h >> 13;
+        h *= 0xC2B2AE35u;
+        return h ^ (h >> 16);
+    }
+
+    constexpr size_t ceilPow2(size_t n) {
+        size_t p = 1;
+        while(p < n)
+            p <<= 1;
+        return p;
+    }
+
+    /*
+     * Hash and displace: a name first picks a bucket, and the bucket's seed then picks its slot. Seeds are searched
+     * for at compile time, biggest buckets first, so that every name gets a slot of its own.
+     */
+    template <size_t N>
+    class PerfectHash {
+     public:
+        static constexpr size_t k_Buckets = ceilPow2((N + 3) / 4);
+        static constexpr size_t k_Slots = ceilPow2(2 * N);
+        static constexpr size_t npos = N;
+
+        constexpr explicit PerfectHash(const std::string_view (&names)[N]) {
+            uint32_t hashes[N]{};
+            size_t sizes[k_Buckets]{};
+            for(size_t ii = 0; ii < N; ++ii) {
+                hashes[ii] = hashName(names[ii]);
+                ++sizes[hashes[ii] & (k_Buckets - 1)];
+            }
+
+            while(true) {
+                size_t bucket = 0;
+                for(size_t bb = 1; bb < k_Buckets; ++bb) {
+                    if(sizes[bb] > sizes[bucket])
+                        bucket = bb;
+                }
+                if(sizes[bucket] == 0)
+                    break;
+
+                for(uint32_t seed = 1;; ++seed) {
+                    size_t slots[N]{}, count = 0;
+                    bool fits = true;
+                    for(size_t ii = 0; fits && ii < N; ++ii) {
+                        if((hashes[ii] & (k_Buckets - 1)) != bucket)
+                            continue;
+
+                        const size_t slot = mixHash(hashes[ii], seed) & (k_Slots - 1);
+                        fits = (m_Slots[slot] == 0);
+                        for(size_t jj = 0; fits && jj < count; ++jj)
+                            fits = (slots[jj] != slot);
+                        slots[count++] = slot;
+                    }
+                    if(!fits)
+                        continue;
 
-template <>
-void* fromHANDLE<HANDLE>(HANDLE handle) {
-    return s_HandledPtrs[handle];
+                    for(size_t ii = 0, jj = 0; ii < N; ++ii) {
+                        if((hashes[ii] & (k_Buckets - 1)) == bucket)
+                            m_Slots[slots[jj++]] = uint16_t(ii + 1);
+                    }
+                    m_Seeds[bucket] = seed;
+                    sizes[bucket] = 0;
+                    break;
+                }
+            }
+        }
+
+        // the only candidate for name; the caller still has to compare the names
+        [[nodiscard]] constexpr size_t find(std::string_view name) const {
+            const uint32_t h = hashName(name);
+            const size_t slot = mixHash(h, m_Seeds[h & (k_Buckets - 1)]) & (k_Slots - 1);
+            return (m_Slots[slot] == 0 ? npos : m_Slots[slot] - 1);
+        }
+
+     private:
+        uint32_t m_Seeds[k_Buckets]{};
+        uint16_t m_Slots[k_Slots]{};    // index + 1, 0 when empty
+    };
+
+    struct Export {
+        const char* signature;
+        const void* function;
+    };
+
+#define WIN32API_NAME(dll, fn) #dll "_" #fn,
+    constexpr std::string_view k_ExportNames[] = {WIN32API_EXPORTS(WIN32API_NAME)};
+#undef WIN32API_NAME
+
+#define WIN32API_EXPORT(dll, fn) {Signature<decltype(&dll##_##fn)>::value, reinterpret_cast<const void*>(&dll##_##fn)},
+    const Export s_Exports[] = {WIN32API_EXPORTS(WIN32API_EXPORT)};
+#undef WIN32API_EXPORT
+
+    constexpr size_t k_ExportCount = std::size(k_ExportNames);
+    constexpr PerfectHash<k_ExportCount> k_ExportHash{k_ExportNames};
+
+    constexpr bool hashesAll() {
+        for(size_t ii = 0; ii < k_ExportCount; ++ii) {
+            if(k_ExportHash.find(k_ExportNames[ii]) != ii)
+                return false;
+        }
+        return true;
+    }
+    static_assert(hashesAll(), "export names must be unique");
+
+    const Export* findExport(std::string_view name) {
+        const size_t index = k_ExportHash.find(name);
+        return (index != k_ExportHash.npos && k_ExportNames[index] == name ? &s_Exports[index] : nullptr);
+    }
 }
 
-template <>
-HANDLE toHANDLE<HANDLE>(void* ptr) {
-  auto it = std::find(s_HandledPtrs.begin(), s_HandledPtrs.end(), ptr);
-  if(it != s_HandledPtrs.end())
-    return std::distance(s_HandledPtrs.begin(), it);
-  else
-    return 0;
+WIN32_API const void* win32api_resolve(const char* dll, const char* fn, const char** signature) {
+    if(!dll || !fn)
+        return nullptr;
+
+    std::string_view dllName{dll};
+    if(auto sep = dllName.find_last_of("/\\"); sep != std::string_view::npos)
+        dllName.remove_prefix(sep + 1);
+
+    // room for the longest name, its '_' and an 'A'
+    char name[64];
+    const size_t fnLength = std::strlen(fn);
+    if(dllName.size() + 1 + fnLength + 1 > sizeof(name))
+        return nullptr;
+
+    std::transform(dllName.begin(), dllName.end(), name, [](char c) { return char(std::tolower(uint8_t(c))); });
+    if(dllName.size() > 4 && std::string_view{name + dllName.size() - 4, 4} == ".dll")
+        dllName.remove_suffix(4);
+    name[dllName.size()] = '_';
+    std::memcpy(name + dllName.size() + 1, fn, fnLength);
+
+    std::string_view key{name, dllName.size() + 1 + fnLength};
+    const Export* found = findExport(key);
+    if(!found) {
+        name[key.size()] = 'A';
+        found = findExport({name, key.size() + 1});
+    }
+
+    if(!found) {
+        spdlog::warn("win32api_resolve: no export for {} in {}", fn, dll);
+        return nullptr;
+    }
+
+    if(signature)
+        *signature = found->signature;
+    return found->function;
 }
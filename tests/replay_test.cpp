@@ -0,0 +1,122 @@
+/*
+ * Round trip of the input record/replay log. The test runs twice: once with WIN32API_INPUT_RECORD set, recording a
+ * synthetic session, and once with WIN32API_INPUT_REPLAY pointing at that log, checking that every query is served
+ * with what was recorded.
+ */
+#include <cstdio>
+#include <cstring>
+
+#include "replay.h"
+
+namespace {
+  int s_Failures = 0;
+
+  void check(bool ok, const char* what, int frame) {
+    if(!ok) {
+      std::fprintf(stderr, "frame %d: %s\n", frame, what);
+      ++s_Failures;
+    }
+  }
+
+  SHORT keyState(int frame, WORD vk) {
+    return SHORT((frame + vk) % 3 == 0 ? 0x8001 : (frame + vk) % 3);
+  }
+
+  void keyboardState(int frame, uint8_t (&states)[256]) {
+    for(int ii = 0; ii < 256; ++ii)
+      states[ii] = uint8_t((ii * 7 + frame) % 5 == 0 ? 0x81 : 0);
+  }
+
+  POINT cursorPos(int frame) {
+    // negative and multi-byte coordinates exercise the zigzag encoding
+    return POINT{LONG(frame * 37 - 500), LONG(-frame * 1000)};
+  }
+
+  constexpr int k_Frames = 50;
+  constexpr WORD k_Keys[] = {0x01, 0x0D, 0x20, 0x41, 0xFF};
+
+  int recordSession() {
+    if(!replay::isRecording()) {
+      std::fprintf(stderr, "WIN32API_INPUT_RECORD is not set\n");
+      return 1;
+    }
+
+    for(int frame = 0; frame < k_Frames; ++frame) {
+      for(WORD vk : k_Keys) {
+        replay::recordKeyState(vk, keyState(frame, vk));
+        replay::recordAsyncKeyState(vk, SHORT(keyState(frame, vk) & 0x8000));
+      }
+
+      // some frames make no keyboard or cursor queries at all
+      if(frame % 4 != 3) {
+        uint8_t states[256];
+        keyboardState(frame, states);
+        replay::recordKeyboardState(states);
+
+        const uint64_t query[4] = {0xFFu, uint64_t(frame), 0, ~uint64_t(0)};
+        const uint64_t active[4] = {uint64_t(frame) & 0xFFu, uint64_t(frame), 0, uint64_t(frame) << 32};
+        replay::recordKeyStateMask(query, active);
+
+        replay::recordCursorPos(cursorPos(frame));
+      }
+
+      replay::recordSendInput(UINT(frame % 3));
+      replay::advanceFrame();
+    }
+
+    return 0;
+  }
+
+  int replaySession() {
+    if(!replay::isReplaying()) {
+      std::fprintf(stderr, "WIN32API_INPUT_REPLAY is not set or the log is invalid\n");
+      return 1;
+    }
+
+    for(int frame = 0; frame < k_Frames; ++frame) {
+      for(WORD vk : k_Keys) {
+        check(replay::replayKeyState(vk) == keyState(frame, vk), "GetKeyState", frame);
+        check(replay::replayAsyncKeyState(vk) == SHORT(keyState(frame, vk) & 0x8000), "GetAsyncKeyState", frame);
+      }
+
+      if(frame % 4 != 3) {
+        uint8_t expected[256], states[256];
+        keyboardState(frame, expected);
+        replay::replayKeyboardState(states);
+        check(std::memcmp(states, expected, sizeof(states)) == 0, "GetKeyboardState", frame);
+
+        const uint64_t query[4] = {0xFFu, uint64_t(frame), 0, ~uint64_t(0)};
+        uint64_t active[4];
+        replay::replayKeyStateMask(query, active);
+        check(active[0] == (uint64_t(frame) & 0xFFu) && active[1] == uint64_t(frame) && active[2] == 0 &&
+                  active[3] == uint64_t(frame) << 32,
+              "GetAsyncKeyStateMask", frame);
+
+        const POINT pt = replay::replayCursorPos(), expectedPt = cursorPos(frame);
+        check(pt.x == expectedPt.x && pt.y == expectedPt.y, "GetCursorPos", frame);
+      } else if(frame == 3) {
+        // a query the recording never made falls back to a neutral value
+        const POINT pt = replay::replayCursorPos();
+        check(pt.x == 0 && pt.y == 0, "diverged GetCursorPos", frame);
+      }
+
+      check(replay::replaySendInput() == UINT(frame % 3), "SendInput", frame);
+      replay::advanceFrame();
+    }
+
+    // and so does anything past the end of the log
+    check(replay::replayKeyState(k_Keys[0]) == 0, "GetKeyState past the end", k_Frames);
+
+    return (s_Failures == 0 ? 0 : 1);
+  }
+}    // namespace
+
+int main(int argc, char** argv) {
+  if(argc == 2 && std::strcmp(argv[1], "record") == 0)
+    return recordSession();
+  if(argc == 2 && std::strcmp(argv[1], "replay") == 0)
+    return replaySession();
+
+  std::fprintf(stderr, "usage: %s record|replay\n", argv[0]);
+  return 2;
+}
@@ -0,0 +1,254 @@
+/*
+ * Known-answer tests of the Rijndael cipher behind wfcrypt, for every implementation available on this CPU, plus a
+ * cross check of all implementations against the reference one for every block and key size.
+ */
+#include <cstdio>
+#include <cstring>
+
+#include <algorithm>
+#include <initializer_list>
+
+#include "rijndael.hpp"
+#include "rijndael_aesni.hpp"
+
+using rijndael::Context;
+using rijndael::Implementation;
+
+namespace {
+  struct KnownAnswer {
+    const char* source;
+    uint32_t nb, nk;
+    const char* key;
+    const char* iv;    // null for ECB
+    const char* plainText;
+    const char* cipherText;
+  };
+
+  constexpr const char* k_Counting = "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f";
+
+  constexpr const char* k_Sp800_38a_PlainText =
+      "6bc1bee22e409f96e93d7e117393172aae2d8a571e03ac9c9eb76fac45af8e51"
+      "30c81c46a35ce411e5fbc1191a0a52eff69f2445df4f9b17ad2b417be66c3710";
+
+  // published vectors of the AES subset of Rijndael: 16 byte blocks with 128 and 192 bit keys
+  constexpr KnownAnswer k_Published[] = {
+      {"FIPS-197 appendix B", 4, 4, "2b7e151628aed2a6abf7158809cf4f3c", nullptr, "3243f6a8885a308d313198a2e0370734",
+       "3925841d02dc09fbdc118597196a0b32"},
+      {"FIPS-197 appendix C.1", 4, 4, k_Counting, nullptr, "00112233445566778899aabbccddeeff",
+       "69c4e0d86a7b0430d8cdb78070b4c55a"},
+      {"FIPS-197 appendix C.2", 4, 6, k_Counting, nullptr, "00112233445566778899aabbccddeeff",
+       "dda97ca4864cdfe06eaf70a0ec0d7191"},
+      {"SP 800-38A F.1.1 (ECB-AES128)", 4, 4, "2b7e151628aed2a6abf7158809cf4f3c", nullptr, k_Sp800_38a_PlainText,
+       "3ad77bb40d7a3660a89ecaf32466ef97f5d3d58503b9699de785895a96fdbaaf"
+       "43b1cd7f598ece23881b00e3ed0306887b0c785e27e8ad3f8223207104725dd4"},
+      {"SP 800-38A F.1.3 (ECB-AES192)", 4, 6, "8e73b0f7da0e6452c810f32b809079e562f8ead2522c6b7b", nullptr,
+       k_Sp800_38a_PlainText,
+       "bd334f1d6e45f25ff712a214571fa5cc974104846d0ad3ad7734ecb3ecee4eef"
+       "ef7afd2270e2e60adce0ba2face6444e9a4b41ba738d6c72fb16691603c18e0e"},
+      {"SP 800-38A F.2.1 (CBC-AES128)", 4, 4, "2b7e151628aed2a6abf7158809cf4f3c", "000102030405060708090a0b0c0d0e0f",
+       k_Sp800_38a_PlainText,
+       "7649abac8119b246cee98e9b12e9197d5086cb9b507219ee95db113a917678b2"
+       "73bed6b8e3c1743b7116e69e222295163ff1caa1681fac09120eca307586e1a7"},
+  };
+
+  /*
+   * There are no published vectors for the rest: the 256 bit key schedule of the original library substitutes every
+   * odd word instead of every fourth one, which makes it a cipher of its own, and the wide block sizes are pinned to
+   * the output of the reference implementation (which follows the specification step by step) so that regressions in
+   * any implementation show up.
+   */
+  constexpr KnownAnswer k_Pinned[] = {
+      {"pinned, 256 bit key schedule", 4, 8, k_Counting, nullptr, "00112233445566778899aabbccddeeff",
+       "8c30ae2da0540a9baf9c449ae2b88ca5"},
+      {"pinned", 6, 4, k_Counting, nullptr, k_Counting, "54030626e366bba5827f46be060b53c75668fc25fb1a6074"},
+      {"pinned", 6, 6, k_Counting, nullptr, k_Counting, "7a5a73c8fbdbb2aa6866cc951b3e059a631cfefc09c424cf"},
+      {"pinned, 256 bit key schedule", 6, 8, k_Counting, nullptr, k_Counting,
+       "34d2d6acb59cf53ddf1343d02a03b7c0033a6978c998d6e1"},
+      {"pinned", 8, 4, k_Counting, nullptr, k_Counting,
+       "21c89c4a7ae37f185597362e5d20485f6144afed71bd4a798688662e6cde7dc4"},
+      {"pinned", 8, 6, k_Counting, nullptr, k_Counting,
+       "d4cc0b070ebebd98ffa1c28e40bffa5db8bdb8fb5bfb6ccf23af2c1608967acc"},
+      {"pinned, 256 bit key schedule", 8, 8, k_Counting, nullptr, k_Counting,
+       "2baad83f47a41791377fc5f218dfe441a9dc55cdfb46ee86c00a8b73f9ce9fd8"},
+  };
+
+  constexpr Implementation k_Implementations[] = {Implementation::eReference, Implementation::eTable,
+                                                  Implementation::eAesNi, Implementation::eBitsliced};
+
+  // enough blocks to go through the widest bulk path and a partial batch of more than four
+  constexpr uint32_t k_CrossCheckBlocks = 13;
+
+  int s_Failures = 0;
+
+  const char* name_of(Implementation impl) {
+    switch(impl) {
+      case Implementation::eReference:
+        return "reference";
+      case Implementation::eTable:
+        return "T-table";
+      case Implementation::eAesNi:
+        return "AES-NI";
+      case Implementation::eBitsliced:
+        return "bitsliced";
+    }
+    return "?";
+  }
+
+  void check(bool ok, const char* what, const char* source, Implementation impl, uint32_t nb, uint32_t nk) {
+    if(!ok) {
+      std::fprintf(stderr, "%s (%s, %s, Nb=%u, Nk=%u) failed\n", what, source, name_of(impl), nb, nk);
+      ++s_Failures;
+    }
+  }
+
+  bool is_available(Implementation impl, uint32_t nb) noexcept {
+    switch(impl) {
+      case Implementation::eAesNi:
+        return (nb == 4 && rijndael::aesni::supported());
+      case Implementation::eBitsliced:
+        return (nb == 4);
+      default:
+        return true;
+    }
+  }
+
+  size_t from_hex(const char* hex, uint8_t* out) noexcept {
+    constexpr auto fn_nibble = [](char c) noexcept -> uint8_t {
+      return (c <= '9' ? c - '0' : c - 'a' + 10);
+    };
+
+    const size_t size = std::strlen(hex) / 2;
+    for(size_t ii = 0; ii < size; ++ii)
+      out[ii] = (fn_nibble(hex[2 * ii]) << 4) | fn_nibble(hex[2 * ii + 1]);
+    return size;
+  }
+
+  void check_known_answer(const KnownAnswer& ka, Implementation impl) {
+    const uint32_t bs = sizeof(uint32_t) * ka.nb;
+
+    uint8_t key[32], iv[32] = {}, plain[128], cipher[128];
+    from_hex(ka.key, key);
+    if(ka.iv)
+      from_hex(ka.iv, iv);
+    from_hex(ka.plainText, plain);
+    // the plain text may be longer than the cipher text, the counting sequence is used for every block size
+    const size_t size = from_hex(ka.cipherText, cipher);
+
+    const Context ctx{ka.nb, buffer::byte_buffer_view{key, sizeof(uint32_t) * ka.nk}, impl};
+
+    // block by block, chaining if there is an IV
+    uint8_t buf[128];
+    std::memcpy(buf, plain, size);
+    for(size_t off = 0; off < size; off += bs) {
+      const uint8_t* chain = (off == 0 || !ka.iv ? iv : buf + off - bs);
+      for(uint32_t ii = 0; ii < bs; ++ii)
+        buf[off + ii] ^= chain[ii];
+      ctx.encrypt(buffer::byte_buffer_span{buf + off, bs});
+    }
+    check(std::memcmp(buf, cipher, size) == 0, "encrypt", ka.source, impl, ka.nb, ka.nk);
+
+    // CBC decryption is one bulk decryption followed by the XOR with the previous cipher text block
+    std::memcpy(buf, cipher, size);
+    ctx.decrypt_blocks(buffer::byte_buffer_span{buf, size});
+    for(size_t off = 0; off < size; off += bs) {
+      const uint8_t* chain = (off == 0 || !ka.iv ? iv : cipher + off - bs);
+      for(uint32_t ii = 0; ii < bs; ++ii)
+        buf[off + ii] ^= chain[ii];
+    }
+    check(std::memcmp(buf, plain, size) == 0, "decrypt_blocks", ka.source, impl, ka.nb, ka.nk);
+
+    std::memcpy(buf, cipher, bs);
+    ctx.decrypt(buffer::byte_buffer_span{buf, bs});
+    for(uint32_t ii = 0; ii < bs; ++ii)
+      buf[ii] ^= iv[ii];
+    check(std::memcmp(buf, plain, bs) == 0, "decrypt", ka.source, impl, ka.nb, ka.nk);
+  }
+
+  // every implementation must agree with the reference one on a pseudo-random key and text
+  void cross_check(uint32_t nb, uint32_t nk) {
+    const uint32_t bs = sizeof(uint32_t) * nb;
+    const uint32_t textSize = bs * k_CrossCheckBlocks;
+
+    uint32_t state = 0x9e3779b9 ^ (nb << 8) ^ nk;
+    auto fn_next = [&state]() noexcept -> uint8_t {
+      state ^= state << 13;
+      state ^= state >> 17;
+      state ^= state << 5;
+      return uint8_t(state);
+    };
+
+    uint8_t key[32], text[32 * k_CrossCheckBlocks];
+    std::generate(key, key + sizeof(key), fn_next);
+    std::generate(text, text + sizeof(text), fn_next);
+
+    uint8_t expectedCipher[32 * k_CrossCheckBlocks], expectedPlain[32 * k_CrossCheckBlocks];
+    {
+      const Context ref{nb, buffer::byte_buffer_view{key, sizeof(uint32_t) * nk}, Implementation::eReference};
+
+      std::memcpy(expectedCipher, text, textSize);
+      for(uint32_t ii = 0; ii < k_CrossCheckBlocks; ++ii)
+        ref.encrypt(buffer::byte_buffer_span{expectedCipher + bs * ii, bs});
+
+      std::memcpy(expectedPlain, text, textSize);
+      for(uint32_t ii = 0; ii < k_CrossCheckBlocks; ++ii)
+        ref.decrypt(buffer::byte_buffer_span{expectedPlain + bs * ii, bs});
+    }
+
+    for(Implementation impl : k_Implementations) {
+      if(impl == Implementation::eReference || !is_available(impl, nb))
+        continue;
+
+      const Context ctx{nb, buffer::byte_buffer_view{key, sizeof(uint32_t) * nk}, impl};
+
+      uint8_t buf[32 * k_CrossCheckBlocks];
+      std::memcpy(buf, text, textSize);
+      for(uint32_t ii = 0; ii < k_CrossCheckBlocks; ++ii)
+        ctx.encrypt(buffer::byte_buffer_span{buf + bs * ii, bs});
+      check(std::memcmp(buf, expectedCipher, textSize) == 0, "encrypt", "cross check", impl, nb, nk);
+
+      std::memcpy(buf, text, textSize);
+      ctx.encrypt_blocks(buffer::byte_buffer_span{buf, textSize});
+      check(std::memcmp(buf, expectedCipher, textSize) == 0, "encrypt_blocks", "cross check", impl, nb, nk);
+
+      std::memcpy(buf, text, textSize);
+      ctx.decrypt_blocks(buffer::byte_buffer_span{buf, textSize});
+      check(std::memcmp(buf, expectedPlain, textSize) == 0, "decrypt_blocks", "cross check", impl, nb, nk);
+    }
+
+    // the default context mixes implementations: one for single blocks, another one for runs of blocks
+    const Context ctx{nb, buffer::byte_buffer_view{key, sizeof(uint32_t) * nk}};
+
+    uint8_t buf[32 * k_CrossCheckBlocks];
+    std::memcpy(buf, text, textSize);
+    ctx.encrypt_blocks(buffer::byte_buffer_span{buf, textSize});
+    check(std::memcmp(buf, expectedCipher, textSize) == 0, "encrypt_blocks", "default context",
+          ctx.bulkImplementation(), nb, nk);
+
+    for(uint32_t ii = 0; ii < k_CrossCheckBlocks; ++ii)
+      ctx.decrypt(buffer::byte_buffer_span{buf + bs * ii, bs});
+    check(std::memcmp(buf, text, textSize) == 0, "decrypt", "default context", ctx.implementation(), nb, nk);
+  }
+}    // namespace
+
+int main() {
+  for(Implementation impl : k_Implementations) {
+    for(const KnownAnswer& ka : k_Published) {
+      if(is_available(impl, ka.nb))
+        check_known_answer(ka, impl);
+    }
+    for(const KnownAnswer& ka : k_Pinned) {
+      if(is_available(impl, ka.nb))
+        check_known_answer(ka, impl);
+    }
+  }
+
+  for(uint32_t nb : {4, 6, 8}) {
+    for(uint32_t nk : {4, 6, 8})
+      cross_check(nb, nk);
+  }
+
+  if(!rijndael::aesni::supported())
+    std::printf("AES-NI is not available, its implementation was not tested\n");
+
+  return (s_Failures == 0 ? 0 : 1);
+}
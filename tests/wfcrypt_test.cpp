@@ -0,0 +1,408 @@
+/*
+ * Tests of the wfcrypt exports: the incremental CBC API fed in chunks of every awkward size against block by block
+ * encryption of the padded text, the rejection of cipher texts whose padding was corrupted or cut off, the rejection
+ * of stale and foreign handles, the cache of expanded keys behind the contexts, the decryption of large payloads
+ * split over the thread pool, and fresh IVs in a forked child.
+ */
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+
+#include <algorithm>
+#include <initializer_list>
+#include <vector>
+
+#include <kernel32.h>
+
+#include "keycache.hpp"
+#include "rijndael.hpp"
+#include "threadpool.h"
+#include "wfcrypt.h"
+
+using rijndael::Context;
+
+namespace {
+  thread_local DWORD tl_LastError = 0;
+
+  size_t s_LargestSplit = 0;
+}    // namespace
+
+// kernel32.cpp pulls in ICU and the ini parser, so the test keeps the last error itself
+WIN32_API DWORD kernel32_GetLastError(void) {
+  return tl_LastError;
+}
+
+WIN32_API void kernel32_SetLastError(DWORD dwErrCode) {
+  tl_LastError = dwErrCode;
+}
+
+/*
+ * Stands in for the thread pool so that payloads are split the same way on any machine. The ranges run last to first,
+ * so a range that read cipher text another range had already decrypted in place would show up as a mismatch.
+ */
+namespace threads {
+  size_t concurrency() noexcept {
+    return 4;
+  }
+
+  void parallel_for(size_t count, const std::function<void(size_t)>& fn) {
+    s_LargestSplit = std::max(s_LargestSplit, count);
+    for(size_t ii = count; ii > 0; --ii)
+      fn(ii - 1);
+  }
+}    // namespace threads
+
+namespace {
+  constexpr DWORD k_InvalidMemoryRead = 0x24000001;
+  constexpr DWORD k_InvalidHandle = 0x24000020;
+  constexpr DWORD k_BadPadding = 0x24000040;
+
+  int s_Failures = 0;
+
+  void check(bool ok, const char* what, uint32_t nb, uint32_t nk, size_t size) {
+    if(!ok) {
+      std::fprintf(stderr, "%s (Nb=%u, Nk=%u, %zu bytes) failed\n", what, nb, nk, size);
+      ++s_Failures;
+    }
+  }
+
+  std::vector<uint8_t> pattern(size_t size, uint32_t seed) {
+    std::vector<uint8_t> out(size);
+    for(uint8_t& b : out) {
+      seed = seed * 1664525 + 1013904223;
+      b = uint8_t(seed >> 24);
+    }
+    return out;
+  }
+
+  // text with PKCS#7 padding appended, always at least one byte of it
+  std::vector<uint8_t> padded(const std::vector<uint8_t>& text, uint32_t bs) {
+    std::vector<uint8_t> out{text};
+    const uint8_t pad = bs - text.size() % bs;
+    out.insert(out.end(), pad, pad);
+    return out;
+  }
+
+  // CBC one block at a time, the way the specification writes it
+  std::vector<uint8_t> reference_encrypt(const Context& ctx, std::vector<uint8_t> text, const uint8_t* iv) {
+    const uint32_t bs = ctx.blockSize();
+    const uint8_t* prev = iv;
+    for(size_t offset = 0; offset < text.size(); offset += bs) {
+      for(uint32_t ii = 0; ii < bs; ++ii)
+        text[offset + ii] ^= prev[ii];
+      ctx.encrypt(buffer::byte_buffer_span{text.data() + offset, bs});
+      prev = text.data() + offset;
+    }
+    return text;
+  }
+
+  std::vector<uint8_t> reference_decrypt(const Context& ctx, std::vector<uint8_t> text, const uint8_t* iv) {
+    const uint32_t bs = ctx.blockSize();
+    std::vector<uint8_t> prev{iv, iv + bs}, cipher(bs);
+    for(size_t offset = 0; offset < text.size(); offset += bs) {
+      std::copy_n(text.begin() + offset, bs, cipher.begin());
+      ctx.decrypt(buffer::byte_buffer_span{text.data() + offset, bs});
+      for(uint32_t ii = 0; ii < bs; ++ii)
+        text[offset + ii] ^= prev[ii];
+      prev.swap(cipher);
+    }
+    return text;
+  }
+
+  /*
+   * Feeds text to a stream in chunks whose sizes cycle through chunks, then finishes it. Returns the result of
+   * wfcrypt_stream_final, or -1 if an update failed; out receives everything the stream wrote.
+   */
+  int run_stream(HANDLE stream, const std::vector<uint8_t>& text, std::initializer_list<size_t> chunks,
+                 uint32_t bs, std::vector<uint8_t>& out) {
+    out.assign(text.size() + 2 * bs, 0);
+    size_t read = 0, written = 0;
+
+    for(auto it = chunks.begin(); read < text.size(); it = (it + 1 == chunks.end() ? chunks.begin() : it + 1)) {
+      const size_t chunk = std::min(*it, text.size() - read);
+      int res = wfcrypt_stream_update(stream, reinterpret_cast<const char*>(text.data() + read), int(chunk),
+                                      reinterpret_cast<char*>(out.data() + written), int(out.size() - written));
+      if(res < 0) {
+        wfcrypt_destroy_stream(stream);
+        return -1;
+      }
+      read += chunk;
+      written += res;
+    }
+
+    int res = wfcrypt_stream_final(stream, reinterpret_cast<char*>(out.data() + written), int(out.size() - written));
+    out.resize(written + (res > 0 ? res : 0));
+    return res;
+  }
+
+  void check_stream(uint32_t nb, uint32_t nk, size_t size, std::initializer_list<size_t> chunks) {
+    const uint32_t bs = sizeof(uint32_t) * nb;
+    const std::vector<uint8_t> key = pattern(sizeof(uint32_t) * nk, nb * 10 + nk);
+    const std::vector<uint8_t> text = pattern(size, uint32_t(size));
+
+    HANDLE context = wfcrypt_create_context(int(nb), int(nk), reinterpret_cast<const char*>(key.data()));
+    const Context ref{nb, buffer::byte_buffer_view{key.data(), key.size()}};
+
+    uint8_t iv[32];
+    std::vector<uint8_t> cipher;
+    HANDLE stream = wfcrypt_encrypt_begin(context, reinterpret_cast<char*>(iv));
+    int res = run_stream(stream, text, chunks, bs, cipher);
+    check(res == int(bs), "encrypt final writes a block", nb, nk, size);
+    check(cipher.size() == (size / bs + 1) * bs, "encrypt output size", nb, nk, size);
+    check(cipher == reference_encrypt(ref, padded(text, bs), iv), "encrypt matches one block at a time", nb, nk, size);
+
+    std::vector<uint8_t> plain;
+    stream = wfcrypt_decrypt_begin(context, reinterpret_cast<const char*>(iv));
+    res = run_stream(stream, cipher, chunks, bs, plain);
+    check(res == int(size % bs), "decrypt final strips the padding", nb, nk, size);
+    check(plain == text, "decrypt round trip", nb, nk, size);
+
+    // and the one-shot export decrypts what the stream encrypted, padding included
+    std::vector<uint8_t> oneShot{cipher};
+    wfcrypt_decrypt_with(context, reinterpret_cast<char*>(oneShot.data()), reinterpret_cast<const char*>(iv),
+                         int(oneShot.size()));
+    check(oneShot == padded(text, bs), "one-shot decrypt of the stream output", nb, nk, size);
+
+    wfcrypt_destroy_context(context);
+  }
+
+  // decrypts cipher text in a stream and expects wfcrypt_stream_final to fail with the given error
+  void check_rejected(const char* what, HANDLE context, const std::vector<uint8_t>& cipher, const uint8_t* iv,
+                      DWORD expectedError, uint32_t nb, uint32_t nk) {
+    const uint32_t bs = sizeof(uint32_t) * nb;
+
+    std::vector<uint8_t> plain;
+    HANDLE stream = wfcrypt_decrypt_begin(context, reinterpret_cast<const char*>(iv));
+    int res = run_stream(stream, cipher, {5, bs}, bs, plain);
+    check(res == -1 && kernel32_GetLastError() == expectedError, what, nb, nk, cipher.size());
+  }
+
+  void check_bad_padding(uint32_t nb, uint32_t nk) {
+    const uint32_t bs = sizeof(uint32_t) * nb;
+    const std::vector<uint8_t> key = pattern(sizeof(uint32_t) * nk, nb * 10 + nk);
+    const std::vector<uint8_t> iv = pattern(bs, 99);
+
+    HANDLE context = wfcrypt_create_context(int(nb), int(nk), reinterpret_cast<const char*>(key.data()));
+    const Context ref{nb, buffer::byte_buffer_view{key.data(), key.size()}};
+
+    // three blocks of text whose last block is padded by hand, then broken in one way or another
+    std::vector<uint8_t> text = pattern(3 * bs, 7);
+    text[2 * bs - 1] = 0xaa;    // so that cutting off the last block leaves no valid padding either
+    const auto fn_with_tail = [&](std::initializer_list<uint8_t> tail) {
+      std::vector<uint8_t> t{text};
+      std::copy(tail.begin(), tail.end(), t.end() - tail.size());
+      return reference_encrypt(ref, t, iv.data());
+    };
+
+    const uint8_t over = bs + 1;
+    check_rejected("padding of 0", context, fn_with_tail({0}), iv.data(), k_BadPadding, nb, nk);
+    check_rejected("padding longer than a block", context, fn_with_tail({over}), iv.data(), k_BadPadding, nb, nk);
+    check_rejected("padding of 255", context, fn_with_tail({255}), iv.data(), k_BadPadding, nb, nk);
+    check_rejected("first padding byte wrong", context, fn_with_tail({3, 4, 4, 4}), iv.data(), k_BadPadding, nb, nk);
+    check_rejected("middle padding byte wrong", context, fn_with_tail({4, 4, 5, 4}), iv.data(), k_BadPadding, nb,
+                   nk);
+
+    std::vector<uint8_t> full(bs, uint8_t(bs));
+    full[0] ^= 1;
+    std::vector<uint8_t> fullText{text};
+    std::copy(full.begin(), full.end(), fullText.end() - bs);
+    check_rejected("full padding block with a wrong byte", context, reference_encrypt(ref, fullText, iv.data()),
+                   iv.data(), k_BadPadding, nb, nk);
+
+    // a valid cipher text with its end cut off
+    std::vector<uint8_t> cipher = fn_with_tail({4, 4, 4, 4});
+    check_rejected("last block cut off", context, {cipher.begin(), cipher.end() - bs}, iv.data(), k_BadPadding, nb,
+                   nk);
+    check_rejected("last block cut short", context, {cipher.begin(), cipher.end() - 1}, iv.data(),
+                   k_InvalidMemoryRead, nb, nk);
+    check_rejected("empty cipher text", context, {}, iv.data(), k_InvalidMemoryRead, nb, nk);
+
+    // while the intact one decrypts, which shows the cases above fail for the reason they claim
+    std::vector<uint8_t> plain;
+    HANDLE stream = wfcrypt_decrypt_begin(context, reinterpret_cast<const char*>(iv.data()));
+    check(run_stream(stream, cipher, {5, bs}, bs, plain) == int(bs - 4) && plain.size() == 3 * bs - 4,
+          "intact padding", nb, nk, cipher.size());
+
+    wfcrypt_destroy_context(context);
+  }
+
+  // failed is whether a call that was given a bad handle failed
+  void check_invalid(bool failed, const char* what) {
+    check(failed && kernel32_GetLastError() == k_InvalidHandle, what, 4, 4, 0);
+  }
+
+  void check_handles() {
+    const std::vector<uint8_t> key = pattern(16, 1);
+    uint8_t iv[16], text[32] = {}, out[64];
+    const auto fn_key = reinterpret_cast<const char*>(key.data());
+    const auto fn_text = reinterpret_cast<char*>(text);
+    const auto fn_out = reinterpret_cast<char*>(out);
+
+    // a context that was destroyed, then destroyed again
+    HANDLE stale = wfcrypt_create_context(4, 4, fn_key);
+    check(wfcrypt_destroy_context(stale), "destroy a context", 4, 4, 0);
+    check_invalid(!wfcrypt_destroy_context(stale), "destroy a context twice");
+    check_invalid(!wfcrypt_encrypt_with(stale, fn_text, fn_out, sizeof(text)), "encrypt with a stale context");
+    check_invalid(!wfcrypt_encrypt_begin(stale, fn_out), "begin a stream on a stale context");
+
+    // its slot is reused by the next handle, which must not make the stale one resolve again
+    HANDLE context = wfcrypt_create_context(4, 4, fn_key);
+    check(context != stale, "reused slot gets a new handle", 4, 4, 0);
+    check_invalid(!wfcrypt_decrypt_with(stale, fn_text, fn_out, sizeof(text)), "decrypt with a stale context");
+
+    // a stream is not a context, and a context is not a stream
+    HANDLE stream = wfcrypt_encrypt_begin(context, reinterpret_cast<char*>(iv));
+    check_invalid(!wfcrypt_encrypt_with(stream, fn_text, fn_out, sizeof(text)), "stream used as a context");
+    check_invalid(!wfcrypt_destroy_context(stream), "stream destroyed as a context");
+    check_invalid(wfcrypt_stream_update(context, fn_text, sizeof(text), fn_out, sizeof(out)) == -1,
+                  "context used as a stream");
+    check_invalid(wfcrypt_stream_final(context, fn_out, sizeof(out)) == -1, "context finished as a stream");
+    check_invalid(!wfcrypt_destroy_stream(context), "context destroyed as a stream");
+
+    // final frees the stream
+    check(wfcrypt_stream_final(stream, fn_out, sizeof(out)) == 16, "finish a stream", 4, 4, 0);
+    check_invalid(wfcrypt_stream_final(stream, fn_out, sizeof(out)) == -1, "finish a stream twice");
+    check_invalid(!wfcrypt_destroy_stream(stream), "destroy a finished stream");
+
+    // handles of other objects, and ones that were never handed out
+    int other = 0;
+    HANDLE foreign = newHANDLE<HANDLE>(&other, HandleKind::eGdiObject);
+    check_invalid(!wfcrypt_encrypt_with(foreign, fn_text, fn_out, sizeof(text)), "GDI object used as a context");
+    check_invalid(wfcrypt_stream_final(foreign, fn_out, sizeof(out)) == -1, "GDI object used as a stream");
+    releaseHANDLE(foreign);
+
+    for(HANDLE made_up : {HANDLE(0), HANDLE(12345), HANDLE(0x7fffffff)}) {
+      check_invalid(!wfcrypt_destroy_context(made_up), "made-up context");
+      check_invalid(!wfcrypt_destroy_stream(made_up), "made-up stream");
+    }
+
+    check(wfcrypt_destroy_context(context), "destroy the context", 4, 4, 0);
+  }
+
+  void check_key_cache() {
+    using wflib::KeyCache;
+
+    std::vector<std::vector<uint8_t>> keys;
+    for(uint32_t ii = 0; ii < 2 * KeyCache::k_Capacity + 1; ++ii)
+      keys.push_back(pattern(32, 1000 + ii));
+    const auto fn_key = [&keys](size_t ii) {
+      return buffer::byte_buffer_view{keys[ii].data(), 16};
+    };
+
+    KeyCache cache;
+    const auto first = cache.acquire(4, fn_key(0));
+    check(cache.acquire(4, fn_key(0)) == first, "repeated key shares its schedule", 4, 4, 0);
+    check(cache.acquire(6, fn_key(0)) != first, "same key, other block size", 6, 4, 0);
+    check(cache.acquire(4, buffer::byte_buffer_view{keys[0].data(), 24}) != first, "longer key with the same start",
+          4, 6, 0);
+
+    // the three entries above and five more keys fill the cache; using the first key again makes it the most recent
+    std::vector<std::shared_ptr<const Context>> held;
+    for(size_t ii = 1; ii <= KeyCache::k_Capacity - 3; ++ii)
+      held.push_back(cache.acquire(4, fn_key(ii)));
+    check(cache.acquire(4, fn_key(0)) == first, "key kept while the cache fills", 4, 4, 0);
+
+    // so a new key evicts the least recently used one instead: the block size 6 entry
+    held.push_back(cache.acquire(4, fn_key(KeyCache::k_Capacity)));
+    check(cache.acquire(4, fn_key(0)) == first, "most recently used key survives an eviction", 4, 4, 0);
+    check(cache.acquire(4, fn_key(1)) == held[0], "newer key survives an eviction", 4, 4, 0);
+
+    // a full cache worth of new keys evicts everything
+    for(size_t ii = KeyCache::k_Capacity + 1; ii < keys.size(); ++ii)
+      held.push_back(cache.acquire(4, fn_key(ii)));
+    const auto again = cache.acquire(4, fn_key(0));
+    check(again != first, "evicted key is expanded again", 4, 4, 0);
+    check(again->blockSize() == 16 && cache.acquire(4, fn_key(0)) == again, "re-expanded key is cached", 4, 4, 0);
+  }
+
+  /*
+   * A payload well above the size from which decryption is split over the thread pool, and not a whole number of
+   * chunks: neither the payload nor its ranges end on a multiple of the blocks cbc_decrypt handles at once.
+   */
+  void check_parallel_decrypt(uint32_t nb, uint32_t nk) {
+    const uint32_t bs = sizeof(uint32_t) * nb;
+    const size_t size = (size_t(1) << 20) / bs * bs + 5 * bs;
+    const std::vector<uint8_t> key = pattern(sizeof(uint32_t) * nk, nb * 10 + nk);
+    const std::vector<uint8_t> text = pattern(size, 42);
+
+    HANDLE context = wfcrypt_create_context(int(nb), int(nk), reinterpret_cast<const char*>(key.data()));
+    const Context ref{nb, buffer::byte_buffer_view{key.data(), key.size()}};
+
+    uint8_t iv[32];
+    std::vector<uint8_t> cipher{text};
+    wfcrypt_encrypt_with(context, reinterpret_cast<char*>(cipher.data()), reinterpret_cast<char*>(iv), int(size));
+    check(cipher == reference_encrypt(ref, text, iv), "encrypt a large payload", nb, nk, size);
+
+    s_LargestSplit = 0;
+    std::vector<uint8_t> plain{cipher};
+    wfcrypt_decrypt_with(context, reinterpret_cast<char*>(plain.data()), reinterpret_cast<const char*>(iv), int(size));
+    check(s_LargestSplit >= 2, "large payload is split over the pool", nb, nk, size);
+    check(plain == reference_decrypt(ref, cipher, iv), "parallel decrypt matches serial decryption", nb, nk, size);
+    check(plain == text, "parallel decrypt round trip", nb, nk, size);
+
+    wfcrypt_destroy_context(context);
+  }
+
+  // the IV pool is buffered per thread, and a forked child must not draw what its parent draws next
+  void check_fork() {
+    const std::vector<uint8_t> key = pattern(16, 5);
+    HANDLE context = wfcrypt_create_context(4, 4, reinterpret_cast<const char*>(key.data()));
+
+    uint8_t iv[16], childIv[16] = {};
+    HANDLE stream = wfcrypt_encrypt_begin(context, reinterpret_cast<char*>(iv));    // fills the pool
+    wfcrypt_destroy_stream(stream);
+
+    int fds[2];
+    if(pipe(fds) != 0) {
+      check(false, "pipe", 4, 4, 0);
+      return;
+    }
+
+    pid_t pid = fork();
+    if(pid == 0) {
+      stream = wfcrypt_encrypt_begin(context, reinterpret_cast<char*>(iv));
+      _exit(write(fds[1], iv, sizeof(iv)) == sizeof(iv) ? 0 : 1);
+    }
+
+    stream = wfcrypt_encrypt_begin(context, reinterpret_cast<char*>(iv));
+    wfcrypt_destroy_stream(stream);
+
+    int status = 0;
+    const bool ok = pid > 0 && read(fds[0], childIv, sizeof(childIv)) == sizeof(childIv) &&
+                    waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    close(fds[0]);
+    close(fds[1]);
+
+    check(ok, "IV from a forked child", 4, 4, 0);
+    check(std::memcmp(iv, childIv, sizeof(iv)) != 0, "forked child draws other IVs than its parent", 4, 4, 0);
+
+    wfcrypt_destroy_context(context);
+  }
+}    // namespace
+
+int main() {
+  for(uint32_t nb : {4, 6, 8}) {
+    const size_t bs = sizeof(uint32_t) * nb;
+
+    for(uint32_t nk : {4, 6, 8}) {
+      for(size_t size : {size_t(0), size_t(1), bs - 1, bs, bs + 1, 4 * bs, 5 * bs + 3, size_t(1000)}) {
+        check_stream(nb, nk, size, {1});
+        check_stream(nb, nk, size, {bs - 1});
+        check_stream(nb, nk, size, {bs + 1});
+        check_stream(nb, nk, size, {7, 13, 3 * bs + 5});
+        check_stream(nb, nk, size, {size_t(4096)});
+      }
+
+      check_bad_padding(nb, nk);
+      check_parallel_decrypt(nb, nk);
+    }
+  }
+
+  check_handles();
+  check_key_cache();
+  check_fork();
+
+  return (s_Failures == 0 ? 0 : 1);
+}
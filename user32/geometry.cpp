@@ -0,0 +1,138 @@
+#include "geometry.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "input.h"
+#include "log.h"
+#include "mkxpGlue.h"
+
+namespace geometry {
+  namespace {
+    std::atomic<uint32_t> s_Generation{1};
+
+    std::mutex s_Mutex;
+
+    struct {
+      uint32_t generation{0};
+      SDL_Window* window{nullptr};
+      Display value{};
+      bool valid{false};
+    } s_Display;
+
+    struct WindowEntry {
+      SDL_Window* window;
+      uint32_t generation;
+      Window value;
+    };
+    std::vector<WindowEntry> s_Windows;
+
+
+    int SDLCALL watchEvents(void*, SDL_Event* ev) {
+      if(ev->type == SDL_WINDOWEVENT || ev->type == SDL_DISPLAYEVENT)
+        invalidate();
+
+      if(ev->type == SDL_WINDOWEVENT && ev->window.event == SDL_WINDOWEVENT_CLOSE)
+        forget(SDL_GetWindowFromID(ev->window.windowID));
+
+      return 1;
+    }
+
+    inline void ensureInstalled() noexcept {
+      static const bool s_Installed = (input::addEventWatch(watchEvents, nullptr), true);
+      (void) s_Installed;
+    }
+
+    bool queryDisplay(SDL_Window* win, Display& out) noexcept {
+      int index = (win ? SDL_GetWindowDisplayIndex(win) : 0);
+      if(index < 0 || SDL_GetDisplayBounds(index, &out.bounds) != 0) {
+        spdlog::error("Failed to obtain display bounds: {}", SDL_GetError());
+        return false;
+      }
+
+      if(SDL_GetDisplayUsableBounds(index, &out.usableBounds) != 0)
+        out.usableBounds = out.bounds;
+
+      out.count = std::max(SDL_GetNumVideoDisplays(), 1);
+      out.virtualBounds = out.bounds;
+      for(int ii = 0; ii < out.count; ++ii) {
+        SDL_Rect r;
+        if(ii == index || SDL_GetDisplayBounds(ii, &r) != 0)
+          continue;
+
+        int right = std::max(out.virtualBounds.x + out.virtualBounds.w, r.x + r.w);
+        int bottom = std::max(out.virtualBounds.y + out.virtualBounds.h, r.y + r.h);
+        out.virtualBounds.x = std::min(out.virtualBounds.x, r.x);
+        out.virtualBounds.y = std::min(out.virtualBounds.y, r.y);
+        out.virtualBounds.w = right - out.virtualBounds.x;
+        out.virtualBounds.h = bottom - out.virtualBounds.y;
+      }
+
+      return true;
+    }
+
+    void queryWindow(SDL_Window* win, Window& out) noexcept {
+      SDL_GetWindowPosition(win, &out.rect.x, &out.rect.y);
+      SDL_GetWindowSize(win, &out.rect.w, &out.rect.h);
+      SDL_GL_GetDrawableSize(win, &out.drawableWidth, &out.drawableHeight);
+
+      if(SDL_GetWindowBordersSize(win, &out.borderTop, &out.borderLeft, &out.borderBottom, &out.borderRight) != 0)
+        out.borderTop = out.borderLeft = out.borderBottom = out.borderRight = 0;
+    }
+  }    // namespace
+
+  bool display(Display& out) noexcept {
+    ensureInstalled();
+
+    uint32_t generation = s_Generation.load(std::memory_order_acquire);
+    SDL_Window* win = mkxp::getWindow();
+
+    std::lock_guard lock{s_Mutex};
+    if(!s_Display.valid || s_Display.generation != generation || s_Display.window != win) {
+      s_Display.valid = queryDisplay(win, s_Display.value);
+      s_Display.generation = generation;
+      s_Display.window = win;
+    }
+
+    out = s_Display.value;
+    return s_Display.valid;
+  }
+
+  bool window(SDL_Window* win, Window& out) noexcept {
+    if(!win)
+      return false;
+
+    ensureInstalled();
+
+    uint32_t generation = s_Generation.load(std::memory_order_acquire);
+
+    std::lock_guard lock{s_Mutex};
+    auto it = std::find_if(s_Windows.begin(), s_Windows.end(), [win](const WindowEntry& e) { return e.window == win; });
+    if(it == s_Windows.end()) {
+      it = s_Windows.insert(s_Windows.end(), WindowEntry{win, 0, {}});
+    }
+
+    if(it->generation != generation) {
+      queryWindow(win, it->value);
+      it->generation = generation;
+    }
+
+    out = it->value;
+    return true;
+  }
+
+  void invalidate() noexcept {
+    s_Generation.fetch_add(1, std::memory_order_acq_rel);
+  }
+
+  void forget(SDL_Window* win) noexcept {
+    if(!win)
+      return;
+
+    std::lock_guard lock{s_Mutex};
+    s_Windows.erase(std::remove_if(s_Windows.begin(), s_Windows.end(), [win](const WindowEntry& e) { return e.window == win; }),
+                    s_Windows.end());
+  }
+}    // namespace geometry
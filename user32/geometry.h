@@ -0,0 +1,34 @@
+#ifndef GEOMETRY_H
+#define GEOMETRY_H
+
+#include <SDL.h>
+
+/*
+ * Cached display and window geometry. Values are queried from SDL once and then served from the cache until an
+ * SDL_WINDOWEVENT or SDL_DISPLAYEVENT (or an explicit invalidate) marks them stale.
+ */
+namespace geometry {
+  struct Display {
+    SDL_Rect bounds;           // display of the game window
+    SDL_Rect usableBounds;     // same, without task bars and docks
+    SDL_Rect virtualBounds;    // union of all displays
+    int count;
+  };
+
+  struct Window {
+    SDL_Rect rect;    // position and size of the client area
+    int drawableWidth, drawableHeight;
+    int borderTop, borderLeft, borderBottom, borderRight;
+  };
+
+  bool display(Display& out) noexcept;
+  bool window(SDL_Window* win, Window& out) noexcept;
+
+  // For changes made through SDL by ourselves, whose events have not been pumped yet.
+  void invalidate() noexcept;
+
+  // Drops the cached geometry of a window that is going away.
+  void forget(SDL_Window* win) noexcept;
+}    // namespace geometry
+
+#endif
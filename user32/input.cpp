@@ -0,0 +1,228 @@
+#include "input.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "log.h"
+#include "vkcodes.h"
+
+namespace input {
+  namespace {
+    std::array<std::atomic<uint8_t>, 256> s_KeyStates{};
+    std::atomic<int64_t> s_CursorPos{0};
+
+    std::mutex s_WatchesMutex;
+    std::vector<std::pair<SDL_EventFilter, void*>> s_Watches;
+
+
+    inline int64_t packPoint(int32_t x, int32_t y) noexcept {
+      return int64_t((uint64_t(uint32_t(y)) << 32u) | uint32_t(x));
+    }
+
+
+    inline void setDown(WORD vk, bool down, bool repeat = false) noexcept {
+      if(down) {
+        uint8_t old = s_KeyStates[vk].fetch_or(eDown | ePressed, std::memory_order_relaxed);
+
+        // only physical presses flip the toggle bit, auto-repeat does not
+        if(!repeat && !(old & eDown))
+          s_KeyStates[vk].fetch_xor(eToggled, std::memory_order_relaxed);
+      } else {
+        s_KeyStates[vk].fetch_and(uint8_t(~eDown), std::memory_order_relaxed);
+      }
+    }
+
+    inline void updateGenericModifier(WORD generic, WORD left, WORD right) noexcept {
+      bool down = (s_KeyStates[left].load(std::memory_order_relaxed) & eDown) ||
+                  (s_KeyStates[right].load(std::memory_order_relaxed) & eDown);
+      bool wasDown = (s_KeyStates[generic].load(std::memory_order_relaxed) & eDown);
+
+      if(down != wasDown)
+        setDown(generic, down);
+    }
+
+    inline WORD fromSDLButton(Uint8 button) noexcept {
+      switch(button) {
+        case SDL_BUTTON_LEFT:
+          return VK_LBUTTON;
+        case SDL_BUTTON_RIGHT:
+          return VK_RBUTTON;
+        case SDL_BUTTON_MIDDLE:
+          return VK_MBUTTON;
+        case SDL_BUTTON_X1:
+          return VK_XBUTTON1;
+        case SDL_BUTTON_X2:
+          return VK_XBUTTON2;
+        default:
+          return 0;
+      }
+    }
+
+    int SDLCALL watchEvents(void*, SDL_Event* ev) {
+      switch(ev->type) {
+        case SDL_KEYDOWN:
+        case SDL_KEYUP: {
+          WORD vk = fromSDLScancode(ev->key.keysym.scancode);
+          if(!vk)
+            break;
+
+          setDown(vk, ev->type == SDL_KEYDOWN, ev->key.repeat != 0);
+
+          updateGenericModifier(VK_SHIFT, VK_LSHIFT, VK_RSHIFT);
+          updateGenericModifier(VK_CONTROL, VK_LCONTROL, VK_RCONTROL);
+          updateGenericModifier(VK_MENU, VK_LMENU, VK_RMENU);
+          break;
+        }
+
+        case SDL_MOUSEMOTION: {
+          s_CursorPos.store(packPoint(ev->motion.x, ev->motion.y), std::memory_order_relaxed);
+          break;
+        }
+
+        case SDL_MOUSEBUTTONDOWN:
+        case SDL_MOUSEBUTTONUP: {
+          if(WORD vk = fromSDLButton(ev->button.button))
+            setDown(vk, ev->type == SDL_MOUSEBUTTONDOWN);
+
+          s_CursorPos.store(packPoint(ev->button.x, ev->button.y), std::memory_order_relaxed);
+          break;
+        }
+
+        case SDL_WINDOWEVENT: {
+          // SDL releases the keyboard by itself when focus is lost, but not the mouse buttons
+          if(ev->window.event == SDL_WINDOWEVENT_FOCUS_LOST) {
+            for(WORD vk : {VK_LBUTTON, VK_RBUTTON, VK_MBUTTON, VK_XBUTTON1, VK_XBUTTON2})
+              setDown(vk, false);
+          }
+          break;
+        }
+      }
+
+      return 1;
+    }
+
+    void install() noexcept {
+      // seed the snapshot with whatever is held down right now
+      int numKeys = 0;
+      const Uint8* keyboard = SDL_GetKeyboardState(&numKeys);
+      for(int sc = 0; sc < numKeys; ++sc) {
+        WORD vk = fromSDLScancode(static_cast<SDL_Scancode>(sc));
+        if(keyboard[sc] && vk)
+          s_KeyStates[vk].store(eDown, std::memory_order_relaxed);
+      }
+      updateGenericModifier(VK_SHIFT, VK_LSHIFT, VK_RSHIFT);
+      updateGenericModifier(VK_CONTROL, VK_LCONTROL, VK_RCONTROL);
+      updateGenericModifier(VK_MENU, VK_LMENU, VK_RMENU);
+
+      int mouseX = 0, mouseY = 0;
+      SDL_GetMouseState(&mouseX, &mouseY);
+      s_CursorPos.store(packPoint(mouseX, mouseY), std::memory_order_relaxed);
+
+      Uint32 mouse = SDL_GetGlobalMouseState(nullptr, nullptr);
+      for(Uint8 button = SDL_BUTTON_LEFT; button <= SDL_BUTTON_X2; ++button) {
+        if(mouse & SDL_BUTTON(button))
+          s_KeyStates[fromSDLButton(button)].store(eDown, std::memory_order_relaxed);
+      }
+
+      SDL_Keymod mod = SDL_GetModState();
+      if(mod & KMOD_CAPS)
+        s_KeyStates[VK_CAPITAL].fetch_or(eToggled, std::memory_order_relaxed);
+      if(mod & KMOD_NUM)
+        s_KeyStates[VK_NUMLOCK].fetch_or(eToggled, std::memory_order_relaxed);
+
+      addEventWatch(watchEvents, nullptr);
+
+      SPDLOG_DEBUG("Installed input snapshot event watch");
+    }
+
+    inline void ensureInstalled() noexcept {
+      static const bool s_Installed = (install(), true);
+      (void) s_Installed;
+    }
+  }    // namespace
+
+  void addEventWatch(SDL_EventFilter filter, void* userdata) noexcept {
+    {
+      std::lock_guard lock{s_WatchesMutex};
+      s_Watches.emplace_back(filter, userdata);
+    }
+
+    SDL_AddEventWatch(filter, userdata);
+  }
+
+  void delEventWatch(SDL_EventFilter filter, void* userdata) noexcept {
+    SDL_DelEventWatch(filter, userdata);
+
+    std::lock_guard lock{s_WatchesMutex};
+    s_Watches.erase(std::remove(s_Watches.begin(), s_Watches.end(), std::make_pair(filter, userdata)),
+                    s_Watches.end());
+  }
+
+  int injectEvents(SDL_Event* events, int count) noexcept {
+    ensureInstalled();
+
+    int added = SDL_PeepEvents(events, count, SDL_ADDEVENT, SDL_FIRSTEVENT, SDL_LASTEVENT);
+    if(added <= 0)
+      return added;
+
+    std::lock_guard lock{s_WatchesMutex};
+    for(int ii = 0; ii < added; ++ii) {
+      for(auto [filter, userdata] : s_Watches)
+        filter(userdata, &events[ii]);
+    }
+
+    return added;
+  }
+
+  POINT cursorPos() noexcept {
+    ensureInstalled();
+
+    int64_t packed = s_CursorPos.load(std::memory_order_relaxed);
+    return POINT{int32_t(uint32_t(packed)), int32_t(uint32_t(uint64_t(packed) >> 32u))};
+  }
+
+  uint8_t keyState(WORD vk) noexcept {
+    ensureInstalled();
+
+    if(vk >= s_KeyStates.size())
+      return 0;
+
+    return s_KeyStates[vk].load(std::memory_order_relaxed);
+  }
+
+  uint8_t consumeKeyState(WORD vk) noexcept {
+    ensureInstalled();
+
+    if(vk >= s_KeyStates.size())
+      return 0;
+
+    return s_KeyStates[vk].fetch_and(uint8_t(~ePressed), std::memory_order_relaxed);
+  }
+
+  void keyboardState(uint8_t (&states)[256]) noexcept {
+    ensureInstalled();
+
+    for(uint32_t vk = 0; vk < s_KeyStates.size(); ++vk)
+      states[vk] = s_KeyStates[vk].load(std::memory_order_relaxed) & (eDown | eToggled);
+  }
+
+  void consumeKeyStateMask(const uint64_t (&query)[4], uint64_t (&active)[4]) noexcept {
+    ensureInstalled();
+
+    for(uint32_t ii = 0; ii < 4; ++ii) {
+      active[ii] = 0;
+
+      for(uint64_t bits = query[ii]; bits != 0; bits &= bits - 1) {
+        uint32_t bit = __builtin_ctzll(bits);
+        uint8_t state = s_KeyStates[64 * ii + bit].fetch_and(uint8_t(~ePressed), std::memory_order_relaxed);
+
+        if(state & (eDown | ePressed))
+          active[ii] |= (uint64_t{1} << bit);
+      }
+    }
+  }
+}    // namespace input
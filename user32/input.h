@@ -0,0 +1,60 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <cstdint>
+
+#include <SDL.h>
+
+#include "wintypes.h"
+
+namespace input {
+  /*
+   * Event watches registered through here also see the events injected with injectEvents, which SDL_PeepEvents
+   * would otherwise hide from them.
+   */
+  void addEventWatch(SDL_EventFilter filter, void* userdata) noexcept;
+  void delEventWatch(SDL_EventFilter filter, void* userdata) noexcept;
+
+  /*
+   * Appends the events to the SDL event queue in one go and runs them through the event watches. Returns the number
+   * of events added, or a negative value on error.
+   */
+  int injectEvents(SDL_Event* events, int count) noexcept;
+
+  /*
+   * Last known mouse position relative to the game window, as reported by mouse events (injected ones included).
+   */
+  POINT cursorPos() noexcept;
+
+
+  enum KeyStateFlags : uint8_t {
+    eToggled = 0x01,    // low bit of GetKeyState
+    ePressed = 0x02,    // pressed since the last GetAsyncKeyState query
+    eDown    = 0x80,    // high bit of GetKeyState/GetAsyncKeyState
+  };
+
+  /*
+   * Returns the current snapshot flags of the given virtual key. The snapshot is kept up to date by an SDL event
+   * watch which is installed on first use, so this is just a memory read.
+   */
+  uint8_t keyState(WORD vk) noexcept;
+
+  /*
+   * Same as keyState, but also clears the ePressed flag of the key (GetAsyncKeyState semantics).
+   */
+  uint8_t consumeKeyState(WORD vk) noexcept;
+
+  /*
+   * Fills all 256 entries in GetKeyboardState format: high bit if the key is down, low bit if it is toggled.
+   */
+  void keyboardState(uint8_t (&states)[256]) noexcept;
+
+  /*
+   * Bulk version of consumeKeyState over a 256-bit key mask (bit n of the mask is virtual key n). For every key set in
+   * the query mask, the corresponding bit of the active mask is set if the key is down or was pressed since the last
+   * query.
+   */
+  void consumeKeyStateMask(const uint64_t (&query)[4], uint64_t (&active)[4]) noexcept;
+}    // namespace input
+
+#endif
@@ -0,0 +1,572 @@
+#include "messages.h"
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <SDL.h>
+
+#include "geometry.h"
+#include "input.h"
+#include "log.h"
+#include "mkxpGlue.h"
+#include "timers.h"
+
+namespace messages {
+  namespace {
+    constexpr UINT WM_QUIT = 0x0012;
+    constexpr UINT WM_TIMER = 0x0113;
+
+    constexpr int GWLP_WNDPROC = -4;
+    constexpr int GWLP_USERDATA = -21;
+
+    constexpr HWND HWND_THREAD = HWND(-1);
+
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) && std::atomic<uint32_t>::is_always_lock_free);
+
+    inline void futexWait(std::atomic<uint32_t>& word, uint32_t expected) noexcept {
+      syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+    }
+
+    inline void futexWake(std::atomic<uint32_t>& word) noexcept {
+      syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+    }
+
+
+    /*
+     * Lives on the stack of a SendMessage caller until the receiver completes it. Completing notifies the sending
+     * thread, which keeps handling messages sent to itself while it waits.
+     */
+    struct Reply {
+      explicit Reply(std::shared_ptr<Thread> waiter) noexcept : waiter{std::move(waiter)} {}
+
+      void complete(LRESULT r) noexcept;
+
+      std::atomic<uint32_t> done{0};
+      LRESULT result{0};
+      std::shared_ptr<Thread> waiter;
+    };
+
+    struct Node {
+      std::atomic<Node*> next{nullptr};
+      MSG msg{};
+      Reply* reply{nullptr};
+      uint64_t sequence{0};
+    };
+
+    std::atomic<uint64_t> s_Sequence{0};
+
+    Node* makeNode(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam) {
+      auto* node = new Node;
+      node->msg.hwnd = hwnd;
+      node->msg.message = message;
+      node->msg.wParam = wParam;
+      node->msg.lParam = lParam;
+      node->msg.time = SDL_GetTicks();
+      node->sequence = s_Sequence.fetch_add(1, std::memory_order_relaxed);
+      return node;
+    }
+
+    void discard(Node* node) noexcept {
+      if(node->reply)
+        node->reply->complete(0);
+
+      delete node;
+    }
+
+    /*
+     * Intrusive multi-producer single-consumer queue (D. Vyukov). push is a single exchange; pop may only be called by
+     * the owner thread and can transiently report an empty queue while a push is halfway through, which is fine since
+     * the pusher notifies the owner once it is done.
+     */
+    class MpscQueue {
+      public:
+        MpscQueue() noexcept : m_Head{&m_Stub}, m_Tail{&m_Stub} {}
+
+        MpscQueue(const MpscQueue&) = delete;
+        MpscQueue& operator=(const MpscQueue&) = delete;
+
+        ~MpscQueue() {
+          while(Node* node = pop())
+            discard(node);
+        }
+
+        void push(Node* node) noexcept {
+          node->next.store(nullptr, std::memory_order_relaxed);
+          Node* prev = m_Head.exchange(node, std::memory_order_acq_rel);
+          prev->next.store(node, std::memory_order_release);
+        }
+
+        Node* pop() noexcept {
+          Node* tail = m_Tail;
+          Node* next = tail->next.load(std::memory_order_acquire);
+
+          if(tail == &m_Stub) {
+            if(!next)
+              return nullptr;
+
+            m_Tail = next;
+            tail = next;
+            next = next->next.load(std::memory_order_acquire);
+          }
+
+          if(next) {
+            m_Tail = next;
+            return tail;
+          }
+
+          if(tail != m_Head.load(std::memory_order_acquire))
+            return nullptr;
+
+          push(&m_Stub);
+
+          next = tail->next.load(std::memory_order_acquire);
+          if(next) {
+            m_Tail = next;
+            return tail;
+          }
+
+          return nullptr;
+        }
+
+      private:
+        alignas(64) std::atomic<Node*> m_Head;
+        alignas(64) Node* m_Tail;
+        Node m_Stub;
+    };
+
+    struct Window;
+  }    // namespace
+
+  struct Thread {
+    std::atomic<uint32_t> wake{0};
+    std::atomic<uint32_t> waiting{0};
+    bool alive{true};    // guarded by s_WindowsMutex
+
+    MpscQueue posted;    // messages posted to the thread itself
+    MpscQueue sent;      // cross-thread SendMessage requests, handled before anything else
+
+    // only touched by the owner thread
+    std::vector<std::shared_ptr<Window>> windows;
+    std::deque<Node*> sentPending;
+    std::deque<Node*> pending;
+    Reply* currentReply{nullptr};
+
+    void notify() noexcept {
+      wake.fetch_add(1);
+      if(waiting.load() != 0)
+        futexWake(wake);
+    }
+  };
+
+  namespace {
+    void Reply::complete(LRESULT r) noexcept {
+      // the sender may return (and its thread exit) as soon as done is set, so keep the thread alive for the notify
+      std::shared_ptr<Thread> t = std::move(waiter);
+
+      result = r;
+      done.store(1, std::memory_order_release);
+      t->notify();
+    }
+
+    struct Window {
+      HWND hwnd{0};
+      std::shared_ptr<Thread> owner;
+      MpscQueue queue;
+      std::atomic<WNDPROC> proc{nullptr};
+      std::atomic<LONG_PTR> userData{0};
+    };
+
+    std::shared_mutex s_WindowsMutex;
+    std::unordered_map<HWND, std::shared_ptr<Window>> s_Windows;
+
+    std::shared_ptr<Window> findWindow(HWND hwnd) {
+      std::shared_lock lock{s_WindowsMutex};
+
+      auto it = s_Windows.find(hwnd);
+      return (it != s_Windows.end() ? it->second : nullptr);
+    }
+
+    void finishReply(Thread& t, LRESULT result) noexcept {
+      if(t.currentReply) {
+        t.currentReply->complete(result);
+        t.currentReply = nullptr;
+      }
+    }
+
+    void handleSent(Thread& t) {
+      while(Node* node = t.sent.pop()) {
+        auto win = findWindow(node->msg.hwnd);
+        WNDPROC proc = (win ? win->proc.load(std::memory_order_acquire) : nullptr);
+
+        if(proc) {
+          node->reply->complete(proc(node->msg.hwnd, node->msg.message, node->msg.wParam, node->msg.lParam));
+          delete node;
+        } else {
+          // no window procedure to run it, so it is delivered like a posted message and answered with ReplyMessage
+          t.sentPending.push_back(node);
+        }
+      }
+    }
+
+    // Moves everything posted to the thread and its windows into the pending list, keeping the posting order.
+    void drain(Thread& t) {
+      size_t start = t.pending.size();
+      int sources = 0;
+
+      auto take = [&t, &sources](MpscQueue& queue) {
+        bool any = false;
+        while(Node* node = queue.pop()) {
+          t.pending.push_back(node);
+          any = true;
+        }
+        sources += any;
+      };
+
+      take(t.posted);
+      for(auto& win : t.windows)
+        take(win->queue);
+
+      if(sources > 1 || (sources > 0 && start > 0)) {
+        auto bySequence = [](const Node* a, const Node* b) { return a->sequence < b->sequence; };
+        auto mid = t.pending.begin() + start;
+        std::sort(mid, t.pending.end(), bySequence);
+        std::inplace_merge(t.pending.begin(), mid, t.pending.end(), bySequence);
+      }
+    }
+
+    void discardWindowMessages(std::deque<Node*>& queue, HWND hwnd) {
+      auto it = std::remove_if(queue.begin(), queue.end(), [hwnd](Node* node) {
+        if(node->msg.hwnd != hwnd)
+          return false;
+
+        discard(node);
+        return true;
+      });
+      queue.erase(it, queue.end());
+    }
+
+    struct ThreadState {
+      std::shared_ptr<Thread> thread = std::make_shared<Thread>();
+
+      // windows do not outlive the thread that created them
+      ~ThreadState() {
+        Thread& t = *thread;
+
+        {
+          std::unique_lock lock{s_WindowsMutex};
+          t.alive = false;
+          for(auto& win : t.windows) {
+            s_Windows.erase(win->hwnd);
+            releaseHANDLE(win->hwnd);
+          }
+        }
+
+        // outside of the lock: the timer thread takes it while holding its own
+        for(auto& win : t.windows)
+          timers::forget(win->hwnd);
+        timers::forget(&t);
+
+        finishReply(t, 0);
+        while(Node* node = t.sent.pop())
+          discard(node);
+        for(Node* node : t.sentPending)
+          discard(node);
+        for(Node* node : t.pending)
+          discard(node);
+
+        t.sentPending.clear();
+        t.pending.clear();
+        t.windows.clear();
+      }
+    };
+
+    thread_local ThreadState t_State;
+
+    inline Thread& thisThread() {
+      return *t_State.thread;
+    }
+
+    inline bool matches(const MSG& msg, HWND hwnd, UINT filterMin, UINT filterMax) {
+      if(hwnd == HWND_THREAD) {
+        if(msg.hwnd)
+          return false;
+      } else if(hwnd && msg.hwnd != hwnd) {
+        return false;
+      }
+
+      return (filterMin == 0 && filterMax == 0) || (msg.message >= filterMin && msg.message <= filterMax);
+    }
+
+    POINT screenCursorPos() {
+      POINT pt = input::cursorPos();
+
+      geometry::Window geom;
+      if(geometry::window(mkxp::getWindow(), geom)) {
+        pt.x += geom.rect.x;
+        pt.y += geom.rect.y;
+      }
+
+      return pt;
+    }
+  }    // namespace
+
+  std::shared_ptr<Thread> currentThread() noexcept {
+    return t_State.thread;
+  }
+
+  bool isWindow(HWND hwnd) noexcept {
+    return hwnd && fromHANDLE(hwnd, HandleKind::eMessageWindow) != nullptr;
+  }
+
+  HWND createWindow() noexcept {
+    auto win = std::make_shared<Window>();
+    win->owner = t_State.thread;
+    win->hwnd = newHANDLE<HWND>(win.get(), HandleKind::eMessageWindow);
+
+    {
+      std::unique_lock lock{s_WindowsMutex};
+      s_Windows.emplace(win->hwnd, win);
+    }
+
+    thisThread().windows.push_back(std::move(win));
+    return thisThread().windows.back()->hwnd;
+  }
+
+  bool destroyWindow(HWND hwnd) noexcept {
+    Thread& t = thisThread();
+
+    auto it = std::find_if(t.windows.begin(), t.windows.end(), [hwnd](auto& win) { return win->hwnd == hwnd; });
+    if(it == t.windows.end()) {
+      spdlog::warn("Window {} is not a message window of this thread", (void*) (hwnd));
+      return false;
+    }
+
+    // anything already sent to the window still reaches its window procedure
+    handleSent(t);
+    drain(t);
+
+    // those window procedures may have created or destroyed windows, this one included
+    it = std::find_if(t.windows.begin(), t.windows.end(), [hwnd](auto& win) { return win->hwnd == hwnd; });
+    if(it == t.windows.end())
+      return true;
+
+    {
+      std::unique_lock lock{s_WindowsMutex};
+      s_Windows.erase(hwnd);
+    }
+    releaseHANDLE(hwnd);
+    timers::forget(hwnd);
+
+    discardWindowMessages(t.sentPending, hwnd);
+    discardWindowMessages(t.pending, hwnd);
+    t.windows.erase(it);
+    return true;
+  }
+
+  LONG_PTR getWindowLong(HWND hwnd, int index) noexcept {
+    auto win = findWindow(hwnd);
+    if(!win)
+      return 0;
+
+    switch(index) {
+      case GWLP_WNDPROC:
+        return reinterpret_cast<LONG_PTR>(win->proc.load(std::memory_order_acquire));
+
+      case GWLP_USERDATA:
+        return win->userData.load(std::memory_order_acquire);
+
+      default:
+        spdlog::warn("Ignored request for parameter {} of message window {}", index, (void*) (hwnd));
+        return 0;
+    }
+  }
+
+  LONG_PTR setWindowLong(HWND hwnd, int index, LONG_PTR value) noexcept {
+    auto win = findWindow(hwnd);
+    if(!win)
+      return 0;
+
+    switch(index) {
+      case GWLP_WNDPROC:
+        return reinterpret_cast<LONG_PTR>(
+            win->proc.exchange(reinterpret_cast<WNDPROC>(value), std::memory_order_acq_rel));
+
+      case GWLP_USERDATA:
+        return win->userData.exchange(value, std::memory_order_acq_rel);
+
+      default:
+        spdlog::warn("Ignoring parameter {} change request for message window {}", index, (void*) (hwnd));
+        return 0;
+    }
+  }
+
+  bool post(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam) noexcept {
+    if(!hwnd) {
+      Thread& t = thisThread();
+      t.posted.push(makeNode(0, message, wParam, lParam));
+      t.notify();
+      return true;
+    }
+
+    auto win = findWindow(hwnd);
+    if(!win)
+      return false;
+
+    // if the window is destroyed meanwhile, the message is freed along with its queue
+    win->queue.push(makeNode(hwnd, message, wParam, lParam));
+    win->owner->notify();
+    return true;
+  }
+
+  bool post(const std::shared_ptr<Thread>& thread, UINT message, WPARAM wParam, LPARAM lParam) noexcept {
+    if(!thread)
+      return false;
+
+    thread->posted.push(makeNode(0, message, wParam, lParam));
+    thread->notify();
+    return true;
+  }
+
+  void postQuit(int exitCode) noexcept {
+    post(0, WM_QUIT, WPARAM(exitCode), 0);
+  }
+
+  int peek(MSG& msg, HWND hwnd, UINT filterMin, UINT filterMax, bool remove) noexcept {
+    Thread& t = thisThread();
+
+    if(hwnd && hwnd != HWND_THREAD) {
+      auto owned = std::any_of(t.windows.begin(), t.windows.end(), [hwnd](auto& win) { return win->hwnd == hwnd; });
+      if(!owned)
+        return -1;
+    }
+
+    // the previous sent message is done with if it was not answered explicitly
+    finishReply(t, 0);
+
+    handleSent(t);
+    drain(t);
+
+    auto pick = [&](std::deque<Node*>& queue) {
+      auto it = std::find_if(queue.begin(), queue.end(),
+                             [&](const Node* node) { return matches(node->msg, hwnd, filterMin, filterMax); });
+      if(it == queue.end())
+        return false;
+
+      Node* node = *it;
+      msg = node->msg;
+      msg.pt = screenCursorPos();
+
+      if(remove) {
+        queue.erase(it);
+        t.currentReply = node->reply;
+        delete node;
+
+        if(msg.message == WM_TIMER)
+          timers::retrieved(msg.hwnd, msg.wParam);
+      }
+
+      return true;
+    };
+
+    return (pick(t.sentPending) || pick(t.pending)) ? 1 : 0;
+  }
+
+  int get(MSG& msg, HWND hwnd, UINT filterMin, UINT filterMax) noexcept {
+    Thread& t = thisThread();
+
+    while(true) {
+      uint32_t wake = t.wake.load();
+
+      int found = peek(msg, hwnd, filterMin, filterMax, true);
+      if(found < 0)
+        return -1;
+      else if(found > 0)
+        return (msg.message != WM_QUIT ? 1 : 0);
+
+      // a notification after the load above changes the futex word, so the wait returns straight away
+      t.waiting.fetch_add(1);
+      futexWait(t.wake, wake);
+      t.waiting.fetch_sub(1);
+    }
+  }
+
+  LRESULT send(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam) noexcept {
+    Thread& t = thisThread();
+    Reply reply{t_State.thread};
+
+    {
+      std::shared_lock lock{s_WindowsMutex};
+
+      auto it = s_Windows.find(hwnd);
+      if(it == s_Windows.end())
+        return 0;
+
+      auto& win = it->second;
+      if(win->owner.get() == &t) {
+        WNDPROC proc = win->proc.load(std::memory_order_acquire);
+        lock.unlock();
+
+        return (proc ? proc(hwnd, message, wParam, lParam) : 0);
+      }
+
+      // pushing under the lock guarantees the owner thread is still around to answer
+      if(!win->owner->alive)
+        return 0;
+
+      Node* node = makeNode(hwnd, message, wParam, lParam);
+      node->reply = &reply;
+      win->owner->sent.push(node);
+      win->owner->notify();
+    }
+
+    // messages sent to this thread meanwhile are handled as they come, or two threads sending to each other (or a
+    // receiver sending back to its sender) would wait on one another forever
+    while(true) {
+      uint32_t wake = t.wake.load();
+
+      handleSent(t);
+      if(reply.done.load(std::memory_order_acquire) != 0)
+        return reply.result;
+
+      t.waiting.fetch_add(1);
+      futexWait(t.wake, wake);
+      t.waiting.fetch_sub(1);
+    }
+  }
+
+  bool reply(LRESULT result) noexcept {
+    Thread& t = thisThread();
+    if(!t.currentReply)
+      return false;
+
+    finishReply(t, result);
+    return true;
+  }
+
+  LRESULT dispatch(const MSG& msg) noexcept {
+    // timers created with a callback run it instead of the window procedure
+    if(msg.message == WM_TIMER && msg.lParam != 0) {
+      reinterpret_cast<TIMERPROC>(msg.lParam)(msg.hwnd, msg.message, msg.wParam, msg.time);
+      return 0;
+    }
+
+    if(!msg.hwnd)
+      return 0;
+
+    auto win = findWindow(msg.hwnd);
+    WNDPROC proc = (win ? win->proc.load(std::memory_order_acquire) : nullptr);
+
+    return (proc ? proc(msg.hwnd, msg.message, msg.wParam, msg.lParam) : 0);
+  }
+}    // namespace messages
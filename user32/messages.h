@@ -0,0 +1,57 @@
+#ifndef MESSAGES_H
+#define MESSAGES_H
+
+#include <memory>
+
+#include "wintypes.h"
+
+/*
+ * Window message emulation for message-only windows (the hidden windows scripts create with CreateWindowExA to pass
+ * data between threads). Every window has its own lock-free MPSC queue, owned by the thread that created it; the
+ * owner retrieves messages for all of its windows with peek/get.
+ */
+namespace messages {
+  // Message queue of a thread, for posting to it from other threads (thread timers, for one).
+  struct Thread;
+
+  std::shared_ptr<Thread> currentThread() noexcept;
+
+  bool isWindow(HWND hwnd) noexcept;
+
+  HWND createWindow() noexcept;
+  bool destroyWindow(HWND hwnd) noexcept;
+
+  // GWLP_WNDPROC and GWLP_USERDATA of message windows.
+  LONG_PTR getWindowLong(HWND hwnd, int index) noexcept;
+  LONG_PTR setWindowLong(HWND hwnd, int index, LONG_PTR value) noexcept;
+
+  /*
+   * Queues a message for the window, or for the calling thread if hwnd is null. Never blocks.
+   */
+  bool post(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam) noexcept;
+  bool post(const std::shared_ptr<Thread>& thread, UINT message, WPARAM wParam, LPARAM lParam) noexcept;
+  void postQuit(int exitCode) noexcept;
+
+  /*
+   * PeekMessage semantics: hwnd 0 matches every message of the thread, hwnd -1 only the ones posted to the thread
+   * itself. Returns 1 if a message was retrieved, 0 if none matched and -1 if hwnd does not belong to the thread.
+   */
+  int peek(MSG& msg, HWND hwnd, UINT filterMin, UINT filterMax, bool remove) noexcept;
+
+  /*
+   * GetMessage semantics: waits (on a futex) for a matching message. Returns 0 for WM_QUIT and -1 on error.
+   */
+  int get(MSG& msg, HWND hwnd, UINT filterMin, UINT filterMax) noexcept;
+
+  /*
+   * Calls the window procedure directly when the window belongs to the calling thread. Otherwise the message is
+   * handed to the owner thread and the caller blocks until it has been handled: by the window procedure if there is
+   * one, or else by the owner retrieving it and calling reply (or its next peek/get, which replies 0).
+   */
+  LRESULT send(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam) noexcept;
+  bool reply(LRESULT result) noexcept;
+
+  LRESULT dispatch(const MSG& msg) noexcept;
+}    // namespace messages
+
+#endif
@@ -1,17 +1,44 @@
 #include "mkxpGlue.h"
 
+#include "replay.h"
 #include "visibility.h"
 
 namespace mkxp {
   namespace {
     SDL_Window* s_Window = nullptr;
+    OverlayUpload s_OverlayUpload = nullptr;
+    FrameCapture s_FrameCapture = nullptr;
   }
 
   SDL_Window* getWindow() noexcept {
     return s_Window;
   }
 
+  bool captureFrame(void* pixels, int stride, int width, int height) noexcept {
+    return s_FrameCapture && s_FrameCapture(pixels, stride, width, height);
+  }
+
+  bool uploadOverlay(const void* pixels, int stride, int x, int y, int width, int height) noexcept {
+    if(!s_OverlayUpload)
+      return false;
+
+    s_OverlayUpload(pixels, stride, x, y, width, height);
+    return true;
+  }
+
   WIN32_API void setWindow(SDL_Window* win) noexcept {
     s_Window = win;
   }
+
+  WIN32_API void setFrameCapture(FrameCapture capture) noexcept {
+    s_FrameCapture = capture;
+  }
+
+  WIN32_API void setOverlayUpload(OverlayUpload upload) noexcept {
+    s_OverlayUpload = upload;
+  }
+
+  WIN32_API void advanceFrame() noexcept {
+    replay::advanceFrame();
+  }
 }    // namespace mkxp
@@ -4,7 +4,25 @@
 #include <SDL2/SDL.h>
 
 namespace mkxp {
+  /*
+   * Receives the parts of the game window that GDI drew on, as top-down 32 bpp BGRA rows starting at (x, y). Pixels
+   * GDI never touched are transparent, so mkxp can blend the whole thing over the frame.
+   */
+  using OverlayUpload = void (*)(const void* pixels, int stride, int x, int y, int width, int height);
+
+  /*
+   * Fills pixels with the frame last shown in the game window, overlay included, as top-down 32 bpp BGRA rows scaled
+   * to width x height. Returns false if it couldn't.
+   */
+  using FrameCapture = bool (*)(void* pixels, int stride, int width, int height);
+
   SDL_Window* getWindow() noexcept;
+
+  // false if mkxp has not set a capture function, or it failed
+  bool captureFrame(void* pixels, int stride, int width, int height) noexcept;
+
+  // false if mkxp has not set an upload function
+  bool uploadOverlay(const void* pixels, int stride, int x, int y, int width, int height) noexcept;
 }
 
 #endif
@@ -0,0 +1,422 @@
+#include "replay.h"
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <atomic>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "log.h"
+#include "utils.h"
+
+namespace replay {
+  namespace {
+    /*
+     * Log layout (little endian):
+     *   header: "W32I", version byte, 3 reserved bytes
+     *   record: kind byte, LEB128 frame delta to the previous record, kind-specific payload
+     */
+    constexpr char k_Magic[4] = {'W', '3', '2', 'I'};
+    constexpr uint8_t k_Version = 1;
+    constexpr size_t k_HeaderSize = 8;
+
+    enum class Kind : uint8_t {
+      eKeyState = 1,         // vk byte, state int16
+      eAsyncKeyState = 2,    // vk byte, state int16
+      eKeyboardState = 3,    // 256 state bytes
+      eKeyStateMask = 4,     // 32 query mask bytes, 32 active mask bytes
+      eCursorPos = 5,        // zigzag LEB128 x, y
+      eSendInput = 6,        // LEB128 count
+    };
+
+    using Bytes = std::vector<uint8_t>;
+
+
+    inline void putVarint(Bytes& out, uint64_t v) {
+      do {
+        uint8_t b = v & 0x7fu;
+        v >>= 7u;
+        out.push_back(b | (v ? 0x80u : 0u));
+      } while(v);
+    }
+
+    inline void putZigzag(Bytes& out, int64_t v) {
+      putVarint(out, (uint64_t(v) << 1u) ^ uint64_t(v >> 63));
+    }
+
+    inline void putInt16(Bytes& out, int16_t v) {
+      out.push_back(uint16_t(v) & 0xffu);
+      out.push_back(uint16_t(v) >> 8u);
+    }
+
+    struct Reader {
+      const uint8_t* p;
+      const uint8_t* end;
+
+      bool varint(uint64_t& v) noexcept {
+        v = 0;
+        for(uint32_t shift = 0; p != end && shift < 64; shift += 7) {
+          uint8_t b = *p++;
+          v |= uint64_t(b & 0x7fu) << shift;
+          if(!(b & 0x80u))
+            return true;
+        }
+        return false;
+      }
+
+      bool zigzag(int64_t& v) noexcept {
+        uint64_t u;
+        if(!varint(u))
+          return false;
+        v = int64_t(u >> 1u) ^ -int64_t(u & 1u);
+        return true;
+      }
+
+      bool int16(int16_t& v) noexcept {
+        if(end - p < 2)
+          return false;
+        v = int16_t(bytes::concat2(p[0], p[1]));
+        p += 2;
+        return true;
+      }
+
+      bool raw(void* dst, size_t n) noexcept {
+        if(size_t(end - p) < n)
+          return false;
+        std::memcpy(dst, p, n);
+        p += n;
+        return true;
+      }
+    };
+
+    std::string expandPath(std::string_view path) {
+      return str::replace_all(path, "{pid}", std::to_string(getpid()));
+    }
+
+
+    class Session {
+     public:
+      Session() {
+        if(const char* path = std::getenv("WIN32API_INPUT_REPLAY"); path && *path)
+          openReplay(expandPath(path));
+        else if(const char* path = std::getenv("WIN32API_INPUT_RECORD"); path && *path)
+          openRecord(expandPath(path));
+      }
+
+      ~Session() {
+        if(m_File)
+          std::fclose(m_File);
+      }
+
+      [[nodiscard]] bool recording() const noexcept {
+        return m_File != nullptr;
+      }
+
+      [[nodiscard]] bool replaying() const noexcept {
+        return !m_Data.empty();
+      }
+
+      void advanceFrame() noexcept {
+        m_Frame.fetch_add(1, std::memory_order_relaxed);
+      }
+
+      template <typename F>
+      void record(Kind kind, F&& writePayload) noexcept {
+        std::lock_guard lock{m_Mutex};
+
+        uint64_t frame = m_Frame.load(std::memory_order_relaxed);
+
+        m_Scratch.clear();
+        m_Scratch.push_back(uint8_t(kind));
+        putVarint(m_Scratch, frame - m_LastFrame);
+        writePayload(m_Scratch);
+
+        m_LastFrame = frame;
+
+        if(std::fwrite(m_Scratch.data(), 1, m_Scratch.size(), m_File) != m_Scratch.size()) {
+          spdlog::error("Failed to write input record log, recording stopped");
+          std::fclose(m_File);
+          m_File = nullptr;
+        }
+      }
+
+      /*
+       * Serves the next record if it belongs to the current frame and is of the given kind. The reader function gets
+       * the payload and returns false if the record does not match the call (e.g. a different key), in which case it
+       * is left for a later call.
+       */
+      template <typename F>
+      bool serve(Kind kind, F&& readPayload) noexcept {
+        std::lock_guard lock{m_Mutex};
+
+        uint64_t frame = m_Frame.load(std::memory_order_relaxed);
+
+        // records of earlier frames belong to calls that did not happen this time around
+        while(m_HasNext && m_NextFrame < frame)
+          skipNext();
+
+        if(m_HasNext && m_NextFrame == frame && m_NextKind == kind) {
+          Reader r{m_Cursor, m_Data.data() + m_Data.size()};
+          if(readPayload(r)) {
+            m_Cursor = r.p;
+            parseNext();
+            return true;
+          }
+        }
+
+        if(m_Divergences++ == 0)
+          spdlog::warn("Input replay diverged from the log at frame {}", frame);
+
+        return false;
+      }
+
+     private:
+      void openRecord(const std::string& path) {
+        m_File = std::fopen(path.c_str(), "wb");
+        if(!m_File) {
+          spdlog::error("Failed to open input record log '{}': {}", path, std::strerror(errno));
+          return;
+        }
+
+        std::setvbuf(m_File, nullptr, _IOFBF, 64 * 1024);
+
+        uint8_t header[k_HeaderSize] = {};
+        std::memcpy(header, k_Magic, sizeof(k_Magic));
+        header[4] = k_Version;
+        std::fwrite(header, 1, sizeof(header), m_File);
+
+        spdlog::info("Recording input to '{}'", path);
+      }
+
+      void openReplay(const std::string& path) {
+        std::ifstream is{path, std::ios::binary};
+        Bytes data;
+        if(is)
+          data.assign(std::istreambuf_iterator<char>{is}, std::istreambuf_iterator<char>{});
+
+        if(data.size() < k_HeaderSize || std::memcmp(data.data(), k_Magic, sizeof(k_Magic)) != 0 ||
+           data[4] != k_Version) {
+          spdlog::error("Failed to load input replay log '{}'", path);
+          return;
+        }
+
+        m_Data = std::move(data);
+        m_Cursor = m_Data.data() + k_HeaderSize;
+        parseNext();
+
+        // no window system is needed when input comes from the log
+        setenv("SDL_VIDEODRIVER", "dummy", 0);
+
+        spdlog::info("Replaying input from '{}'", path);
+      }
+
+      void parseNext() noexcept {
+        Reader r{m_Cursor, m_Data.data() + m_Data.size()};
+        uint64_t delta;
+
+        m_HasNext = false;
+        if(r.p == r.end)
+          return;
+
+        m_NextKind = Kind(*r.p++);
+        if(!r.varint(delta)) {
+          spdlog::warn("Truncated input replay log");
+          return;
+        }
+
+        m_NextFrame += delta;
+        m_Cursor = r.p;
+        m_HasNext = true;
+      }
+
+      void skipNext() noexcept {
+        Reader r{m_Cursor, m_Data.data() + m_Data.size()};
+        uint64_t u;
+        int64_t i;
+        bool ok = true;
+
+        switch(m_NextKind) {
+          case Kind::eKeyState:
+          case Kind::eAsyncKeyState:
+            ok = (r.end - r.p >= 3);
+            r.p += (ok ? 3 : 0);
+            break;
+          case Kind::eKeyboardState:
+            ok = (r.end - r.p >= 256);
+            r.p += (ok ? 256 : 0);
+            break;
+          case Kind::eKeyStateMask:
+            ok = (r.end - r.p >= 64);
+            r.p += (ok ? 64 : 0);
+            break;
+          case Kind::eCursorPos:
+            ok = r.zigzag(i) && r.zigzag(i);
+            break;
+          case Kind::eSendInput:
+            ok = r.varint(u);
+            break;
+          default:
+            ok = false;
+            break;
+        }
+
+        if(!ok) {
+          spdlog::warn("Corrupt input replay log, replay stopped");
+          m_HasNext = false;
+          return;
+        }
+
+        m_Cursor = r.p;
+        parseNext();
+      }
+
+
+      std::mutex m_Mutex;
+      std::atomic<uint64_t> m_Frame{0};
+
+      std::FILE* m_File{nullptr};
+      uint64_t m_LastFrame{0};
+      Bytes m_Scratch;
+
+      Bytes m_Data;
+      const uint8_t* m_Cursor{nullptr};
+      bool m_HasNext{false};
+      Kind m_NextKind{};
+      uint64_t m_NextFrame{0};
+      uint64_t m_Divergences{0};
+    };
+
+    Session s_Session;
+
+
+    inline void recordKey(Kind kind, WORD vk, SHORT state) noexcept {
+      s_Session.record(kind, [&](Bytes& out) {
+        out.push_back(uint8_t(vk));
+        putInt16(out, state);
+      });
+    }
+
+    inline SHORT replayKey(Kind kind, WORD vk) noexcept {
+      SHORT state = 0;
+      s_Session.serve(kind, [&](Reader& r) {
+        if(r.end - r.p < 3 || *r.p != uint8_t(vk))
+          return false;
+        ++r.p;
+        return r.int16(state);
+      });
+      return state;
+    }
+  }    // namespace
+
+  bool isRecording() noexcept {
+    return s_Session.recording();
+  }
+
+  bool isReplaying() noexcept {
+    return s_Session.replaying();
+  }
+
+  void advanceFrame() noexcept {
+    s_Session.advanceFrame();
+  }
+
+  void recordKeyState(WORD vk, SHORT state) noexcept {
+    if(isRecording())
+      recordKey(Kind::eKeyState, vk, state);
+  }
+
+  void recordAsyncKeyState(WORD vk, SHORT state) noexcept {
+    if(isRecording())
+      recordKey(Kind::eAsyncKeyState, vk, state);
+  }
+
+  void recordKeyboardState(const uint8_t (&states)[256]) noexcept {
+    if(!isRecording())
+      return;
+
+    s_Session.record(Kind::eKeyboardState, [&](Bytes& out) { out.insert(out.end(), std::begin(states), std::end(states)); });
+  }
+
+  void recordKeyStateMask(const uint64_t (&query)[4], const uint64_t (&active)[4]) noexcept {
+    if(!isRecording())
+      return;
+
+    s_Session.record(Kind::eKeyStateMask, [&](Bytes& out) {
+      auto q = reinterpret_cast<const uint8_t*>(query);
+      auto a = reinterpret_cast<const uint8_t*>(active);
+      out.insert(out.end(), q, q + sizeof(query));
+      out.insert(out.end(), a, a + sizeof(active));
+    });
+  }
+
+  void recordCursorPos(POINT pt) noexcept {
+    if(!isRecording())
+      return;
+
+    s_Session.record(Kind::eCursorPos, [&](Bytes& out) {
+      putZigzag(out, pt.x);
+      putZigzag(out, pt.y);
+    });
+  }
+
+  void recordSendInput(UINT count) noexcept {
+    if(isRecording())
+      s_Session.record(Kind::eSendInput, [&](Bytes& out) { putVarint(out, count); });
+  }
+
+  SHORT replayKeyState(WORD vk) noexcept {
+    return replayKey(Kind::eKeyState, vk);
+  }
+
+  SHORT replayAsyncKeyState(WORD vk) noexcept {
+    return replayKey(Kind::eAsyncKeyState, vk);
+  }
+
+  void replayKeyboardState(uint8_t (&states)[256]) noexcept {
+    if(!s_Session.serve(Kind::eKeyboardState, [&](Reader& r) { return r.raw(states, sizeof(states)); }))
+      std::memset(states, 0, sizeof(states));
+  }
+
+  void replayKeyStateMask(const uint64_t (&query)[4], uint64_t (&active)[4]) noexcept {
+    bool served = s_Session.serve(Kind::eKeyStateMask, [&](Reader& r) {
+      if(r.end - r.p < 64 || std::memcmp(r.p, query, sizeof(query)) != 0)
+        return false;
+      r.p += sizeof(query);
+      return r.raw(active, sizeof(active));
+    });
+
+    if(!served)
+      std::memset(active, 0, sizeof(active));
+  }
+
+  POINT replayCursorPos() noexcept {
+    POINT pt{0, 0};
+    s_Session.serve(Kind::eCursorPos, [&](Reader& r) {
+      int64_t x, y;
+      if(!r.zigzag(x) || !r.zigzag(y))
+        return false;
+      pt = POINT{LONG(x), LONG(y)};
+      return true;
+    });
+    return pt;
+  }
+
+  UINT replaySendInput() noexcept {
+    UINT count = 0;
+    s_Session.serve(Kind::eSendInput, [&](Reader& r) {
+      uint64_t v;
+      if(!r.varint(v))
+        return false;
+      count = UINT(v);
+      return true;
+    });
+    return count;
+  }
+}    // namespace replay
@@ -0,0 +1,42 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <cstdint>
+
+#include "wintypes.h"
+
+/*
+ * Deterministic input record/replay.
+ *
+ * Setting WIN32API_INPUT_RECORD=<path> records the results of the input queries (GetKeyState, GetAsyncKeyState,
+ * GetKeyboardState, GetAsyncKeyStateMask, GetCursorPos and SendInput) into a binary log. Setting
+ * WIN32API_INPUT_REPLAY=<path> serves the same queries from such a log instead of SDL, and selects SDL's dummy video
+ * driver (unless SDL_VIDEODRIVER is already set) so that sessions can run without a display. A "{pid}" in either path
+ * is replaced with the process id, so that many sessions can run side by side.
+ *
+ * Records are keyed by frame; the host advances frames through mkxp::advanceFrame. Without frame information the log
+ * is served strictly in call order.
+ */
+namespace replay {
+  bool isRecording() noexcept;
+  bool isReplaying() noexcept;
+
+  void advanceFrame() noexcept;
+
+  void recordKeyState(WORD vk, SHORT state) noexcept;
+  void recordAsyncKeyState(WORD vk, SHORT state) noexcept;
+  void recordKeyboardState(const uint8_t (&states)[256]) noexcept;
+  void recordKeyStateMask(const uint64_t (&query)[4], const uint64_t (&active)[4]) noexcept;
+  void recordCursorPos(POINT pt) noexcept;
+  void recordSendInput(UINT count) noexcept;
+
+  // The replay functions fall back to neutral values (nothing pressed, origin) when the log diverges.
+  SHORT replayKeyState(WORD vk) noexcept;
+  SHORT replayAsyncKeyState(WORD vk) noexcept;
+  void replayKeyboardState(uint8_t (&states)[256]) noexcept;
+  void replayKeyStateMask(const uint64_t (&query)[4], uint64_t (&active)[4]) noexcept;
+  POINT replayCursorPos() noexcept;
+  UINT replaySendInput() noexcept;
+}    // namespace replay
+
+#endif
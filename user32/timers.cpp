@@ -0,0 +1,239 @@
+#include "timers.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "log.h"
+#include "messages.h"
+
+namespace timers {
+  namespace {
+    constexpr UINT WM_TIMER = 0x0113;
+
+    constexpr UINT USER_TIMER_MINIMUM = 0x0000000A;
+    constexpr UINT USER_TIMER_MAXIMUM = 0x7FFFFFFF;
+
+    // one tick per USER_TIMER_MINIMUM; timers further away than a full turn just stay in their slot for more turns
+    using Tick = std::chrono::duration<int64_t, std::ratio<USER_TIMER_MINIMUM, 1000>>;
+    constexpr size_t k_WheelSlots = 256;
+
+    // ids handed out to timers without a window, like Windows does
+    constexpr UINT_PTR k_FirstThreadTimerId = 0x7FFF;
+
+    struct Timer {
+      HWND hwnd;
+      UINT_PTR id;
+      std::shared_ptr<messages::Thread> thread;    // only for timers without a window
+      TIMERPROC proc;
+      int64_t interval;    // in ticks
+      int64_t due;         // tick
+      bool queued{false};
+      bool alive{true};
+    };
+
+    // timers without a window are told apart by the thread that created them
+    using Key = std::tuple<HWND, const messages::Thread*, UINT_PTR>;
+
+    class Wheel {
+      public:
+        ~Wheel() {
+          {
+            std::lock_guard lock{m_Mutex};
+            m_Stop = true;
+          }
+          m_Wake.notify_one();
+
+          if(m_Thread.joinable())
+            m_Thread.join();
+        }
+
+        UINT_PTR set(HWND hwnd, UINT_PTR id, UINT elapse, TIMERPROC proc) {
+          std::shared_ptr<messages::Thread> thread;
+          if(!hwnd)
+            thread = messages::currentThread();
+
+          std::lock_guard lock{m_Mutex};
+
+          if(!hwnd && (id == 0 || m_Timers.count(Key{0, thread.get(), id}) == 0))
+            id = m_NextThreadTimerId++;
+
+          // a window timer needs a non-zero id, as that is what the caller gets back to kill it with
+          if(hwnd && id == 0)
+            id = 1;
+
+          auto interval = std::max<int64_t>(1, elapse / USER_TIMER_MINIMUM);
+
+          auto timer = std::make_shared<Timer>(Timer{hwnd, id, thread, proc, interval, now() + interval});
+
+          // resetting an existing timer replaces it; the old one is dropped from the wheel lazily
+          auto& slot = m_Timers[Key{hwnd, thread.get(), id}];
+          if(slot)
+            slot->alive = false;
+          slot = timer;
+
+          schedule(timer);
+
+          if(!m_Thread.joinable())
+            m_Thread = std::thread{[this]() { run(); }};
+          m_Wake.notify_one();
+
+          return id;
+        }
+
+        bool kill(HWND hwnd, UINT_PTR id) {
+          std::shared_ptr<messages::Thread> thread;
+          if(!hwnd)
+            thread = messages::currentThread();
+
+          std::lock_guard lock{m_Mutex};
+
+          auto it = m_Timers.find(Key{hwnd, thread.get(), id});
+          if(it == m_Timers.end())
+            return false;
+
+          it->second->alive = false;
+          m_Timers.erase(it);
+          return true;
+        }
+
+        template <typename Pred>
+        void forget(Pred&& owned) {
+          std::lock_guard lock{m_Mutex};
+
+          for(auto it = m_Timers.begin(); it != m_Timers.end();) {
+            if(owned(it->first)) {
+              it->second->alive = false;
+              it = m_Timers.erase(it);
+            } else {
+              ++it;
+            }
+          }
+        }
+
+        void retrieved(HWND hwnd, UINT_PTR id) {
+          std::shared_ptr<messages::Thread> thread;
+          if(!hwnd)
+            thread = messages::currentThread();
+
+          std::lock_guard lock{m_Mutex};
+
+          auto it = m_Timers.find(Key{hwnd, thread.get(), id});
+          if(it != m_Timers.end())
+            it->second->queued = false;
+        }
+
+      private:
+        static int64_t now() noexcept {
+          return std::chrono::duration_cast<Tick>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        void schedule(const std::shared_ptr<Timer>& timer) {
+          m_Wheel[size_t(timer->due) % k_WheelSlots].push_back(timer);
+        }
+
+        // returns false if the timer is gone for good
+        bool fire(Timer& timer) {
+          if(timer.queued)
+            return true;
+
+          auto proc = reinterpret_cast<LPARAM>(timer.proc);
+          bool posted = (timer.hwnd ? messages::post(timer.hwnd, WM_TIMER, timer.id, proc)
+                                    : messages::post(timer.thread, WM_TIMER, timer.id, proc));
+
+          timer.queued = posted;
+          return posted;
+        }
+
+        void advance(int64_t tick) {
+          auto& slot = m_Wheel[size_t(tick) % k_WheelSlots];
+
+          std::vector<std::shared_ptr<Timer>> current;
+          current.swap(slot);
+
+          for(auto& timer : current) {
+            if(!timer->alive)
+              continue;
+
+            if(timer->due > tick) {
+              slot.push_back(std::move(timer));
+              continue;
+            }
+
+            if(!fire(*timer)) {
+              // the window is gone, and the timer with it
+              timer->alive = false;
+              m_Timers.erase(Key{timer->hwnd, timer->thread.get(), timer->id});
+              continue;
+            }
+
+            timer->due = tick + timer->interval;
+            schedule(timer);
+          }
+        }
+
+        void run() {
+          std::unique_lock lock{m_Mutex};
+
+          m_Tick = now();
+          while(!m_Stop) {
+            if(m_Timers.empty()) {
+              m_Wake.wait(lock);
+              m_Tick = now();
+              continue;
+            }
+
+            for(int64_t current = now(); m_Tick <= current; ++m_Tick)
+              advance(m_Tick);
+
+            m_Wake.wait_until(lock, std::chrono::steady_clock::time_point{Tick{m_Tick}});
+          }
+        }
+
+        std::mutex m_Mutex;
+        std::condition_variable m_Wake;
+        std::thread m_Thread;
+        bool m_Stop{false};
+
+        int64_t m_Tick{0};
+        std::array<std::vector<std::shared_ptr<Timer>>, k_WheelSlots> m_Wheel;
+        std::map<Key, std::shared_ptr<Timer>> m_Timers;
+        UINT_PTR m_NextThreadTimerId{k_FirstThreadTimerId};
+    };
+
+    Wheel s_Wheel;
+  }    // namespace
+
+  UINT_PTR set(HWND hwnd, UINT_PTR id, UINT elapse, TIMERPROC proc) noexcept {
+    if(hwnd && !messages::isWindow(hwnd)) {
+      spdlog::warn("Timers are only supported on message windows");
+      return 0;
+    }
+
+    elapse = std::clamp(elapse, USER_TIMER_MINIMUM, USER_TIMER_MAXIMUM);
+    return s_Wheel.set(hwnd, id, elapse, proc);
+  }
+
+  bool kill(HWND hwnd, UINT_PTR id) noexcept {
+    return s_Wheel.kill(hwnd, id);
+  }
+
+  void retrieved(HWND hwnd, UINT_PTR id) noexcept {
+    s_Wheel.retrieved(hwnd, id);
+  }
+
+  void forget(HWND hwnd) noexcept {
+    s_Wheel.forget([hwnd](const Key& key) { return std::get<0>(key) == hwnd; });
+  }
+
+  void forget(const messages::Thread* thread) noexcept {
+    s_Wheel.forget([thread](const Key& key) { return std::get<1>(key) == thread; });
+  }
+}    // namespace timers
@@ -0,0 +1,32 @@
+#ifndef TIMERS_H
+#define TIMERS_H
+
+#include "wintypes.h"
+
+namespace messages {
+  struct Thread;
+}
+
+/*
+ * SetTimer/KillTimer. Timers live on a hashed timer wheel served by a single background thread, which posts WM_TIMER
+ * into the message queue of the timer window (or of the thread that created the timer, for timers without one).
+ */
+namespace timers {
+  UINT_PTR set(HWND hwnd, UINT_PTR id, UINT elapse, TIMERPROC proc) noexcept;
+  bool kill(HWND hwnd, UINT_PTR id) noexcept;
+
+  /*
+   * Called when a WM_TIMER message is removed from a queue. Like on Windows, at most one WM_TIMER per timer is queued
+   * at any time, so a thread that falls behind does not find a backlog of them.
+   */
+  void retrieved(HWND hwnd, UINT_PTR id) noexcept;
+
+  /*
+   * Drops the timers of a window, or the thread timers of a thread, that is going away. A timer whose WM_TIMER is
+   * still queued would otherwise never be retrieved, and so never fire or be removed again.
+   */
+  void forget(HWND hwnd) noexcept;
+  void forget(const messages::Thread* thread) noexcept;
+}    // namespace timers
+
+#endif
@@ -6,20 +6,29 @@
 
 #include <iostream>
 #include <map>
+#include <mutex>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include <SDL.h>
 
+#include "geometry.h"
+#include "input.h"
 #include "log.h"
+#include "messages.h"
 #include "mkxpGlue.h"
+#include "replay.h"
 #include "vkcodes.h"
 
 namespace {
     inline HWND toHWND(SDL_Window* win) {
-        return newHANDLE<HWND>(reinterpret_cast<void*>(win));
+        return newHANDLE<HWND>(reinterpret_cast<void*>(win), HandleKind::eWindow);
     }
 
+    // null for message windows, they have no SDL window behind them
     inline SDL_Window* fromHWND(HWND hwnd) {
-        return reinterpret_cast<SDL_Window*>(fromHANDLE(hwnd));
+        return reinterpret_cast<SDL_Window*>(fromHANDLE(hwnd, HandleKind::eWindow));
     }
 
     enum WindowStyles : uint32_t {
@@ -79,6 +88,8 @@ namespace {
         if(newStyle & WS_VISIBLE)
             SDL_ShowWindow(win);
 
+        geometry::invalidate();
+
         return oldStyle;
     }
 }
@@ -119,14 +130,12 @@ WIN32_API BOOL user32_ClientToScreen(HWND hWnd, LPPOINT lpPoint) {
     return FALSE;
   }
 
-  auto win = fromHWND(hWnd);
-
-  int x{0}, y{0};
-
-  SDL_GetWindowPosition(win, &x, &y);
+  geometry::Window geom;
+  if(!geometry::window(fromHWND(hWnd), geom))
+    return FALSE;
 
-  lpPoint->x += x;
-  lpPoint->y += y;
+  lpPoint->x += geom.rect.x;
+  lpPoint->y += geom.rect.y;
 
   SPDLOG_TRACE(" <- user32::ClientToScreen(hWnd={}, *lpPoint={})", hWnd, *lpPoint);
   return TRUE;
@@ -141,11 +150,55 @@ WIN32_API HWND user32_CreateWindowEx(DWORD dwExStyle, LPCTSTR lpClassName, LPCTS
 WIN32_API HWND user32_CreateWindowExA(DWORD dwExStyle, LPCSTR lpClassName, LPCSTR lpWindowName, DWORD dwStyle, int X, int Y,
                             int nWidth, int nHeight, HWND hWndParent, HMENU hMenu, HINSTANCE hInstance,
                             LPVOID lpParam) {
-    return toHWND(NULL);
+    SPDLOG_TRACE("user32::CreateWindowExA(dwExStyle={:x}, lpClassName=\"{}\", dwStyle={:x}, hWndParent={})", dwExStyle,
+                 lpClassName ? lpClassName : "", dwStyle, (void*) (hWndParent));
+
+    // there is only ever the one game window, so every other window is a hidden message window
+    return messages::createWindow();
+}
+
+WIN32_API BOOL user32_DestroyWindow(HWND hWnd) {
+    SPDLOG_TRACE("user32::DestroyWindow(hWnd={})", (void*) (hWnd));
+
+    geometry::forget(fromHWND(hWnd));
+
+    if(!messages::isWindow(hWnd)) {
+        spdlog::warn("Ignoring request to destroy window {}", (void*) (hWnd));
+        return FALSE;
+    }
+
+    return messages::destroyWindow(hWnd);
 }
 
 WIN32_API SHORT user32_GetAsyncKeyState(WORD vKey) {
-    return user32_GetKeyState(vKey);
+    if(replay::isReplaying())
+        return replay::replayAsyncKeyState(vKey);
+
+    uint8_t state = input::consumeKeyState(vKey);
+    auto result = SHORT(((state & input::eDown) ? 0x8000 : 0) | ((state & input::ePressed) ? 0x0001 : 0));
+
+    replay::recordAsyncKeyState(vKey, result);
+    return result;
+}
+
+WIN32_API BOOL user32_GetAsyncKeyStateMask(const BYTE* lpQueryMask, BYTE* lpStateMask) {
+    if(!lpQueryMask || !lpStateMask) {
+        spdlog::warn("Ignoring null key mask");
+        return FALSE;
+    }
+
+    uint64_t query[4], active[4];
+    std::memcpy(query, lpQueryMask, sizeof(query));
+
+    if(replay::isReplaying()) {
+        replay::replayKeyStateMask(query, active);
+    } else {
+        input::consumeKeyStateMask(query, active);
+        replay::recordKeyStateMask(query, active);
+    }
+
+    std::memcpy(lpStateMask, active, sizeof(active));
+    return TRUE;
 }
 
 WIN32_API BOOL user32_GetClientRect(HWND hWnd, PRECT lpRect) {
@@ -156,12 +209,14 @@ WIN32_API BOOL user32_GetClientRect(HWND hWnd, PRECT lpRect) {
         return FALSE;
     }
 
-    auto win = fromHWND(hWnd);
+    geometry::Window geom;
+    if(!geometry::window(fromHWND(hWnd), geom))
+        return FALSE;
 
     lpRect->left = 0;
     lpRect->top = 0;
-
-    SDL_GL_GetDrawableSize(win, &lpRect->right, &lpRect->bottom);
+    lpRect->right = geom.drawableWidth;
+    lpRect->bottom = geom.drawableHeight;
 
     SPDLOG_TRACE(" <- user32::GetClientRect(hWnd={}, *lpRect={})", (void*) (hWnd), *lpRect);
     return TRUE;
@@ -170,7 +225,12 @@ WIN32_API BOOL user32_GetClientRect(HWND hWnd, PRECT lpRect) {
 WIN32_API BOOL user32_GetCursorPos(LPPOINT lpPoint) {
     SPDLOG_TRACE("user32::GetCursorPos(lpPoint={})", (void*) (lpPoint));
 
-    SDL_GetMouseState(&lpPoint->x, &lpPoint->y);
+    if(replay::isReplaying()) {
+        *lpPoint = replay::replayCursorPos();
+    } else {
+        *lpPoint = input::cursorPos();
+        replay::recordCursorPos(*lpPoint);
+    }
 
     SPDLOG_TRACE(" <- user32::GetCursorPos(*lpPoint={})", *lpPoint);
     return TRUE;
@@ -181,76 +241,122 @@ WIN32_API HWND user32_GetDesktopWindow() {
     return toHWND(NULL);
 }
 
-WIN32_API SHORT user32_GetKeyState(WORD vKey) {
-    switch(vKey) {
-        case VK_LBUTTON:
-        case VK_RBUTTON:
-        case VK_MBUTTON:
-        case VK_XBUTTON1:
-        case VK_XBUTTON2: {
-            int mouseState = SDL_GetGlobalMouseState(NULL, NULL);
-
-            bool isButtonPressed = false;
-
-            switch(vKey) {
-                case VK_LBUTTON:
-                    isButtonPressed = ((mouseState & SDL_BUTTON_LMASK) != 0);
-                    break;
-
-                case VK_RBUTTON:
-                    isButtonPressed = ((mouseState & SDL_BUTTON_RMASK) != 0);
-                    break;
-
-                case VK_MBUTTON:
-                    isButtonPressed = ((mouseState & SDL_BUTTON_MMASK) != 0);
-                    break;
-
-                case VK_XBUTTON1:
-                    isButtonPressed = ((mouseState & SDL_BUTTON_X1MASK) != 0);
-                    break;
-
-                case VK_XBUTTON2:
-                    isButtonPressed = ((mouseState & SDL_BUTTON_X2MASK) != 0);
-                    break;
-            }
-
-//             return (isButtonPressed ? ~(SHORT{-1} >> 1) : 0);
-            return SHORT(isButtonPressed ? -1 : 0);
-        }
+WIN32_API BOOL user32_GetKeyboardState(PBYTE lpKeyState) {
+    SPDLOG_TRACE("user32::GetKeyboardState(lpKeyState={})", (void*) (lpKeyState));
 
-        default: {
-            const auto* state = SDL_GetKeyboardState(NULL);
+    if(!lpKeyState) {
+        spdlog::warn("Ignoring null key state buffer");
+        return FALSE;
+    }
 
-//             return (state[toSDLScancode(vKey)] ? ~(SHORT{-1} >> 1) : 0);
-            return SHORT(state[toSDLScancode(vKey)] ? -1 : 0);
-        }
+    uint8_t states[256];
+    if(replay::isReplaying()) {
+        replay::replayKeyboardState(states);
+    } else {
+        input::keyboardState(states);
+        replay::recordKeyboardState(states);
     }
-}
 
-WIN32_API int user32_GetSystemMetrics(int nIndex) {
-    SPDLOG_TRACE("user32::GetSystemMetrics(nIndex={})", nIndex);
+    std::memcpy(lpKeyState, states, sizeof(states));
+    return TRUE;
+}
 
-    switch(nIndex) {
-        case 0: {     // CXSCREEN
-            SDL_Rect rect;
+WIN32_API SHORT user32_GetKeyState(WORD vKey) {
+    if(replay::isReplaying())
+        return replay::replayKeyState(vKey);
 
-            if(SDL_GetDisplayBounds(SDL_GetWindowDisplayIndex(mkxp::getWindow()), &rect) == 0)
-                return rect.w;
+    uint8_t state = input::keyState(vKey);
+    auto result = SHORT(((state & input::eDown) ? 0x8000 : 0) | ((state & input::eToggled) ? 0x0001 : 0));
 
-            break;
-        }
+    replay::recordKeyState(vKey, result);
+    return result;
+}
 
-        case 1: {    // CYSCREEN
-            SDL_Rect rect;
+WIN32_API int user32_GetSystemMetrics(int nIndex) {
+    SPDLOG_TRACE("user32::GetSystemMetrics(nIndex={})", nIndex);
 
-            if(SDL_GetDisplayBounds(SDL_GetWindowDisplayIndex(mkxp::getWindow()), &rect) == 0)
-                return rect.h;
+    geometry::Display display;
+    if(!geometry::display(display)) {
+        spdlog::error("Failed to obtain display geometry");
+        return 0;
+    }
 
-            break;
-        }
+    // frame metrics come from the decorations of the game window, with the Windows defaults as a fallback
+    geometry::Window window{};
+    bool hasFrame = geometry::window(mkxp::getWindow(), window) && window.borderTop > 0;
+    int captionHeight = (hasFrame ? window.borderTop - window.borderBottom : 23);
+    int frameWidth = (hasFrame ? window.borderLeft : 4);
+    int frameHeight = (hasFrame ? window.borderBottom : 4);
 
+    switch(nIndex) {
+        case 0:         // SM_CXSCREEN
+            return display.bounds.w;
+        case 1:         // SM_CYSCREEN
+            return display.bounds.h;
+        case 2:         // SM_CXVSCROLL
+        case 3:         // SM_CYHSCROLL
+            return 17;
+        case 4:         // SM_CYCAPTION
+            return captionHeight;
+        case 5:         // SM_CXBORDER
+        case 6:         // SM_CYBORDER
+            return 1;
+        case 7:         // SM_CXDLGFRAME
+        case 8:         // SM_CYDLGFRAME
+            return 3;
+        case 11:        // SM_CXICON
+        case 12:        // SM_CYICON
+        case 13:        // SM_CXCURSOR
+        case 14:        // SM_CYCURSOR
+            return 32;
+        case 15:        // SM_CYMENU
+            return 20;
+        case 16:        // SM_CXFULLSCREEN
+            return display.usableBounds.w;
+        case 17:        // SM_CYFULLSCREEN
+            return display.usableBounds.h - captionHeight;
+        case 19:        // SM_MOUSEPRESENT
+            return 1;
+        case 23:        // SM_SWAPBUTTON
+            return 0;
+        case 28:        // SM_CXMIN
+            return 2 * frameWidth + 128;
+        case 29:        // SM_CYMIN
+            return captionHeight + 2 * frameHeight;
+        case 32:        // SM_CXFRAME
+            return frameWidth;
+        case 33:        // SM_CYFRAME
+            return frameHeight;
+        case 43:        // SM_CMOUSEBUTTONS
+            return 5;
+        case 61:        // SM_CXMAXIMIZED
+            return display.usableBounds.w + 2 * frameWidth;
+        case 62:        // SM_CYMAXIMIZED
+            return display.usableBounds.h + 2 * frameHeight;
+        case 75:        // SM_MOUSEWHEELPRESENT
+            return 1;
+        case 76:        // SM_XVIRTUALSCREEN
+            return display.virtualBounds.x;
+        case 77:        // SM_YVIRTUALSCREEN
+            return display.virtualBounds.y;
+        case 78:        // SM_CXVIRTUALSCREEN
+            return display.virtualBounds.w;
+        case 79:        // SM_CYVIRTUALSCREEN
+            return display.virtualBounds.h;
+        case 80:        // SM_CMONITORS
+            return display.count;
+        case 81:        // SM_SAMEDISPLAYFORMAT
+            return 1;
     }
 
+    // scripts query metrics every frame, so each unknown one is only reported the first time
+    static std::mutex s_IgnoredMutex;
+    static std::unordered_set<int> s_Ignored;
+    {
+        std::lock_guard lock{s_IgnoredMutex};
+        if(s_Ignored.insert(nIndex).second)
+            spdlog::warn("Ignored system metric {} request", nIndex);
+    }
     return 0;
 }
 
@@ -262,13 +368,14 @@ WIN32_API BOOL user32_GetWindowRect(HWND hWnd, PRECT lpRect) {
         return FALSE;
     }
 
-    auto* win = fromHWND(hWnd);
-
-    SDL_GetWindowPosition(win, &lpRect->left, &lpRect->top);
-    SDL_GetWindowSize(win, &lpRect->right, &lpRect->bottom);
+    geometry::Window geom;
+    if(!geometry::window(fromHWND(hWnd), geom))
+        return FALSE;
 
-    lpRect->right += lpRect->left;
-    lpRect->bottom += lpRect->top;
+    lpRect->left = geom.rect.x;
+    lpRect->top = geom.rect.y;
+    lpRect->right = geom.rect.x + geom.rect.w;
+    lpRect->bottom = geom.rect.y + geom.rect.h;
 
     SPDLOG_TRACE(" <- user32::GetWindowRect(hWnd={}, *lpRect={})", (void*) (hWnd), *lpRect);
     return TRUE;
@@ -289,6 +396,9 @@ WIN32_API LONG user32_GetWindowLongA(HWND hWnd, int nIndex) {
         return FALSE;
     }
 
+    if(messages::isWindow(hWnd))
+        return LONG(messages::getWindowLong(hWnd, nIndex));
+
     auto win = fromHWND(hWnd);
 
     switch(nIndex) {
@@ -303,7 +413,7 @@ WIN32_API LONG user32_GetWindowLongA(HWND hWnd, int nIndex) {
         }
 
         default:
-            spdlog::warn("Ignored request for parameter {} of window {}", nIndex, (void*)(fromHANDLE(hWnd)));
+            spdlog::warn("Ignored request for parameter {} of window {}", nIndex, (void*)(fromHWND(hWnd)));
             return FALSE;
     }
 }
@@ -503,6 +613,7 @@ WIN32_API BOOL user32_MoveWindow(HWND hWnd, int X, int Y, int nWidth, int nHeigh
 
     SDL_SetWindowPosition(win, X, Y);
     SDL_SetWindowSize(win, nWidth, nHeight);
+    geometry::invalidate();
 
     if(bRepaint)
         SDL_UpdateWindowSurface(win);
@@ -518,19 +629,261 @@ WIN32_API BOOL user32_ScreenToClient(HWND hWnd, LPPOINT lpPoint) {
         return FALSE;
     }
 
-    auto win = fromHWND(hWnd);
-
-    int x{0}, y{0};
-
-    SDL_GetWindowPosition(win, &x, &y);
+    geometry::Window geom;
+    if(!geometry::window(fromHWND(hWnd), geom))
+        return FALSE;
 
-    lpPoint->x -= x;
-    lpPoint->y -= y;
+    lpPoint->x -= geom.rect.x;
+    lpPoint->y -= geom.rect.y;
 
     SPDLOG_TRACE(" <- user32::ScreenToClient(hWnd={}, *lpPoint={})", hWnd, *lpPoint);
     return TRUE;
 }
 
+namespace {
+    /*
+     * Accumulates the SDL events that correspond to a SendInput batch, so that they can be added to the event queue
+     * with a single call.
+     */
+    class InputBatch {
+      public:
+        explicit InputBatch(size_t reserve)
+            : m_Window{mkxp::getWindow()},
+              m_WindowID{m_Window ? SDL_GetWindowID(m_Window) : 0},
+              m_Now{SDL_GetTicks()} {
+            m_Events.reserve(reserve);
+
+            POINT cursor = input::cursorPos();
+            m_X = cursor.x;
+            m_Y = cursor.y;
+
+            constexpr std::pair<WORD, Uint8> k_Buttons[] = {{VK_LBUTTON, SDL_BUTTON_LEFT},  {VK_RBUTTON, SDL_BUTTON_RIGHT},
+                                                            {VK_MBUTTON, SDL_BUTTON_MIDDLE}, {VK_XBUTTON1, SDL_BUTTON_X1},
+                                                            {VK_XBUTTON2, SDL_BUTTON_X2}};
+            for(auto [vk, button] : k_Buttons) {
+                if(input::keyState(vk) & input::eDown)
+                    m_Buttons |= SDL_BUTTON(button);
+            }
+        }
+
+        bool addKeyboard(const KEYBDINPUT& ki) {
+            constexpr DWORD KEYEVENTF_EXTENDEDKEY = 0x0001;
+            constexpr DWORD KEYEVENTF_KEYUP = 0x0002;
+            constexpr DWORD KEYEVENTF_SCANCODE = 0x0008;
+            constexpr DWORD KEYEVENTF_UNICODE = 0x0004;
+
+            if((ki.dwFlags & KEYEVENTF_UNICODE) != 0) {
+                // characters are only typed on key down
+                if((ki.dwFlags & KEYEVENTF_KEYUP) == 0)
+                    addText(ki.wScan, ki.time);
+                return true;
+            }
+
+            SDL_Event& ev = m_Events.emplace_back();
+
+            SDL_Scancode scancode;
+            SDL_Keycode keycode;
+            if((ki.dwFlags & KEYEVENTF_SCANCODE) != 0) {
+                scancode = fromSet1Scancode(ki.wScan, (ki.dwFlags & KEYEVENTF_EXTENDEDKEY) != 0);
+                keycode = toSDLKeycode(fromSDLScancode(scancode));
+            } else {
+                scancode = toSDLScancode(ki.wVk);
+                keycode = toSDLKeycode(ki.wVk);
+            }
+
+            if(scancode == SDL_SCANCODE_UNKNOWN) {
+                spdlog::warn("Skipping KEYBDINPUT event with unknown key (wVk={}, wScan={})", ki.wVk, ki.wScan);
+                m_Events.pop_back();
+                return false;
+            }
+
+            bool up = (ki.dwFlags & KEYEVENTF_KEYUP) != 0;
+            ev.key.type = (up ? SDL_KEYUP : SDL_KEYDOWN);
+            ev.key.state = (up ? SDL_RELEASED : SDL_PRESSED);
+            ev.key.repeat = 0;
+            ev.key.timestamp = timestamp(ki.time);
+            ev.key.windowID = m_WindowID;
+            ev.key.keysym.scancode = scancode;
+            ev.key.keysym.sym = keycode;
+            ev.key.keysym.mod = 0;
+            return true;
+        }
+
+        bool addMouse(const MOUSEINPUT& mi) {
+            constexpr DWORD MOUSEEVENTF_MOVE = 0x0001;
+            constexpr DWORD MOUSEEVENTF_LEFTDOWN = 0x0002;
+            constexpr DWORD MOUSEEVENTF_LEFTUP = 0x0004;
+            constexpr DWORD MOUSEEVENTF_RIGHTDOWN = 0x0008;
+            constexpr DWORD MOUSEEVENTF_RIGHTUP = 0x0010;
+            constexpr DWORD MOUSEEVENTF_MIDDLEDOWN = 0x0020;
+            constexpr DWORD MOUSEEVENTF_MIDDLEUP = 0x0040;
+            constexpr DWORD MOUSEEVENTF_XDOWN = 0x0080;
+            constexpr DWORD MOUSEEVENTF_XUP = 0x0100;
+            constexpr DWORD MOUSEEVENTF_WHEEL = 0x0800;
+            constexpr DWORD MOUSEEVENTF_HWHEEL = 0x1000;
+            constexpr DWORD MOUSEEVENTF_ABSOLUTE = 0x8000;
+
+            constexpr DWORD XBUTTON1 = 0x0001;
+            constexpr DWORD XBUTTON2 = 0x0002;
+
+            constexpr int WHEEL_DELTA = 120;
+
+            Uint32 time = timestamp(mi.time);
+
+            if((mi.dwFlags & MOUSEEVENTF_MOVE) != 0) {
+                int x, y;
+                if((mi.dwFlags & MOUSEEVENTF_ABSOLUTE) != 0) {
+                    // normalised coordinates (0 to 65535) over the screen of the game window
+                    geometry::Display display{};
+                    geometry::Window window{};
+                    geometry::display(display);
+                    geometry::window(m_Window, window);
+
+                    const SDL_Rect& screen = display.bounds;
+                    x = screen.x + int((int64_t(mi.dx) * screen.w) / 65536) - window.rect.x;
+                    y = screen.y + int((int64_t(mi.dy) * screen.h) / 65536) - window.rect.y;
+                } else {
+                    x = m_X + mi.dx;
+                    y = m_Y + mi.dy;
+                }
+
+                SDL_Event& ev = m_Events.emplace_back();
+                ev.motion.type = SDL_MOUSEMOTION;
+                ev.motion.timestamp = time;
+                ev.motion.windowID = m_WindowID;
+                ev.motion.which = 0;
+                ev.motion.state = m_Buttons;
+                ev.motion.x = x;
+                ev.motion.y = y;
+                ev.motion.xrel = x - m_X;
+                ev.motion.yrel = y - m_Y;
+
+                m_X = x;
+                m_Y = y;
+            }
+
+            if((mi.dwFlags & MOUSEEVENTF_LEFTDOWN) != 0)
+                addButton(SDL_BUTTON_LEFT, true, time);
+            if((mi.dwFlags & MOUSEEVENTF_LEFTUP) != 0)
+                addButton(SDL_BUTTON_LEFT, false, time);
+            if((mi.dwFlags & MOUSEEVENTF_RIGHTDOWN) != 0)
+                addButton(SDL_BUTTON_RIGHT, true, time);
+            if((mi.dwFlags & MOUSEEVENTF_RIGHTUP) != 0)
+                addButton(SDL_BUTTON_RIGHT, false, time);
+            if((mi.dwFlags & MOUSEEVENTF_MIDDLEDOWN) != 0)
+                addButton(SDL_BUTTON_MIDDLE, true, time);
+            if((mi.dwFlags & MOUSEEVENTF_MIDDLEUP) != 0)
+                addButton(SDL_BUTTON_MIDDLE, false, time);
+
+            if((mi.dwFlags & (MOUSEEVENTF_XDOWN | MOUSEEVENTF_XUP)) != 0) {
+                bool down = (mi.dwFlags & MOUSEEVENTF_XDOWN) != 0;
+                if((mi.mouseData & XBUTTON1) != 0)
+                    addButton(SDL_BUTTON_X1, down, time);
+                if((mi.mouseData & XBUTTON2) != 0)
+                    addButton(SDL_BUTTON_X2, down, time);
+            }
+
+            if((mi.dwFlags & (MOUSEEVENTF_WHEEL | MOUSEEVENTF_HWHEEL)) != 0) {
+                // mouseData is a signed multiple of WHEEL_DELTA; partial notches still scroll by one
+                auto delta = static_cast<int32_t>(mi.mouseData);
+                int notches = delta / WHEEL_DELTA;
+                if(notches == 0 && delta != 0)
+                    notches = (delta > 0 ? 1 : -1);
+
+                SDL_Event& ev = m_Events.emplace_back();
+                ev.wheel.type = SDL_MOUSEWHEEL;
+                ev.wheel.timestamp = time;
+                ev.wheel.windowID = m_WindowID;
+                ev.wheel.which = 0;
+                ev.wheel.x = ((mi.dwFlags & MOUSEEVENTF_HWHEEL) != 0 ? notches : 0);
+                ev.wheel.y = ((mi.dwFlags & MOUSEEVENTF_WHEEL) != 0 ? notches : 0);
+                ev.wheel.direction = SDL_MOUSEWHEEL_NORMAL;
+            }
+
+            return true;
+        }
+
+        int commit() {
+            if(m_Events.empty())
+                return 0;
+
+            return input::injectEvents(m_Events.data(), int(m_Events.size()));
+        }
+
+      private:
+        Uint32 timestamp(DWORD time) const noexcept {
+            return (time != 0 ? time : m_Now);
+        }
+
+        void addButton(Uint8 button, bool down, Uint32 time) {
+            if(down)
+                m_Buttons |= SDL_BUTTON(button);
+            else
+                m_Buttons &= ~SDL_BUTTON(button);
+
+            SDL_Event& ev = m_Events.emplace_back();
+            ev.button.type = (down ? SDL_MOUSEBUTTONDOWN : SDL_MOUSEBUTTONUP);
+            ev.button.timestamp = time;
+            ev.button.windowID = m_WindowID;
+            ev.button.which = 0;
+            ev.button.button = button;
+            ev.button.state = (down ? SDL_PRESSED : SDL_RELEASED);
+            ev.button.clicks = 1;
+            ev.button.x = m_X;
+            ev.button.y = m_Y;
+        }
+
+        void addText(WORD unit, DWORD time) {
+            // surrogate pairs arrive as two consecutive inputs, possibly split over two SendInput calls
+            thread_local char16_t tl_HighSurrogate = 0;
+
+            char32_t cp;
+            if(unit >= 0xD800 && unit < 0xDC00) {
+                tl_HighSurrogate = unit;
+                return;
+            } else if(unit >= 0xDC00 && unit < 0xE000) {
+                if(!tl_HighSurrogate)
+                    return;
+                cp = 0x10000 + ((char32_t(tl_HighSurrogate) - 0xD800) << 10u) + (unit - 0xDC00);
+                tl_HighSurrogate = 0;
+            } else {
+                cp = unit;
+            }
+
+            SDL_Event& ev = m_Events.emplace_back();
+            ev.text.type = SDL_TEXTINPUT;
+            ev.text.timestamp = timestamp(time);
+            ev.text.windowID = m_WindowID;
+
+            char* out = ev.text.text;
+            if(cp < 0x80) {
+                *out++ = char(cp);
+            } else if(cp < 0x800) {
+                *out++ = char(0xC0 | (cp >> 6u));
+                *out++ = char(0x80 | (cp & 0x3Fu));
+            } else if(cp < 0x10000) {
+                *out++ = char(0xE0 | (cp >> 12u));
+                *out++ = char(0x80 | ((cp >> 6u) & 0x3Fu));
+                *out++ = char(0x80 | (cp & 0x3Fu));
+            } else {
+                *out++ = char(0xF0 | (cp >> 18u));
+                *out++ = char(0x80 | ((cp >> 12u) & 0x3Fu));
+                *out++ = char(0x80 | ((cp >> 6u) & 0x3Fu));
+                *out++ = char(0x80 | (cp & 0x3Fu));
+            }
+            *out = 0;
+        }
+
+
+        std::vector<SDL_Event> m_Events;
+        SDL_Window* m_Window;
+        Uint32 m_WindowID;
+        Uint32 m_Now;
+        Uint32 m_Buttons{0};
+        int m_X{0}, m_Y{0};
+    };
+}
+
 WIN32_API UINT user32_SendInput(UINT cInputs, LPINPUT pInputs, int cbSize) {
     constexpr DWORD INPUT_MOUSE = 0;
     constexpr DWORD INPUT_KEYBOARD = 1;
@@ -543,64 +896,26 @@ WIN32_API UINT user32_SendInput(UINT cInputs, LPINPUT pInputs, int cbSize) {
         return 0;
     }
 
+    // the effects of injected input are already part of the replayed query results
+    if(replay::isReplaying())
+        return replay::replaySendInput();
+
+    InputBatch batch{cInputs};
     UINT count = 0;
 
     for(size_t ii = 0; ii < cInputs; ii++) {
-        INPUT winEv = pInputs[ii];
-        SDL_Event sdlEv;
+        const INPUT& winEv = pInputs[ii];
 
         switch(winEv.type) {
-            case INPUT_MOUSE: {
-//                 constexpr DWORD XBUTTON1 = 0x0001;
-//                 constexpr DWORD XBUTTON2 = 0x0002;
-//
-//                 if(winEv.DUMMYUNIONNAME.mi.time == 0)
-//                     winEv.DUMMYUNIONNAME.mi.time = time(NULL);
-//
-//
-//
-                spdlog::warn("Skipping MOUSEINPUT event");
+            case INPUT_MOUSE:
+                if(batch.addMouse(winEv.DUMMYUNIONNAME.mi))
+                    count++;
                 break;
-            }
-
-            case INPUT_KEYBOARD: {
-                constexpr DWORD KEYEVENTF_EXTENDEDKEY = 0x0001;
-                constexpr DWORD KEYEVENTF_KEYUP = 0x0002;
-                constexpr DWORD KEYEVENTF_SCANCODE = 0x0008;
-                constexpr DWORD KEYEVENTF_UNICODE = 0x0004;
-
-                if((winEv.DUMMYUNIONNAME.ki.dwFlags & KEYEVENTF_UNICODE) != 0) {
-                    spdlog::warn("Skipping unicode KEYBDINPUT event");
-                    break;
-                }
 
-                if((winEv.DUMMYUNIONNAME.ki.dwFlags & KEYEVENTF_SCANCODE) != 0) {
-                    spdlog::warn("Skipping scan code KEYBDINPUT event");
-                    break;
-                }
-
-                if(winEv.DUMMYUNIONNAME.ki.time == 0)
-                    winEv.DUMMYUNIONNAME.ki.time = time(NULL);
-
-                if((winEv.DUMMYUNIONNAME.ki.dwFlags & KEYEVENTF_KEYUP) == 0) {
-                    sdlEv.key.type = SDL_KEYDOWN;
-                    sdlEv.key.state = SDL_PRESSED;
-                } else {
-                    sdlEv.key.type = SDL_KEYUP;
-                    sdlEv.key.state = SDL_RELEASED;
-                }
-
-                sdlEv.key.timestamp = winEv.DUMMYUNIONNAME.ki.time;
-                sdlEv.key.windowID = 0;
-                sdlEv.key.state = 0;
-                sdlEv.key.keysym.sym = toSDLKeycode(winEv.DUMMYUNIONNAME.ki.wVk);
-                sdlEv.key.keysym.scancode = SDL_GetScancodeFromKey(sdlEv.key.keysym.sym);
-                sdlEv.key.keysym.mod = 0;
-
-                SDL_PushEvent(&sdlEv);
-                count++;
+            case INPUT_KEYBOARD:
+                if(batch.addKeyboard(winEv.DUMMYUNIONNAME.ki))
+                    count++;
                 break;
-            }
 
             default:
                 spdlog::warn("Skipping event of type {}", winEv.type);
@@ -608,6 +923,12 @@ WIN32_API UINT user32_SendInput(UINT cInputs, LPINPUT pInputs, int cbSize) {
         }
     }
 
+    if(batch.commit() < 0) {
+        spdlog::error("Failed to add input events to the SDL event queue: {}", SDL_GetError());
+        count = 0;
+    }
+
+    replay::recordSendInput(count);
     return count;
 }
 
@@ -639,6 +960,9 @@ WIN32_API LONG_PTR user32_SetWindowLongPtrA(HWND hWnd, int nIndex, LONG_PTR dwNe
         return FALSE;
     }
 
+    if(messages::isWindow(hWnd))
+        return messages::setWindowLong(hWnd, nIndex, dwNewLong);
+
     auto win = fromHWND(hWnd);
 
     switch(nIndex) {
@@ -650,7 +974,7 @@ WIN32_API LONG_PTR user32_SetWindowLongPtrA(HWND hWnd, int nIndex, LONG_PTR dwNe
                                                                 reinterpret_cast<void*>(dwNewLong)));
 
         default:
-            spdlog::warn("Ignoring window parameter {} change request for window {}", nIndex, (void*) fromHANDLE(hWnd));
+            spdlog::warn("Ignoring window parameter {} change request for window {}", nIndex, (void*) fromHWND(hWnd));
             return FALSE;
     }
 }
@@ -675,12 +999,14 @@ WIN32_API BOOL user32_SetWindowPos(HWND hWnd, HWND hWndInsertAfter, int X, int Y
 
     if((uFlags & SWP_NOSIZE) == 0) {
         SDL_SetWindowSize(win, cx, cy);
+        geometry::invalidate();
 
         SPDLOG_DEBUG("Changed size of window {} to {}x{}", (void*) (hWnd), cx, cy);
     }
 
     if((uFlags & SWP_NOMOVE) == 0) {
         SDL_SetWindowPosition(win, X, Y);
+        geometry::invalidate();
 
         SPDLOG_DEBUG("Changed position of window {} to {}x{}", (void*) (hWnd), X, Y);
     }
@@ -796,18 +1122,19 @@ WIN32_API BOOL user32_SystemParametersInfoA(UINT uiAction, UINT uiParam, PVOID p
 
     switch(uiAction) {
         case 0x0030: {  // SPI_GETWORKAREA
-            SDL_Rect rect;
+            geometry::Display display;
 
-            if(SDL_GetDisplayBounds(SDL_GetWindowDisplayIndex(mkxp::getWindow()), &rect) != 0) {
+            if(!geometry::display(display)) {
                 spdlog::error("Failed to obtain desktop size");
                 return FALSE;
             }
 
+            // relative to the origin of the display, without the area reserved for task bars and docks
             auto pRect = reinterpret_cast<PRECT>(pvParam);
-            pRect->left = 0;
-            pRect->top = 0;
-            pRect->right = rect.w;
-            pRect->bottom = rect.h;
+            pRect->left = display.usableBounds.x - display.bounds.x;
+            pRect->top = display.usableBounds.y - display.bounds.y;
+            pRect->right = pRect->left + display.usableBounds.w;
+            pRect->bottom = pRect->top + display.usableBounds.h;
 
             SPDLOG_TRACE(" <- user32::SystemParametersInfoA(uiAction={}, uiParam={}, *pvParam:RECT={}, fWinIni={})",
                          uiAction, uiParam, *pRect, fWinIni);
@@ -44,10 +44,49 @@ WIN32_API HWND user32_CreateWindowExA(
         LPVOID lpParam
 );
 
+WIN32_API BOOL user32_DestroyWindow(
+        HWND hWnd
+);
+
+/*
+ * Supports the alignment flags, DT_SINGLELINE, DT_WORDBREAK (at spaces), DT_NOCLIP and DT_CALCRECT.
+ */
+WIN32_API int user32_DrawText(
+        HDC hdc,
+        LPCTSTR lpchText,
+        int cchText,
+        LPRECT lprc,
+        UINT format
+);
+WIN32_API int user32_DrawTextA(
+        HDC hdc,
+        LPCSTR lpchText,
+        int cchText,
+        LPRECT lprc,
+        UINT format
+);
+
+WIN32_API LRESULT user32_DispatchMessage(
+        const MSG* lpMsg
+);
+WIN32_API LRESULT user32_DispatchMessageA(
+        const MSG* lpMsg
+);
+
 WIN32_API SHORT user32_GetAsyncKeyState(
         WORD vKey
 );
 
+/*
+ * Not part of the Win32 API: GetAsyncKeyState for many keys in a single call. Both masks are 32 bytes long, bit n
+ * (byte n / 8, bit n % 8) standing for virtual key n. A bit is set in lpStateMask if it is set in lpQueryMask and
+ * GetAsyncKeyState would have returned a non-zero value for that key.
+ */
+WIN32_API BOOL user32_GetAsyncKeyStateMask(
+        const BYTE* lpQueryMask,
+        BYTE* lpStateMask
+);
+
 WIN32_API BOOL user32_GetClientRect(
         HWND hWnd,
         PRECT lpRect
@@ -63,10 +102,27 @@ WIN32_API HDC user32_GetDC(
 
 WIN32_API HWND user32_GetDesktopWindow();
 
+WIN32_API BOOL user32_GetKeyboardState(
+        PBYTE lpKeyState
+);
+
 WIN32_API SHORT user32_GetKeyState(
         WORD vKey
 );
 
+WIN32_API BOOL user32_GetMessage(
+        LPMSG lpMsg,
+        HWND hWnd,
+        UINT wMsgFilterMin,
+        UINT wMsgFilterMax
+);
+WIN32_API BOOL user32_GetMessageA(
+        LPMSG lpMsg,
+        HWND hWnd,
+        UINT wMsgFilterMin,
+        UINT wMsgFilterMax
+);
+
 WIN32_API int user32_GetSystemMetrics(
         int nIndex
 );
@@ -135,11 +191,52 @@ WIN32_API BOOL user32_MoveWindow(
         BOOL bRepaint
 );
 
+WIN32_API BOOL user32_KillTimer(
+        HWND hWnd,
+        UINT_PTR uIDEvent
+);
+
+WIN32_API BOOL user32_PeekMessage(
+        LPMSG lpMsg,
+        HWND hWnd,
+        UINT wMsgFilterMin,
+        UINT wMsgFilterMax,
+        UINT wRemoveMsg
+);
+WIN32_API BOOL user32_PeekMessageA(
+        LPMSG lpMsg,
+        HWND hWnd,
+        UINT wMsgFilterMin,
+        UINT wMsgFilterMax,
+        UINT wRemoveMsg
+);
+
+WIN32_API BOOL user32_PostMessage(
+        HWND hWnd,
+        UINT Msg,
+        WPARAM wParam,
+        LPARAM lParam
+);
+WIN32_API BOOL user32_PostMessageA(
+        HWND hWnd,
+        UINT Msg,
+        WPARAM wParam,
+        LPARAM lParam
+);
+
+WIN32_API void user32_PostQuitMessage(
+        int nExitCode
+);
+
 WIN32_API int user32_ReleaseDC(
         HWND hWnd,
         HDC hDC
 );
 
+WIN32_API BOOL user32_ReplyMessage(
+        LRESULT lResult
+);
+
 WIN32_API BOOL user32_ScreenToClient(
         HWND hWnd,
         LPPOINT lpPoint
@@ -151,6 +248,19 @@ WIN32_API UINT user32_SendInput(
         int cbSize
 );
 
+WIN32_API LRESULT user32_SendMessage(
+        HWND hWnd,
+        UINT Msg,
+        WPARAM wParam,
+        LPARAM lParam
+);
+WIN32_API LRESULT user32_SendMessageA(
+        HWND hWnd,
+        UINT Msg,
+        WPARAM wParam,
+        LPARAM lParam
+);
+
 WIN32_API BOOL user32_SetCursorPos(
         int X,
         int Y
@@ -210,6 +320,17 @@ WIN32_API BOOL user32_SystemParametersInfoA(
         UINT fWinIni
 );
 
+WIN32_API UINT_PTR user32_SetTimer(
+        HWND hWnd,
+        UINT_PTR nIDEvent,
+        UINT uElapse,
+        TIMERPROC lpTimerFunc
+);
+
+WIN32_API BOOL user32_TranslateMessage(
+        const MSG* lpMsg
+);
+
 WIN32_API BOOL user32_UpdateWindow(
         HWND hWnd
 );
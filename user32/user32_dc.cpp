@@ -1,17 +1,201 @@
 #include "user32.h"
 
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <vector>
+
+#include "geometry.h"
+#include "log.h"
+#include "mkxpGlue.h"
+#include "objects.h"
+#include "text.h"
+
+namespace {
+    // What GDI drew over the game window. It outlives the DCs, just like a window's contents would.
+    std::shared_ptr<gdi::Surface> s_Overlay;
+
+    SDL_Window* gameWindow(HWND hWnd) {
+        SDL_Window* win = mkxp::getWindow();
+        return (win && fromHANDLE(hWnd, HandleKind::eWindow) == win ? win : nullptr);
+    }
+
+    enum DrawTextFormat : UINT {
+        DT_TOP = 0x00000000,
+        DT_LEFT = 0x00000000,
+        DT_CENTER = 0x00000001,
+        DT_RIGHT = 0x00000002,
+        DT_VCENTER = 0x00000004,
+        DT_BOTTOM = 0x00000008,
+        DT_WORDBREAK = 0x00000010,
+        DT_SINGLELINE = 0x00000020,
+        DT_NOCLIP = 0x00000100,
+        DT_CALCRECT = 0x00000400
+    };
+
+    // Greedy: as many words as fit. A word wider than the line gets a line of its own.
+    void wrapLine(const gdi::DC& dc, std::string_view line, LONG width, std::vector<std::string_view>& lines) {
+        while(true) {
+            SIZE size;
+            if(!gdi::text::measure(dc, line, size) || size.cx <= width) {
+                lines.push_back(line);
+                return;
+            }
+
+            size_t fit = line.find(' ');
+            if(fit == std::string_view::npos) {
+                lines.push_back(line);
+                return;
+            }
+
+            for(size_t space = line.find(' ', fit + 1); space != std::string_view::npos;
+                space = line.find(' ', space + 1)) {
+                if(!gdi::text::measure(dc, line.substr(0, space), size) || size.cx > width)
+                    break;
+                fit = space;
+            }
+
+            lines.push_back(line.substr(0, fit));
+            line.remove_prefix(fit);
+            while(!line.empty() && line.front() == ' ')
+                line.remove_prefix(1);
+            if(line.empty())
+                return;
+        }
+    }
+
+    std::vector<std::string_view> splitLines(const gdi::DC& dc, std::string_view text, UINT format, LONG width) {
+        std::vector<std::string_view> lines;
+        if(format & DT_SINGLELINE) {
+            lines.push_back(text);
+            return lines;
+        }
+
+        for(size_t start = 0;;) {
+            size_t end = text.find('\n', start);
+            std::string_view line = text.substr(start, end == std::string_view::npos ? end : end - start);
+            if(!line.empty() && line.back() == '\r')
+                line.remove_suffix(1);
+
+            if(format & DT_WORDBREAK)
+                wrapLine(dc, line, width, lines);
+            else
+                lines.push_back(line);
+
+            if(end == std::string_view::npos)
+                return lines;
+            start = end + 1;
+        }
+    }
+}
+
 WIN32_API HDC user32_GetDC(HWND hWnd) {
     if(!hWnd)
-        return toHANDLE<HWND>(NULL);
+        return toHANDLE<HDC>(NULL);
+
+    geometry::Window geom;
+    SDL_Window* win = gameWindow(hWnd);
+    if(!win || !geometry::window(win, geom)) {
+        spdlog::warn("Device contexts are only supported for the game window");
+        return toHANDLE<HDC>(NULL);
+    }
+
+    // a resized window starts over with a blank overlay, which then has to replace the old one entirely
+    bool resized = false;
+    if(!s_Overlay || s_Overlay->width != geom.rect.w || s_Overlay->height != geom.rect.h) {
+        s_Overlay = gdi::Surface::create(geom.rect.w, geom.rect.h);
+        if(!s_Overlay)
+            return toHANDLE<HDC>(NULL);
+        resized = true;
+    }
 
-    // TODO
-    return toHANDLE<HWND>(NULL);
+    auto dc = new(std::nothrow) gdi::DC{hWnd, s_Overlay};
+    if(dc && resized)
+        dc->dirty.add(RECT{0, 0, s_Overlay->width, s_Overlay->height});
+
+    return gdi::add(dc);
+}
+
+WIN32_API int user32_DrawText(HDC hdc, LPCTSTR lpchText, int cchText, LPRECT lprc, UINT format) {
+    return user32_DrawTextA(hdc, lpchText, cchText, lprc, format);
+}
+WIN32_API int user32_DrawTextA(HDC hdc, LPCSTR lpchText, int cchText, LPRECT lprc, UINT format) {
+    auto dc = gdi::get<gdi::DC>(hdc);
+    if(!dc || !lpchText || !lprc)
+        return 0;
+
+    const std::string_view text = (cchText < 0 ? std::string_view{lpchText} : std::string_view{lpchText, size_t(cchText)});
+
+    SIZE cell;
+    if(!gdi::text::measure(*dc, {}, cell))
+        return 0;
+
+    const auto lines = splitLines(*dc, text, format, lprc->right - lprc->left);
+    std::vector<LONG> widths;
+    widths.reserve(lines.size());
+    for(const auto& line : lines) {
+        SIZE size{};
+        gdi::text::measure(*dc, line, size);
+        widths.push_back(size.cx);
+    }
+
+    const LONG height = cell.cy * LONG(lines.size());
+    if(format & DT_CALCRECT) {
+        lprc->right = lprc->left + *std::max_element(widths.begin(), widths.end());
+        lprc->bottom = lprc->top + height;
+        return height;
+    }
+
+    // vertical alignment only applies to single lines, like on Windows
+    LONG y = lprc->top;
+    if(format & DT_SINGLELINE) {
+        if(format & DT_VCENTER)
+            y = lprc->top + (lprc->bottom - lprc->top - height) / 2;
+        else if(format & DT_BOTTOM)
+            y = lprc->bottom - height;
+    }
+    const LONG top = y;
+
+    for(size_t ii = 0; ii < lines.size(); ++ii, y += cell.cy) {
+        LONG x = lprc->left;
+        if(format & DT_CENTER)
+            x = lprc->left + (lprc->right - lprc->left - widths[ii]) / 2;
+        else if(format & DT_RIGHT)
+            x = lprc->right - widths[ii];
+
+        gdi::text::draw(*dc, x, y, lines[ii], (format & DT_NOCLIP ? nullptr : lprc));
+    }
+
+    return (top - lprc->top) + height;
 }
 
 WIN32_API int user32_FillRect(HDC hDC, const RECT* lprc, HBRUSH hbr) {
+    auto dc = gdi::get<gdi::DC>(hDC);
+    auto brush = gdi::get<gdi::Brush>(hbr);
+    if(!dc || !brush || !lprc)
+        return FALSE;
+
+    dc->fill(*lprc, brush->pixel);
     return TRUE;
 }
 
 WIN32_API int user32_ReleaseDC(HWND hWnd, HDC hDC) {
+    // memory DCs (hwnd 0) go through DeleteDC, even when hWnd is 0 too
+    auto dc = gdi::get<gdi::DC>(hDC);
+    if(!dc || !dc->hwnd || dc->hwnd != hWnd)
+        return FALSE;
+
+    // only what changed while the DC was out goes to mkxp
+    auto& surface = *dc->surface;
+    for(const RECT& r : dc->dirty.rects()) {
+        if(!mkxp::uploadOverlay(surface.row(r.top) + 4 * r.left, int(surface.stride), r.left, r.top, r.right - r.left,
+                                r.bottom - r.top)) {
+            SPDLOG_DEBUG("No overlay upload function set, GDI drawing stays invisible");
+            break;
+        }
+    }
+
+    gdi::destroy(hDC);
     return TRUE;
 }
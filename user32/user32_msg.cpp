@@ -0,0 +1,107 @@
+#include "user32.h"
+
+#include "log.h"
+#include "messages.h"
+#include "timers.h"
+
+WIN32_API LRESULT user32_DispatchMessage(const MSG* lpMsg) {
+    return user32_DispatchMessageA(lpMsg);
+}
+
+WIN32_API LRESULT user32_DispatchMessageA(const MSG* lpMsg) {
+    if(!lpMsg) {
+        spdlog::warn("Ignoring null message");
+        return 0;
+    }
+
+    return messages::dispatch(*lpMsg);
+}
+
+WIN32_API BOOL user32_GetMessage(LPMSG lpMsg, HWND hWnd, UINT wMsgFilterMin, UINT wMsgFilterMax) {
+    return user32_GetMessageA(lpMsg, hWnd, wMsgFilterMin, wMsgFilterMax);
+}
+
+WIN32_API BOOL user32_GetMessageA(LPMSG lpMsg, HWND hWnd, UINT wMsgFilterMin, UINT wMsgFilterMax) {
+    SPDLOG_TRACE("user32::GetMessageA(lpMsg={}, hWnd={}, wMsgFilterMin={:x}, wMsgFilterMax={:x})", (void*) (lpMsg),
+                 (void*) (hWnd), wMsgFilterMin, wMsgFilterMax);
+
+    if(!lpMsg) {
+        spdlog::warn("Ignoring null message");
+        return -1;
+    }
+
+    return messages::get(*lpMsg, hWnd, wMsgFilterMin, wMsgFilterMax);
+}
+
+WIN32_API BOOL user32_KillTimer(HWND hWnd, UINT_PTR uIDEvent) {
+    SPDLOG_TRACE("user32::KillTimer(hWnd={}, uIDEvent={})", (void*) (hWnd), uIDEvent);
+
+    return timers::kill(hWnd, uIDEvent);
+}
+
+WIN32_API BOOL user32_PeekMessage(LPMSG lpMsg, HWND hWnd, UINT wMsgFilterMin, UINT wMsgFilterMax, UINT wRemoveMsg) {
+    return user32_PeekMessageA(lpMsg, hWnd, wMsgFilterMin, wMsgFilterMax, wRemoveMsg);
+}
+
+WIN32_API BOOL user32_PeekMessageA(LPMSG lpMsg, HWND hWnd, UINT wMsgFilterMin, UINT wMsgFilterMax, UINT wRemoveMsg) {
+    constexpr UINT PM_REMOVE = 0x0001;
+
+    if(!lpMsg) {
+        spdlog::warn("Ignoring null message");
+        return FALSE;
+    }
+
+    return messages::peek(*lpMsg, hWnd, wMsgFilterMin, wMsgFilterMax, (wRemoveMsg & PM_REMOVE) != 0) > 0;
+}
+
+WIN32_API BOOL user32_PostMessage(HWND hWnd, UINT Msg, WPARAM wParam, LPARAM lParam) {
+    return user32_PostMessageA(hWnd, Msg, wParam, lParam);
+}
+
+WIN32_API BOOL user32_PostMessageA(HWND hWnd, UINT Msg, WPARAM wParam, LPARAM lParam) {
+    SPDLOG_TRACE("user32::PostMessageA(hWnd={}, Msg={:x}, wParam={}, lParam={})", (void*) (hWnd), Msg, wParam, lParam);
+
+    if(!messages::post(hWnd, Msg, wParam, lParam)) {
+        spdlog::warn("Ignoring message {:x} posted to window {}", Msg, (void*) (hWnd));
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+WIN32_API void user32_PostQuitMessage(int nExitCode) {
+    SPDLOG_TRACE("user32::PostQuitMessage(nExitCode={})", nExitCode);
+
+    messages::postQuit(nExitCode);
+}
+
+WIN32_API BOOL user32_ReplyMessage(LRESULT lResult) {
+    return messages::reply(lResult);
+}
+
+WIN32_API LRESULT user32_SendMessage(HWND hWnd, UINT Msg, WPARAM wParam, LPARAM lParam) {
+    return user32_SendMessageA(hWnd, Msg, wParam, lParam);
+}
+
+WIN32_API LRESULT user32_SendMessageA(HWND hWnd, UINT Msg, WPARAM wParam, LPARAM lParam) {
+    SPDLOG_TRACE("user32::SendMessageA(hWnd={}, Msg={:x}, wParam={}, lParam={})", (void*) (hWnd), Msg, wParam, lParam);
+
+    if(!messages::isWindow(hWnd)) {
+        spdlog::warn("Ignoring message {:x} sent to window {}", Msg, (void*) (hWnd));
+        return 0;
+    }
+
+    return messages::send(hWnd, Msg, wParam, lParam);
+}
+
+WIN32_API UINT_PTR user32_SetTimer(HWND hWnd, UINT_PTR nIDEvent, UINT uElapse, TIMERPROC lpTimerFunc) {
+    SPDLOG_TRACE("user32::SetTimer(hWnd={}, nIDEvent={}, uElapse={}, lpTimerFunc={})", (void*) (hWnd), nIDEvent, uElapse,
+                 (void*) (lpTimerFunc));
+
+    return timers::set(hWnd, nIDEvent, uElapse, lpTimerFunc);
+}
+
+WIN32_API BOOL user32_TranslateMessage(const MSG* lpMsg) {
+    // keyboard input never goes through the message queue, so there is nothing to translate
+    return FALSE;
+}
@@ -1,10 +1,15 @@
 #include <SDL.h>
 #include "vkcodes.h"
 
+#include <array>
+#include <iterator>
+#include <utility>
+
 #define VK_CASE_X(vkname, sdlname) case VK_##vkname: return SDLK_##sdlname
 #define VK_CASE(name) VK_CASE_X(name, name)
 
-SDL_Keycode toSDLKeycode(WORD vk) {
+namespace {
+  constexpr SDL_Keycode keycodeOf(WORD vk) noexcept {
     switch(vk) {
         VK_CASE(CANCEL);
         VK_CASE_X(BACK, BACKSPACE);
@@ -13,13 +18,14 @@ SDL_Keycode toSDLKeycode(WORD vk) {
         VK_CASE(RETURN);
         VK_CASE_X(SHIFT, LSHIFT);
         VK_CASE_X(CONTROL, LCTRL);
-        VK_CASE(MENU);
+        VK_CASE_X(MENU, LALT);
         VK_CASE(PAUSE);
         VK_CASE_X(CAPITAL, CAPSLOCK);
         VK_CASE(ESCAPE);
         VK_CASE_X(MODECHANGE, MODE);
         VK_CASE(SPACE);
-        VK_CASE(PRIOR);
+        VK_CASE_X(PRIOR, PAGEUP);
+        VK_CASE_X(NEXT, PAGEDOWN);
         VK_CASE(END);
         VK_CASE(HOME);
         VK_CASE(LEFT);
@@ -68,6 +74,8 @@ SDL_Keycode toSDLKeycode(WORD vk) {
         VK_CASE(x);
         VK_CASE(y);
         VK_CASE(z);
+        VK_CASE_X(LWIN, LGUI);
+        VK_CASE_X(RWIN, RGUI);
         VK_CASE_X(APPS, APPLICATION);
         VK_CASE(SLEEP);
         VK_CASE_X(NUMPAD0, KP_0);
@@ -116,6 +124,8 @@ SDL_Keycode toSDLKeycode(WORD vk) {
         VK_CASE(RSHIFT);
         VK_CASE_X(LCONTROL, LCTRL);
         VK_CASE_X(RCONTROL, RCTRL);
+        VK_CASE_X(LMENU, LALT);
+        VK_CASE_X(RMENU, RALT);
         VK_CASE_X(BROWSER_BACK, AC_BACK);
         VK_CASE_X(BROWSER_FORWARD, AC_FORWARD);
         VK_CASE_X(BROWSER_REFRESH, AC_REFRESH);
@@ -132,10 +142,167 @@ SDL_Keycode toSDLKeycode(WORD vk) {
         VK_CASE_X(MEDIA_PLAY_PAUSE, AUDIOPLAY);
         VK_CASE_X(LAUNCH_MAIL, MAIL);
         VK_CASE_X(LAUNCH_MEDIA_SELECT, MEDIASELECT);
+        VK_CASE_X(OEM_1, SEMICOLON);
+        VK_CASE_X(OEM_PLUS, EQUALS);
+        VK_CASE_X(OEM_COMMA, COMMA);
+        VK_CASE_X(OEM_MINUS, MINUS);
+        VK_CASE_X(OEM_PERIOD, PERIOD);
+        VK_CASE_X(OEM_2, SLASH);
+        VK_CASE_X(OEM_3, BACKQUOTE);
+        VK_CASE_X(OEM_4, LEFTBRACKET);
+        VK_CASE_X(OEM_5, BACKSLASH);
+        VK_CASE_X(OEM_6, RIGHTBRACKET);
+        VK_CASE_X(OEM_7, QUOTE);
         VK_CASE(CRSEL);
         VK_CASE(EXSEL);
         VK_CASE_X(PLAY, AUDIOPLAY);
     }
 
     return SDLK_UNKNOWN;
+  }
+
+  /*
+   * Layout-independent (US layout) keycode to scancode mapping. Keycodes that are not printable characters are derived
+   * from their scancode, so only the characters used by keycodeOf need to be listed here.
+   */
+  constexpr SDL_Scancode scancodeOf(SDL_Keycode kc) noexcept {
+    if(kc & SDLK_SCANCODE_MASK)
+      return static_cast<SDL_Scancode>(kc & ~SDLK_SCANCODE_MASK);
+
+    if(kc >= SDLK_a && kc <= SDLK_z)
+      return static_cast<SDL_Scancode>(SDL_SCANCODE_A + (kc - SDLK_a));
+    if(kc >= SDLK_1 && kc <= SDLK_9)
+      return static_cast<SDL_Scancode>(SDL_SCANCODE_1 + (kc - SDLK_1));
+
+    switch(kc) {
+      case SDLK_0: return SDL_SCANCODE_0;
+      case SDLK_RETURN: return SDL_SCANCODE_RETURN;
+      case SDLK_ESCAPE: return SDL_SCANCODE_ESCAPE;
+      case SDLK_BACKSPACE: return SDL_SCANCODE_BACKSPACE;
+      case SDLK_TAB: return SDL_SCANCODE_TAB;
+      case SDLK_SPACE: return SDL_SCANCODE_SPACE;
+      case SDLK_DELETE: return SDL_SCANCODE_DELETE;
+      case SDLK_SEMICOLON: return SDL_SCANCODE_SEMICOLON;
+      case SDLK_EQUALS: return SDL_SCANCODE_EQUALS;
+      case SDLK_COMMA: return SDL_SCANCODE_COMMA;
+      case SDLK_MINUS: return SDL_SCANCODE_MINUS;
+      case SDLK_PERIOD: return SDL_SCANCODE_PERIOD;
+      case SDLK_SLASH: return SDL_SCANCODE_SLASH;
+      case SDLK_BACKQUOTE: return SDL_SCANCODE_GRAVE;
+      case SDLK_LEFTBRACKET: return SDL_SCANCODE_LEFTBRACKET;
+      case SDLK_BACKSLASH: return SDL_SCANCODE_BACKSLASH;
+      case SDLK_RIGHTBRACKET: return SDL_SCANCODE_RIGHTBRACKET;
+      case SDLK_QUOTE: return SDL_SCANCODE_APOSTROPHE;
+      default: return SDL_SCANCODE_UNKNOWN;
+    }
+  }
+
+  namespace tables {
+    constexpr std::array<SDL_Keycode, 256> generate_vk_to_keycode_table() noexcept {
+      std::array<SDL_Keycode, 256> tab{};
+      for(uint32_t vk = 0; vk < tab.size(); ++vk)
+        tab[vk] = keycodeOf(vk);
+      return tab;
+    }
+
+    constexpr std::array<SDL_Keycode, 256> k_VKToKeycode = generate_vk_to_keycode_table();
+
+
+    constexpr std::array<SDL_Scancode, 256> generate_vk_to_scancode_table() noexcept {
+      std::array<SDL_Scancode, 256> tab{};
+      for(uint32_t vk = 0; vk < tab.size(); ++vk)
+        tab[vk] = scancodeOf(k_VKToKeycode[vk]);
+      return tab;
+    }
+
+    constexpr std::array<SDL_Scancode, 256> k_VKToScancode = generate_vk_to_scancode_table();
+
+
+    constexpr std::array<uint8_t, SDL_NUM_SCANCODES> generate_scancode_to_vk_table() noexcept {
+      std::array<uint8_t, SDL_NUM_SCANCODES> tab{};
+      for(uint32_t vk = 1; vk < k_VKToScancode.size(); ++vk) {
+        // the generic modifiers share their scancode with the left variant, which must win
+        if(vk == VK_SHIFT || vk == VK_CONTROL || vk == VK_MENU)
+          continue;
+
+        SDL_Scancode sc = k_VKToScancode[vk];
+        if(sc != SDL_SCANCODE_UNKNOWN && tab[sc] == 0)
+          tab[sc] = vk;
+      }
+      return tab;
+    }
+
+    constexpr std::array<uint8_t, SDL_NUM_SCANCODES> k_ScancodeToVK = generate_scancode_to_vk_table();
+
+    // PC/AT scan code set 1, as used by KEYBDINPUT::wScan; the second half holds the E0-prefixed (extended) keys
+    constexpr std::array<SDL_Scancode, 256> generate_set1_to_scancode_table() noexcept {
+      std::array<SDL_Scancode, 256> tab{};
+
+      constexpr SDL_Scancode k_Base[] = {
+        SDL_SCANCODE_UNKNOWN, SDL_SCANCODE_ESCAPE, SDL_SCANCODE_1, SDL_SCANCODE_2, SDL_SCANCODE_3, SDL_SCANCODE_4,
+        SDL_SCANCODE_5, SDL_SCANCODE_6, SDL_SCANCODE_7, SDL_SCANCODE_8, SDL_SCANCODE_9, SDL_SCANCODE_0,
+        SDL_SCANCODE_MINUS, SDL_SCANCODE_EQUALS, SDL_SCANCODE_BACKSPACE, SDL_SCANCODE_TAB, SDL_SCANCODE_Q,
+        SDL_SCANCODE_W, SDL_SCANCODE_E, SDL_SCANCODE_R, SDL_SCANCODE_T, SDL_SCANCODE_Y, SDL_SCANCODE_U,
+        SDL_SCANCODE_I, SDL_SCANCODE_O, SDL_SCANCODE_P, SDL_SCANCODE_LEFTBRACKET, SDL_SCANCODE_RIGHTBRACKET,
+        SDL_SCANCODE_RETURN, SDL_SCANCODE_LCTRL, SDL_SCANCODE_A, SDL_SCANCODE_S, SDL_SCANCODE_D, SDL_SCANCODE_F,
+        SDL_SCANCODE_G, SDL_SCANCODE_H, SDL_SCANCODE_J, SDL_SCANCODE_K, SDL_SCANCODE_L, SDL_SCANCODE_SEMICOLON,
+        SDL_SCANCODE_APOSTROPHE, SDL_SCANCODE_GRAVE, SDL_SCANCODE_LSHIFT, SDL_SCANCODE_BACKSLASH, SDL_SCANCODE_Z,
+        SDL_SCANCODE_X, SDL_SCANCODE_C, SDL_SCANCODE_V, SDL_SCANCODE_B, SDL_SCANCODE_N, SDL_SCANCODE_M,
+        SDL_SCANCODE_COMMA, SDL_SCANCODE_PERIOD, SDL_SCANCODE_SLASH, SDL_SCANCODE_RSHIFT, SDL_SCANCODE_KP_MULTIPLY,
+        SDL_SCANCODE_LALT, SDL_SCANCODE_SPACE, SDL_SCANCODE_CAPSLOCK, SDL_SCANCODE_F1, SDL_SCANCODE_F2,
+        SDL_SCANCODE_F3, SDL_SCANCODE_F4, SDL_SCANCODE_F5, SDL_SCANCODE_F6, SDL_SCANCODE_F7, SDL_SCANCODE_F8,
+        SDL_SCANCODE_F9, SDL_SCANCODE_F10, SDL_SCANCODE_NUMLOCKCLEAR, SDL_SCANCODE_SCROLLLOCK, SDL_SCANCODE_KP_7,
+        SDL_SCANCODE_KP_8, SDL_SCANCODE_KP_9, SDL_SCANCODE_KP_MINUS, SDL_SCANCODE_KP_4, SDL_SCANCODE_KP_5,
+        SDL_SCANCODE_KP_6, SDL_SCANCODE_KP_PLUS, SDL_SCANCODE_KP_1, SDL_SCANCODE_KP_2, SDL_SCANCODE_KP_3,
+        SDL_SCANCODE_KP_0, SDL_SCANCODE_KP_PERIOD, SDL_SCANCODE_UNKNOWN, SDL_SCANCODE_UNKNOWN,
+        SDL_SCANCODE_NONUSBACKSLASH, SDL_SCANCODE_F11, SDL_SCANCODE_F12,
+      };
+      for(uint32_t ii = 0; ii < std::size(k_Base); ++ii)
+        tab[ii] = k_Base[ii];
+
+      constexpr std::pair<uint8_t, SDL_Scancode> k_Extended[] = {
+        {0x1C, SDL_SCANCODE_KP_ENTER}, {0x1D, SDL_SCANCODE_RCTRL},    {0x35, SDL_SCANCODE_KP_DIVIDE},
+        {0x37, SDL_SCANCODE_PRINTSCREEN}, {0x38, SDL_SCANCODE_RALT},  {0x47, SDL_SCANCODE_HOME},
+        {0x48, SDL_SCANCODE_UP},       {0x49, SDL_SCANCODE_PAGEUP},   {0x4B, SDL_SCANCODE_LEFT},
+        {0x4D, SDL_SCANCODE_RIGHT},    {0x4F, SDL_SCANCODE_END},      {0x50, SDL_SCANCODE_DOWN},
+        {0x51, SDL_SCANCODE_PAGEDOWN}, {0x52, SDL_SCANCODE_INSERT},   {0x53, SDL_SCANCODE_DELETE},
+        {0x5B, SDL_SCANCODE_LGUI},     {0x5C, SDL_SCANCODE_RGUI},     {0x5D, SDL_SCANCODE_APPLICATION},
+      };
+      for(auto [code, sc] : k_Extended)
+        tab[0x80 + code] = sc;
+
+      return tab;
+    }
+
+    constexpr std::array<SDL_Scancode, 256> k_Set1ToScancode = generate_set1_to_scancode_table();
+
+    static_assert(k_Set1ToScancode[0x1E] == SDL_SCANCODE_A && k_Set1ToScancode[0x58] == SDL_SCANCODE_F12);
+    static_assert(k_ScancodeToVK[SDL_SCANCODE_LSHIFT] == VK_LSHIFT);
+    static_assert(k_ScancodeToVK[SDL_SCANCODE_A] == VK_a);
+  }    // namespace tables
+}    // namespace
+
+SDL_Keycode toSDLKeycode(WORD vk) noexcept {
+  return (vk < tables::k_VKToKeycode.size() ? tables::k_VKToKeycode[vk] : SDLK_UNKNOWN);
+}
+
+SDL_Scancode toSDLScancode(WORD vk) noexcept {
+  return (vk < tables::k_VKToScancode.size() ? tables::k_VKToScancode[vk] : SDL_SCANCODE_UNKNOWN);
+}
+
+WORD fromSDLScancode(SDL_Scancode sc) noexcept {
+  return (sc >= 0 && sc < SDL_NUM_SCANCODES ? tables::k_ScancodeToVK[sc] : 0);
+}
+
+SDL_Scancode fromSet1Scancode(WORD scan, bool extended) noexcept {
+  // an explicit E0 prefix in the high byte counts as the extended flag too
+  if((scan >> 8u) == 0xE0)
+    extended = true;
+
+  scan &= 0x7Fu;
+  return tables::k_Set1ToScancode[(extended ? 0x80u : 0u) + scan];
+}
+
+WORD fromSDLKeycode(SDL_Keycode kc) noexcept {
+  return fromSDLScancode(scancodeOf(kc));
 }
@@ -1,6 +1,8 @@
 #ifndef VKCODES_H
 #define VKCODES_H
 
+#include <SDL.h>
+
 #include "wintypes.h"
 
 #define VK(name, value) constexpr WORD VK_##name = value
@@ -181,10 +183,18 @@ VK(OEM_CLEAR, 0xFE);
 
 #undef VK
 
-SDL_Keycode toSDLKeycode(WORD vk);
+/*
+ * The conversions below are lookups into tables generated at compile time. Scancodes follow the US layout, so they
+ * do not depend on the keyboard layout active in SDL.
+ */
+SDL_Keycode toSDLKeycode(WORD vk) noexcept;
+SDL_Scancode toSDLScancode(WORD vk) noexcept;
+
+// The reverse conversions never return the generic VK_SHIFT/VK_CONTROL/VK_MENU, only their left/right variants.
+WORD fromSDLKeycode(SDL_Keycode kc) noexcept;
+WORD fromSDLScancode(SDL_Scancode sc) noexcept;
 
-inline SDL_Scancode toSDLScancode(WORD vk) {
-    return SDL_GetScancodeFromKey(toSDLKeycode(vk));
-}
+// Converts a scan code set 1 make code (KEYBDINPUT::wScan), with extended meaning an E0 prefix.
+SDL_Scancode fromSet1Scancode(WORD scan, bool extended) noexcept;
 
 #endif
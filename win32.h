@@ -1,6 +1,28 @@
 #include "advapi32.h"
+#include "gdi32.h"
+#include "gdiplus/gdiplus.h"
 #include "kernel32.h"
+#include "rpcrt4.h"
 #include "user32.h"
+#include "winmm.h"
 
+#include "extra/camouse/camouse.hpp"
 #include "extra/tktk_bitmap/tktk_bitmap.h"
-#include "extra/wfcrypt/wfcrypt.h"
\ No newline at end of file
+#include "extra/wfcrypt/wfcrypt.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Looks up the export that Win32API.new(dll, fn, ...) refers to. The dll name is matched case-insensitively and may
+ * carry a directory or a ".dll" suffix; if fn is not found as is, its ANSI variant (fn + "A") is tried, like Windows
+ * does. On success, *signature (if not null) receives the argument types followed by ':' and the return type, using
+ * Win32API's letters: 'p' pointer, 's' 16-bit integer, 'i' 32-bit integer, 'l' 64-bit integer, 'v' void. Returns null
+ * if there is no such export.
+ */
+WIN32_API const void* win32api_resolve(const char* dll, const char* fn, const char** signature);
+
+#ifdef __cplusplus
+}
+#endif
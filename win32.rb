@@ -31,49 +31,46 @@ module Win32API
     extend FFI::Library
     ffi_lib FFI::CURRENT_PROCESS
 
-    def new(dllName, fnName, argList, retType)
-        symName = dllName.downcase.split("/").last + "_" + fnName
-        symSym = symName.to_sym
-        
-        param_transform = lambda do |arg|
-            case arg.to_s.downcase
-            when 'p'
-                :pointer
-            when 'l'
-                :long
-            when 'n', 'i'
-                :int
-            when 'v'
-                :void
-            else
-                nil
-            end
-        end
-        
-        
-        if argList.is_a? String
-            argList = argList.split(' ').join().chars
+    attach_function :win32api_resolve, [:string, :string, :pointer], :pointer
+
+    TYPES = {'p' => :pointer, 's' => :short, 'i' => :int, 'l' => :long, 'v' => :void}
+
+    # [dll, fn] => [function, param types, return type], so each export is looked up and bound once
+    @resolved = {}
+
+    def self.resolve(dllName, fnName)
+        dllName = dllName.downcase.split("/").last
+
+        @resolved[[dllName, fnName]] ||= begin
+            sigPtr = FFI::MemoryPointer.new(:pointer)
+            fnPtr = win32api_resolve(dllName, fnName, sigPtr)
+            raise FFI::NotFoundError.new(fnName, dllName) if fnPtr.null?
+
+            params, ret = sigPtr.read_pointer.read_string.split(':', -1)
+            paramList = params.chars.map { |c| TYPES[c] }
+            retType = TYPES[ret]
+
+            [FFI::Function.new(retType, paramList, fnPtr), paramList, retType]
         end
-        
-        paramList = argList.map{|arg| param_transform.call(arg)}
-        paramList.delete :void
-        
-        retType = param_transform.call(retType)
-        
-        Win32API.attach_function symSym, paramList, retType
-        
+    end
+
+    # argList is only kept for compatibility: the library knows the real types of its exports
+    def new(dllName, fnName, argList, retType)
+        function, paramList, nativeRet = Win32API.resolve(dllName, fnName)
+        addressResult = (nativeRet.equal? :pointer and retType.to_s.downcase != 'p')
+
         lambda do |*args|
             args.each_index do |i|
-                if paramList[i].equal? :pointer and args[i].equal? 0
-                    args[i] = nil
-                elsif paramList[i].equal? :int and args[i] >= 2**31
+                if paramList[i].equal? :pointer and args[i].is_a? Integer
+                    args[i] = (args[i] == 0 ? nil : FFI::Pointer.new(args[i]))
+                elsif paramList[i].equal? :int and args[i].is_a? Integer and args[i] >= 2**31
                     args[i] = args[i] - 2**32
                 end
             end
-            
-            Win32API.method(symSym).call(*args)
+
+            result = function.call(*args)
+            addressResult ? result.address : result
         end
-#         Win32API.method(symSym)
     end
 
     module_function :new
@@ -0,0 +1,30 @@
+#include "winmm.h"
+
+#include <time.h>
+
+#include "log.h"
+
+namespace {
+    constexpr MMRESULT TIMERR_NOERROR = 0;
+    constexpr MMRESULT TIMERR_NOCANDO = 97;
+}
+
+WIN32_API MMRESULT winmm_timeBeginPeriod(UINT uPeriod) {
+    SPDLOG_TRACE("winmm::timeBeginPeriod(uPeriod={})", uPeriod);
+
+    // timeGetTime always has millisecond resolution here
+    return (uPeriod != 0 ? TIMERR_NOERROR : TIMERR_NOCANDO);
+}
+
+WIN32_API MMRESULT winmm_timeEndPeriod(UINT uPeriod) {
+    SPDLOG_TRACE("winmm::timeEndPeriod(uPeriod={})", uPeriod);
+
+    return (uPeriod != 0 ? TIMERR_NOERROR : TIMERR_NOCANDO);
+}
+
+WIN32_API DWORD winmm_timeGetTime(void) {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return DWORD(uint64_t(ts.tv_sec) * 1000u + uint64_t(ts.tv_nsec) / 1000000u);
+}
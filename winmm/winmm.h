@@ -0,0 +1,26 @@
+#ifndef WINMM_H
+#define WINMM_H
+
+#include "wintypes.h"
+
+typedef UINT MMRESULT;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+WIN32_API MMRESULT winmm_timeBeginPeriod(
+    UINT uPeriod
+);
+
+WIN32_API MMRESULT winmm_timeEndPeriod(
+    UINT uPeriod
+);
+
+WIN32_API DWORD winmm_timeGetTime(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
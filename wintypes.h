@@ -32,6 +32,8 @@ typedef int             BOOL;
 typedef BOOL*           LPBOOL;
 
 typedef unsigned char   BYTE;
+typedef BYTE*           PBYTE;
+typedef BYTE*           LPBYTE;
 
 typedef char            CHAR;
 typedef char16_t        WCHAR;
@@ -55,6 +57,14 @@ typedef uintptr_t       ULONG_PTR;
 
 typedef ULONG_PTR       SIZE_T;
 
+typedef int64_t         LONGLONG;
+typedef uint64_t        ULONGLONG;
+
+typedef uintptr_t       UINT_PTR;
+typedef UINT_PTR        WPARAM;
+typedef LONG_PTR        LPARAM;
+typedef LONG_PTR        LRESULT;
+
 typedef unsigned short  WORD;
 typedef uint32_t        DWORD;
 
@@ -94,12 +104,37 @@ typedef struct tagPOINT {
   LONG y;
 } POINT, *PPOINT, *LPPOINT;
 
+typedef struct tagSIZE {
+  LONG cx;
+  LONG cy;
+} SIZE, *PSIZE, *LPSIZE;
+
 typedef struct _RECT {
     LONG left;
     LONG top;
     LONG right;
     LONG bottom;
-} RECT, *PRECT;
+} RECT, *PRECT, *LPRECT;
+
+typedef LRESULT (*WNDPROC)(HWND, UINT, WPARAM, LPARAM);
+typedef void (*TIMERPROC)(HWND, UINT, UINT_PTR, DWORD);
+
+typedef union _LARGE_INTEGER {
+    struct {
+        DWORD LowPart;
+        LONG  HighPart;
+    } u;
+    LONGLONG QuadPart;
+} LARGE_INTEGER, *PLARGE_INTEGER;
+
+typedef struct tagMSG {
+    HWND   hwnd;
+    UINT   message;
+    WPARAM wParam;
+    LPARAM lParam;
+    DWORD  time;
+    POINT  pt;
+} MSG, *PMSG, *LPMSG;
 
 typedef struct tagMOUSEINPUT {
     LONG      dx;
@@ -137,15 +172,29 @@ typedef struct tagINPUT {
 #undef CONST
 
 
+// What a handle refers to. Lookups name the kind they expect, so a handle never resolves to an object of another type.
+enum class HandleKind : uint8_t {
+    eWindow,             // SDL_Window
+    eMessageWindow,      // messages::Window
+    eGdiObject,          // gdi::Object
+    eWfcryptContext,
+    eWfcryptStream,
+};
+
 template <typename HANDLEType>
-HANDLEType newHANDLE(void* ptr);
+HANDLEType newHANDLE(void* ptr, HandleKind kind);
 
+// null if the handle is stale or refers to another kind of object
 template <typename HANDLEType>
-void* fromHANDLE(HANDLEType handle);
+void* fromHANDLE(HANDLEType handle, HandleKind kind);
 
 // probably unnecessary
 template <typename HANDLEType>
 HANDLEType toHANDLE(void* ptr);
 
+// frees the handle for reuse; the pointer it refers to is not touched
+template <typename HANDLEType>
+void releaseHANDLE(HANDLEType handle);
+
 
 #endif